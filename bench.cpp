@@ -0,0 +1,459 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+// Benchmarks for regression tracking:
+// - pixel conversion kernels over synthetic frames (always)
+// - frame handoff between threads through a mailbox and a FIFO (always)
+// - texture update strategies of the display (--display, needs a window)
+// - sensor timestamp to buffer swap latency with a real camera (--camera)
+// - conversion and display of frames recorded with FrameDumpWriter (--replay <file>)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <print>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <libcamera/formats.h>
+
+#include "camera.h"
+#include "display.h"
+#include "frame_analysis.h"
+#include "frame_dump.h"
+#include "pixel_convert.h"
+#include "spsc_queue.h"
+#include "stats.h"
+#include "worker_pool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Resolution {
+  std::string_view name;
+  picam::ImageSize size;
+};
+
+constexpr auto RESOLUTIONS = std::array{
+  Resolution{ .name = "720p", .size = { .width = 1280, .height = 720 } },
+  Resolution{ .name = "1080p", .size = { .width = 1920, .height = 1080 } },
+  Resolution{ .name = "4K", .size = { .width = 3840, .height = 2160 } },
+};
+
+struct Format {
+  std::string_view name;
+  std::uint32_t fourcc;
+  std::uint64_t modifier{};
+};
+
+constexpr auto FORMATS = std::array{
+  Format{ .name = "RGB888", .fourcc = libcamera::formats::RGB888 },
+  Format{ .name = "YUYV", .fourcc = libcamera::formats::YUYV },
+  Format{ .name = "NV12", .fourcc = libcamera::formats::NV12 },
+  Format{ .name = "SRGGB10_CSI2P",
+          .fourcc = libcamera::formats::SRGGB10_CSI2P,
+          .modifier = libcamera::formats::SRGGB10_CSI2P.modifier() },
+};
+
+constexpr auto SIMD_LEVELS = std::array{ picam::SimdLevel::Scalar, picam::SimdLevel::Sse41,
+                                         picam::SimdLevel::Avx2, picam::SimdLevel::Neon };
+
+constexpr auto OUTPUT_FORMATS = std::array{ picam::OutputFormat::Rgb888,
+                                            picam::OutputFormat::Rgba8888,
+                                            picam::OutputFormat::Gray8 };
+
+//=================================================================================================
+/// Synthetic camera frame with random pixel data and camera-like row padding
+class SyntheticFrame {
+public:
+  static constexpr auto ROW_ALIGNMENT = 64U;
+
+  SyntheticFrame(picam::ImageSize size, std::uint32_t format, std::uint64_t modifier = 0) {
+    const auto width = static_cast<std::uint32_t>(size.width);
+    const auto height = static_cast<std::size_t>(size.height);
+    auto row_bytes = width * 3U;
+    if (format == libcamera::formats::YUYV) {
+      row_bytes = width * 2U;
+    } else if (format == libcamera::formats::NV12) {
+      row_bytes = width;
+    } else if (const auto bayer = picam::bayerFormat(format, modifier); bayer) {
+      row_bytes = bayer->rowBytes(width);
+    }
+    const auto pitch = (row_bytes + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+    const auto plane_count = (format == libcamera::formats::NV12) ? 2U : 1U;
+    const auto luma_bytes = pitch * height;
+    const auto chroma_bytes = (plane_count > 1) ? pitch * (height / 2) : 0U;
+
+    data_.resize(luma_bytes + chroma_bytes);
+    auto rng = std::mt19937{ 1 };  // NOLINT(cert-msc32-c,cert-msc51-cpp) reproducible on purpose
+    std::ranges::generate(data_, [&rng] { return static_cast<std::byte>(rng()); });
+
+    frame_.header = { .timestamp = picam::SensorClock::now(),
+                      .completion_time = picam::SensorClock::now(),
+                      .sequence = 0,
+                      .stream_id = 0,
+                      .pitch = pitch,
+                      .size = size,
+                      .format = format,
+                      .format_modifier = modifier,
+                      .color_space = {},
+                      .metadata = {},
+                      .statistics = {} };
+    frame_.plane_count = plane_count;
+    const auto pixels = std::span(data_);
+    frame_.planes[0] = { .data = pixels.first(luma_bytes), .stride = pitch, .fd = -1, .offset = 0 };
+    if (plane_count > 1) {
+      frame_.planes[1] = { .data = pixels.subspan(luma_bytes),
+                           .stride = pitch,
+                           .fd = -1,
+                           .offset = static_cast<std::uint32_t>(luma_bytes) };
+    }
+  }
+
+  [[nodiscard]] auto frame() const -> const picam::ImageFrame& {
+    return frame_;
+  }
+
+private:
+  std::vector<std::byte> data_;
+  picam::ImageFrame frame_;
+};
+
+//-------------------------------------------------------------------------------------------------
+void printHeader(std::string_view title) {
+  std::println("\n== {} ==", title);
+}
+
+//-------------------------------------------------------------------------------------------------
+void printStats(std::string_view label, const picam::DurationStats& stats, double pixels = 0.0) {
+  const auto to_ms = [](std::chrono::nanoseconds ns) {
+    return static_cast<double>(ns.count()) / 1e6;
+  };
+  const auto mean_ms = to_ms(stats.mean());
+  std::print("{:<28} n={:<6} mean={:8.3f} ms  p50<={:8.3f} ms  p99<={:8.3f} ms  max={:8.3f} ms",
+             label, stats.count, mean_ms, to_ms(stats.percentile(0.5)),
+             to_ms(stats.percentile(0.99)), to_ms(stats.max));
+  if ((pixels > 0.0) && (mean_ms > 0.0)) {
+    std::print("  {:8.1f} Mpix/s", pixels / (mean_ms * 1e3));
+  }
+  std::println("");
+}
+
+//-------------------------------------------------------------------------------------------------
+void benchConversion(std::size_t iterations) {
+  printHeader("convertToRGB");
+  for (const auto& resolution : RESOLUTIONS) {
+    const auto pixels =
+        static_cast<double>(resolution.size.width) * static_cast<double>(resolution.size.height);
+    auto rgb = std::vector<std::uint8_t>(static_cast<std::size_t>(pixels) * 3U);
+    for (const auto& format : FORMATS) {
+      const auto source = SyntheticFrame(resolution.size, format.fourcc, format.modifier);
+      for (const auto level : SIMD_LEVELS) {
+        if (not picam::isSupported(level)) {
+          continue;
+        }
+        auto histogram = picam::DurationHistogram{};
+        picam::convertToRGB(source.frame(), rgb, level);  // warm up caches
+        for (std::size_t i = 0; i < iterations; ++i) {
+          const auto timer = picam::ScopedTimer(histogram);
+          picam::convertToRGB(source.frame(), rgb, level);
+        }
+        const auto label = std::format("{} {} {}", resolution.name, format.name, toString(level));
+        printStats(label, histogram.snapshot(), pixels);
+      }
+      // Row bands on the shared worker pool, with the best kernels
+      const auto threads = picam::WorkerPool::shared().concurrency();
+      if (threads > 1) {
+        auto histogram = picam::DurationHistogram{};
+        for (std::size_t i = 0; i < iterations; ++i) {
+          const auto timer = picam::ScopedTimer(histogram);
+          picam::convertToRGB(source.frame(), rgb, picam::bestSimdLevel(), threads);
+        }
+        const auto label = std::format("{} {} {} x{}", resolution.name, format.name,
+                                       toString(picam::bestSimdLevel()), threads);
+        printStats(label, histogram.snapshot(), pixels);
+      }
+      // Kernels selected once for the stream, as by consumers, for each output format
+      for (const auto output : OUTPUT_FORMATS) {
+        const auto converter = picam::PixelConverter(source.frame().header, output);
+        auto converted = std::vector<std::uint8_t>(converter.outputBytes());
+        auto histogram = picam::DurationHistogram{};
+        for (std::size_t i = 0; i < iterations; ++i) {
+          const auto timer = picam::ScopedTimer(histogram);
+          converter.convert(source.frame(), converted, 1);
+        }
+        const auto label = std::format("{} {} -> {}", resolution.name, format.name,
+                                       toString(output));
+        printStats(label, histogram.snapshot(), pixels);
+      }
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// Frame analysis on its own, conversion on its own, and both in one pass, on the shared pool
+void benchAnalysis(std::size_t iterations) {
+  printHeader("FrameAnalyzer");
+  for (const auto& resolution : RESOLUTIONS) {
+    const auto pixels =
+        static_cast<double>(resolution.size.width) * static_cast<double>(resolution.size.height);
+    for (const auto& format : FORMATS) {
+      const auto source = SyntheticFrame(resolution.size, format.fourcc, format.modifier);
+      const auto& frame = source.frame();
+      if (not picam::FrameAnalyzer::supports(frame.header)) {
+        continue;
+      }
+      const auto converter = picam::PixelConverter(frame.header, picam::OutputFormat::Rgb888);
+      auto rgb = std::vector<std::uint8_t>(converter.outputBytes());
+      auto analyzer = picam::FrameAnalyzer({});
+      auto analysis = picam::DurationHistogram{};
+      auto conversion = picam::DurationHistogram{};
+      auto fused = picam::DurationHistogram{};
+      for (std::size_t i = 0; i < iterations; ++i) {
+        {
+          const auto timer = picam::ScopedTimer(analysis);
+          (void)analyzer.analyze(frame);
+        }
+        {
+          const auto timer = picam::ScopedTimer(conversion);
+          converter.convert(frame, rgb);
+        }
+        const auto timer = picam::ScopedTimer(fused);
+        (void)analyzer.analyze(frame, converter, rgb);
+      }
+      const auto label = [&](std::string_view stage) {
+        return std::format("{} {} {}", resolution.name, format.name, stage);
+      };
+      printStats(label("analyze"), analysis.snapshot(), pixels);
+      printStats(label("convert"), conversion.snapshot(), pixels);
+      printStats(label("analyze+convert"), fused.snapshot(), pixels);
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Round trip of a token between two threads, through the given pair of channels
+template <typename Send, typename Receive>
+auto pingPong(std::size_t iterations, Send&& send, Receive&& receive) -> picam::DurationStats {
+  auto histogram = picam::DurationHistogram{};
+  auto peer = std::jthread([&] {
+    for (std::size_t i = 0; i < iterations; ++i) {
+      while (not receive(1)) {
+      }
+      send(0);
+    }
+  });
+  for (std::size_t i = 0; i < iterations; ++i) {
+    const auto start = Clock::now();
+    send(1);
+    while (not receive(0)) {
+    }
+    histogram.record(Clock::now() - start);
+  }
+  return histogram.snapshot();
+}
+
+//-------------------------------------------------------------------------------------------------
+void benchHandoff(std::size_t iterations) {
+  printHeader("Frame handoff (round trip between two threads)");
+  static auto tokens = std::array<int, 2>{};
+
+  {
+    // Mailbox: one atomic pointer per direction, as used by QueuePolicy::LatestOnly
+    auto mailboxes = std::array<std::atomic<int*>, 2>{};
+    const auto send = [&mailboxes](std::size_t to) {
+      mailboxes.at(to).store(&tokens.at(to), std::memory_order_release);
+    };
+    const auto receive = [&mailboxes](std::size_t at) {
+      return mailboxes.at(at).exchange(nullptr, std::memory_order_acquire) != nullptr;
+    };
+    printStats("mailbox (atomic exchange)", pingPong(iterations, send, receive));
+  }
+  {
+    // FIFO: lock-free ring per direction, as used by QueuePolicy::Fifo
+    static constexpr auto QUEUE_DEPTH = 4U;
+    auto queues = std::array<picam::SpscQueue<int*>, 2>{ picam::SpscQueue<int*>(QUEUE_DEPTH),
+                                                         picam::SpscQueue<int*>(QUEUE_DEPTH) };
+    const auto send = [&queues](std::size_t to) { queues.at(to).tryPush(&tokens.at(to)); };
+    const auto receive = [&queues](std::size_t at) { return queues.at(at).tryPop().has_value(); };
+    printStats("fifo (SpscQueue)", pingPong(iterations, send, receive));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void benchDisplay(std::size_t iterations) {
+  printHeader("Display texture update");
+  struct Strategy {
+    std::string_view name;
+    picam::Display::Config config;
+  };
+  const auto strategies = std::array{
+    Strategy{ .name = "GPU YUV conversion",
+              .config = { .import_dmabuf = false,
+                          .gpu_yuv_conversion = true,
+                          .gpu_debayer = true } },
+    Strategy{ .name = "CPU conversion",
+              .config = { .import_dmabuf = false,
+                          .gpu_yuv_conversion = false,
+                          .gpu_debayer = false } },
+  };
+  for (const auto& strategy : strategies) {
+    auto display = picam::Display(strategy.config);
+    for (const auto& resolution : RESOLUTIONS) {
+      for (const auto& format : FORMATS) {
+        const auto source = SyntheticFrame(resolution.size, format.fourcc, format.modifier);
+        const auto before = display.stats();
+        for (std::size_t i = 0; (i < iterations) && display.processEvents(); ++i) {
+          display.update(source.frame());
+          display.present();
+        }
+        // Durations are cumulative. Report the mean over this run only
+        const auto after = display.stats();
+        auto upload = after.upload;
+        upload.count -= before.upload.count;
+        upload.total -= before.upload.total;
+        auto render = after.render;
+        render.count -= before.render.count;
+        render.total -= before.render.total;
+        auto swap = after.swap;
+        swap.count -= before.swap.count;
+        swap.total -= before.swap.total;
+        std::println("{:<20} {:<6} {:<7} upload mean={:7.3f} ms  render mean={:7.3f} ms  "
+                     "swap mean={:7.3f} ms",
+                     strategy.name, resolution.name, format.name,
+                     static_cast<double>(upload.mean().count()) / 1e6,
+                     static_cast<double>(render.mean().count()) / 1e6,
+                     static_cast<double>(swap.mean().count()) / 1e6);
+      }
+    }
+    const auto totals = display.stats();
+    printStats(std::format("{} GPU time", strategy.name), totals.gpu);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void benchCamera(std::size_t iterations) {
+  printHeader("Camera: sensor timestamp to buffer swap");
+  auto display = picam::Display();
+  auto latency = picam::DurationHistogram{};
+  const auto config = picam::Camera::Config{ .camera_name_hint = "imx",
+                                             .image_size = { .width = 1280, .height = 720 } };
+  auto timestamp = picam::SensorClock::time_point{};
+  auto camera = picam::Camera(config, [&display, &timestamp](const picam::ImageFrame& frame) {
+    display.update(frame);
+    timestamp = frame.header.timestamp;
+  });
+
+  static constexpr auto FRAME_TIMEOUT = std::chrono::milliseconds(100);
+  for (std::size_t frames = 0; (frames < iterations) && display.processEvents();) {
+    if (camera.acquire(FRAME_TIMEOUT) && display.present()) {
+      latency.record(picam::SensorClock::now() - timestamp);
+      ++frames;
+    }
+  }
+
+  const auto stats = camera.stats();
+  printStats("exposure start -> swap", latency.snapshot());
+  printStats("completion -> acquire", stats.handover_latency);
+  std::println("frame rate {:.2f} fps, discarded {}, missed {}", stats.frameRate(),
+               stats.drops.discarded, stats.drops.missed);
+}
+
+//-------------------------------------------------------------------------------------------------
+void benchReplay(const std::string& path, std::size_t iterations, bool with_display) {
+  printHeader(std::format("Replay of {}", path));
+  auto recording = picam::FrameDumpReader({ .path = path, .realtime = false, .loop = false }, {});
+  std::println("{} frames", recording.size());
+  if (recording.size() == 0) {
+    return;
+  }
+
+  // Conversion of every recorded frame, cycled through for the requested number of iterations
+  const auto& first = recording.frame(0);
+  const auto pixels =
+      static_cast<double>(first.header.size.width) * static_cast<double>(first.header.size.height);
+  auto rgb = std::vector<std::uint8_t>(static_cast<std::size_t>(pixels) * 3U);
+  const auto count = std::max(iterations, recording.size());
+  for (const auto level : SIMD_LEVELS) {
+    if (not picam::isSupported(level)) {
+      continue;
+    }
+    auto histogram = picam::DurationHistogram{};
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto& frame = recording.frame(i % recording.size());
+      if (not matchesFormat(frame.header, first.header)) {
+        continue;  // Recorded across a reconfiguration; only the first format is measured
+      }
+      const auto timer = picam::ScopedTimer(histogram);
+      picam::convertToRGB(frame, rgb, level);
+    }
+    printStats(std::format("convert {}", toString(level)), histogram.snapshot(), pixels);
+  }
+
+  if (with_display) {
+    auto display = picam::Display();
+    for (std::size_t i = 0; (i < count) && display.processEvents(); ++i) {
+      display.update(recording.frame(i % recording.size()));
+      display.present();
+    }
+    const auto stats = display.stats();
+    printStats("display upload", stats.upload, pixels);
+    printStats("display render", stats.render);
+    printStats("display swap", stats.swap);
+  }
+}
+
+}  // namespace
+
+//-------------------------------------------------------------------------------------------------
+auto main(int argc, char* argv[]) -> int {
+  static constexpr auto DEFAULT_ITERATIONS = std::size_t{ 100 };
+  static constexpr auto HANDOFF_ITERATIONS = std::size_t{ 100'000 };
+  static constexpr auto CAMERA_FRAMES = std::size_t{ 600 };
+
+  auto with_display = false;
+  auto with_camera = false;
+  auto iterations = DEFAULT_ITERATIONS;
+  auto replay_path = std::string{};
+  const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto arg = std::string_view(args[i]);
+    if (arg == "--display") {
+      with_display = true;
+    } else if (arg == "--camera") {
+      with_camera = true;
+    } else if ((arg == "--iterations") && (i + 1 < args.size())) {
+      iterations = std::max<std::size_t>(std::stoul(args[++i]), 1);
+    } else if ((arg == "--replay") && (i + 1 < args.size())) {
+      replay_path = args[++i];
+    } else {
+      std::println(stderr,
+                   "Usage: picam_bench [--iterations N] [--display] [--camera] [--replay <file>]");
+      return 1;
+    }
+  }
+
+  std::println("Best instruction set: {}", toString(picam::bestSimdLevel()));
+  benchConversion(iterations);
+  benchAnalysis(iterations);
+  benchHandoff(HANDOFF_ITERATIONS);
+  if (with_display) {
+    benchDisplay(iterations);
+  }
+  if (with_camera) {
+    benchCamera(std::max(iterations, CAMERA_FRAMES));
+  }
+  if (not replay_path.empty()) {
+    benchReplay(replay_path, iterations, with_display);
+  }
+  return 0;
+}
@@ -3,76 +3,593 @@
 //=================================================================================================
 
 #include "camera.h"
+#include "pixel_convert.h"
 
+#include "spsc_queue.h"
+
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
 #include <mutex>
+#include <optional>
 #include <print>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 #include <libcamera/camera.h>
 #include <libcamera/camera_manager.h>
+#include <libcamera/color_space.h>
+#include <libcamera/control_ids.h>
 #include <libcamera/formats.h>
 #include <libcamera/framebuffer_allocator.h>
 #include <libcamera/libcamera.h>
 #include <libcamera/request.h>
 #include <libcamera/stream.h>
+#include <linux/dma-buf.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+//-------------------------------------------------------------------------------------------------
+auto toColorSpace(const libcamera::ColorSpace& color_space) -> picam::ColorSpace {
+  using Encoding = picam::ColorSpace::Encoding;
+  using Range = picam::ColorSpace::Range;
+  auto result = picam::ColorSpace{};
+  switch (color_space.ycbcrEncoding) {
+    case libcamera::ColorSpace::YcbcrEncoding::Rec709:
+      result.encoding = Encoding::Rec709;
+      break;
+    case libcamera::ColorSpace::YcbcrEncoding::Rec2020:
+      result.encoding = Encoding::Rec2020;
+      break;
+    default:
+      result.encoding = Encoding::Rec601;
+      break;
+  }
+  result.range =
+      (color_space.range == libcamera::ColorSpace::Range::Full) ? Range::Full : Range::Limited;
+  return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// libcamera allows one camera manager per process. Cameras share it, and with it the libcamera
+/// thread that completes their requests. It is stopped when the last reference is released
+auto sharedCameraManager() -> std::shared_ptr<libcamera::CameraManager> {
+  static auto mutex = std::mutex{};
+  static auto instance = std::weak_ptr<libcamera::CameraManager>{};
+  const auto lock = std::scoped_lock(mutex);
+  if (auto manager = instance.lock(); manager) {
+    return manager;
+  }
+  auto started = std::make_unique<libcamera::CameraManager>();
+  if (started->start() != 0) {
+    throw std::runtime_error("Failed to start camera manager");
+  }
+  auto manager = std::shared_ptr<libcamera::CameraManager>(
+      started.release(), [](libcamera::CameraManager* camera_manager) {
+        camera_manager->stop();
+        delete camera_manager;  // NOLINT(cppcoreguidelines-owning-memory)
+      });
+  instance = manager;
+  return manager;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Fail if the camera does not accept a control
+void requireControl(const libcamera::ControlInfoMap& supported, const libcamera::ControlId& id) {
+  if (supported.find(id.id()) == supported.end()) {
+    throw std::invalid_argument(std::format("Camera does not support control {}", id.name()));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Read the capture settings reported in the metadata of a completed request
+auto toCaptureMetadata(const libcamera::ControlList& metadata) -> picam::CaptureMetadata {
+  namespace controls = libcamera::controls;
+  auto result = picam::CaptureMetadata{};
+  if (const auto exposure_time = metadata.get(controls::ExposureTime); exposure_time) {
+    result.exposure_time = std::chrono::microseconds{ *exposure_time };
+  }
+  if (const auto frame_duration = metadata.get(controls::FrameDuration); frame_duration) {
+    result.frame_duration = std::chrono::microseconds{ *frame_duration };
+  }
+  if (const auto analogue_gain = metadata.get(controls::AnalogueGain); analogue_gain) {
+    result.analogue_gain = *analogue_gain;
+  }
+  if (const auto digital_gain = metadata.get(controls::DigitalGain); digital_gain) {
+    result.digital_gain = *digital_gain;
+  }
+  if (const auto colour_temperature = metadata.get(controls::ColourTemperature);
+      colour_temperature) {
+    result.colour_temperature = static_cast<std::uint32_t>(*colour_temperature);
+  }
+  if (const auto lux = metadata.get(controls::Lux); lux) {
+    result.lux = *lux;
+  }
+  if (const auto scaler_crop = metadata.get(controls::ScalerCrop); scaler_crop) {
+    result.scaler_crop = { .x = static_cast<std::uint16_t>(scaler_crop->x),
+                           .y = static_cast<std::uint16_t>(scaler_crop->y),
+                           .width = static_cast<std::uint16_t>(scaler_crop->width),
+                           .height = static_cast<std::uint16_t>(scaler_crop->height) };
+  }
+  return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Camera and stream configuration chosen by an earlier start, see Config::config_cache_path
+struct CachedConfig {
+  struct Stream {
+    std::uint32_t pixel_format{};
+    unsigned int width{};
+    unsigned int height{};
+    unsigned int buffer_count{};
+  };
+  std::string camera_id;
+  std::vector<Stream> streams;
+};
+
+constexpr auto CONFIG_CACHE_VERSION = std::string_view{ "picam-config-cache 1" };
+
+//-------------------------------------------------------------------------------------------------
+/// Describe the parts of the camera config that determine the stream configuration, so that a
+/// cache written for a different config is not used. The camera is named by its id if set, or
+/// else by its name hint
+auto configCacheKey(const picam::Camera::Config& config,
+                    const std::vector<picam::Camera::StreamConfig>& specs) -> std::string {
+  const auto& camera = config.camera_id.empty() ? config.camera_name_hint : config.camera_id;
+  auto key = std::format("{}|{}", camera, config.buffer_count);
+  for (const auto& spec : specs) {
+    key += std::format("|{}:{}x{}:{:08x}", static_cast<int>(spec.role), spec.image_size.width,
+                       spec.image_size.height, spec.pixel_format);
+  }
+  return key;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return Cached configuration, or nothing if the file is missing, malformed or for another key
+auto loadConfigCache(const std::string& path, const std::string& key)
+    -> std::optional<CachedConfig> {
+  auto file = std::ifstream(path);
+  auto line = std::string{};
+  if ((not std::getline(file, line)) || (line != CONFIG_CACHE_VERSION)) {
+    return std::nullopt;
+  }
+  if ((not std::getline(file, line)) || (line != "key " + key)) {
+    return std::nullopt;
+  }
+  if ((not std::getline(file, line)) || (not line.starts_with("camera "))) {
+    return std::nullopt;
+  }
+  auto cached = CachedConfig{ .camera_id = line.substr(line.find(' ') + 1), .streams = {} };
+  while (std::getline(file, line)) {
+    auto fields = std::istringstream(line);
+    auto tag = std::string{};
+    auto stream = CachedConfig::Stream{};
+    fields >> tag >> std::hex >> stream.pixel_format >> std::dec >> stream.width >> stream.height >>
+        stream.buffer_count;
+    if (fields.fail() || (tag != "stream")) {
+      return std::nullopt;
+    }
+    cached.streams.push_back(stream);
+  }
+  return cached;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Persist a validated configuration. Written to a temporary file and renamed, so that a crash
+/// never leaves a truncated cache. Failure only costs the next start its shortcut, so it is not
+/// an error
+void saveConfigCache(const std::string& path, const std::string& key, const std::string& camera_id,
+                     const libcamera::CameraConfiguration& config) {
+  const auto temp_path = path + ".tmp";
+  {
+    auto file = std::ofstream(temp_path, std::ios::trunc);
+    std::print(file, "{}\nkey {}\ncamera {}\n", CONFIG_CACHE_VERSION, key, camera_id);
+    for (const auto& stream_config : config) {
+      std::print(file, "stream {:x} {} {} {}\n", stream_config.pixelFormat.fourcc(),
+                 stream_config.size.width, stream_config.size.height, stream_config.bufferCount);
+    }
+    if (not file.flush()) {
+      std::println(stderr, "Failed to write camera configuration cache {}", temp_path);
+      return;
+    }
+  }
+  auto error = std::error_code{};
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    std::println(stderr, "Failed to write camera configuration cache {}: {}", path,
+                 error.message());
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+/// What capture buffers of a stream depend on. Buffers can be kept across reconfigurations that
+/// leave it unchanged
+struct BufferGeometry {
+  std::uint32_t pixel_format{};
+  unsigned int width{};
+  unsigned int height{};
+  unsigned int stride{};
+  unsigned int frame_size{};
+  unsigned int buffer_count{};
+  constexpr auto operator==(const BufferGeometry&) const -> bool = default;
+};
+
+//-------------------------------------------------------------------------------------------------
+auto bufferGeometry(const libcamera::StreamConfiguration& stream_config) -> BufferGeometry {
+  return { .pixel_format = stream_config.pixelFormat.fourcc(),
+           .width = stream_config.size.width,
+           .height = stream_config.size.height,
+           .stride = stream_config.stride,
+           .frame_size = stream_config.frameSize,
+           .buffer_count = stream_config.bufferCount };
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return Streams to configure: the configured streams, or a single viewfinder stream
+auto streamSpecs(const picam::Camera::Config& config) -> std::vector<picam::Camera::StreamConfig> {
+  if (not config.streams.empty()) {
+    return config.streams;
+  }
+  return { { .role = picam::Camera::StreamRole::Viewfinder,
+             .image_size = config.image_size,
+             .crop = config.crop,
+             .pixel_format = 0,
+             .callback = nullptr } };
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return Cached configuration for a camera config, or nothing if caching is disabled or the
+/// cache does not match
+auto loadConfigCache(const picam::Camera::Config& config,
+                     const std::vector<picam::Camera::StreamConfig>& specs)
+    -> std::optional<CachedConfig> {
+  if (config.config_cache_path.empty()) {
+    return std::nullopt;
+  }
+  return loadConfigCache(config.config_cache_path, configCacheKey(config, specs));
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toStreamRole(picam::Camera::StreamRole role) -> libcamera::StreamRole {
+  switch (role) {
+    case picam::Camera::StreamRole::VideoRecording:
+      return libcamera::StreamRole::VideoRecording;
+    case picam::Camera::StreamRole::StillCapture:
+      return libcamera::StreamRole::StillCapture;
+    case picam::Camera::StreamRole::Raw:
+      return libcamera::StreamRole::Raw;
+    default:
+      return libcamera::StreamRole::Viewfinder;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Find size closest to target resolution by minimizing total pixel difference
+auto closestSize(const std::vector<libcamera::Size>& sizes, const picam::ImageSize& target)
+    -> libcamera::Size {
+  auto best_size = sizes.at(0);
+  auto best_score = std::numeric_limits<int>::max();
+  for (const auto& size : sizes) {
+    const auto score = std::abs(static_cast<int>(size.width) - static_cast<int>(target.width)) +
+                       std::abs(static_cast<int>(size.height) - static_cast<int>(target.height));
+    if (score < best_score) {
+      best_score = score;
+      best_size = size;
+    }
+  }
+  return best_size;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Geometry of the colour planes of a pixel format
+struct PlaneLayout {
+  std::uint32_t count{ 1 };
+  std::array<std::uint32_t, picam::ImageFrame::MAX_PLANES> stride_divisor{ 1, 1, 1 };
+  std::array<std::uint32_t, picam::ImageFrame::MAX_PLANES> height_divisor{ 1, 1, 1 };
+};
+
+//-------------------------------------------------------------------------------------------------
+auto planeLayout(const libcamera::PixelFormat& pixel_format) -> PlaneLayout {
+  if ((pixel_format == libcamera::formats::NV12) || (pixel_format == libcamera::formats::NV21)) {
+    // Full width interleaved chroma at half height
+    return { .count = 2, .stride_divisor = { 1, 1, 1 }, .height_divisor = { 1, 2, 2 } };
+  }
+  if ((pixel_format == libcamera::formats::YUV420) ||
+      (pixel_format == libcamera::formats::YVU420)) {
+    // Chroma planes at half width and half height
+    return { .count = 3, .stride_divisor = { 1, 2, 2 }, .height_divisor = { 1, 2, 2 } };
+  }
+  return {};
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Software crop of a stream: a window into each plane of its capture buffers, at the pitch of
+/// the buffer
+struct CropView {
+  picam::ImageSize size;
+  std::array<std::size_t, picam::ImageFrame::MAX_PLANES> offsets{};  // First byte of the window
+  std::array<std::size_t, picam::ImageFrame::MAX_PLANES> lengths{};  // First to last byte
+};
+
+//-------------------------------------------------------------------------------------------------
+auto cropView(const libcamera::StreamConfiguration& stream_config, const picam::ImageRect& crop)
+    -> CropView {
+  const auto& size = stream_config.size;
+  if ((crop.width == 0) || (crop.height == 0) || (crop.x + crop.width > size.width) ||
+      (crop.y + crop.height > size.height)) {
+    throw std::invalid_argument(std::format("Crop {}x{} at ({}, {}) is outside the {}x{} image",
+                                            crop.width, crop.height, crop.x, crop.y, size.width,
+                                            size.height));
+  }
+
+  // Columns of the first plane are stored in groups of pixels (e.g. the two pixels of a YUYV
+  // macropixel, the four samples of a CSI-2 10-bit group). The crop must start on a group, and
+  // on an even row for vertically subsampled chroma and to keep the Bayer order
+  const auto& pixel_format = stream_config.pixelFormat;
+  auto group_pixels = 1U;
+  auto group_bytes = 0U;
+  auto row_alignment = 1U;
+  if ((pixel_format == libcamera::formats::RGB888) ||
+      (pixel_format == libcamera::formats::BGR888)) {
+    group_bytes = 3;
+  } else if ((pixel_format == libcamera::formats::YUYV) ||
+             (pixel_format == libcamera::formats::UYVY)) {
+    group_pixels = 2;
+    group_bytes = 4;
+  } else if (planeLayout(pixel_format).count > 1) {
+    group_pixels = 2;  // Luma bytes of a pair of pixels sharing chroma
+    group_bytes = 2;
+    row_alignment = 2;
+  } else if (const auto bayer = picam::bayerFormat(pixel_format.fourcc(), pixel_format.modifier());
+             bayer) {
+    group_pixels = 2;
+    group_bytes = bayer->rowBytes(2);
+    if ((bayer->packing == picam::BayerFormat::Packing::Csi2) && (bayer->bit_depth == 10)) {
+      group_pixels = 4;
+      group_bytes = bayer->rowBytes(4);
+    }
+    row_alignment = 2;
+  } else {
+    throw std::invalid_argument(
+        std::format("Software crop not supported for pixel format {}", pixel_format.toString()));
+  }
+  if (((crop.x % group_pixels) != 0) || ((crop.y % row_alignment) != 0)) {
+    throw std::invalid_argument(std::format("Crop origin must be a multiple of {} columns and {} "
+                                            "rows for pixel format {}",
+                                            group_pixels, row_alignment, pixel_format.toString()));
+  }
+
+  const auto bytes = [&](std::size_t pixels) {
+    return (pixels + group_pixels - 1) / group_pixels * group_bytes;
+  };
+  const auto layout = planeLayout(pixel_format);
+  auto view = CropView{ .size = { .width = crop.width, .height = crop.height } };
+  for (std::uint32_t p = 0; p < layout.count; ++p) {
+    const auto stride = std::size_t{ stream_config.stride / layout.stride_divisor.at(p) };
+    const auto height_divisor = layout.height_divisor.at(p);
+    const auto first_row = crop.y / height_divisor;
+    const auto rows = ((crop.y + crop.height + height_divisor - 1) / height_divisor) - first_row;
+    view.offsets.at(p) = (first_row * stride) + (bytes(crop.x) / layout.stride_divisor.at(p));
+    view.lengths.at(p) = ((rows - 1) * stride) + (bytes(crop.width) / layout.stride_divisor.at(p));
+  }
+  return view;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Bracket CPU access to a dmabuf, keeping cached mappings coherent with device writes
+void syncDmaBuf(int fd, std::uint64_t flags) {
+  auto sync = dma_buf_sync{ .flags = flags };
+  while ((ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) != 0) && (errno == EINTR)) {
+  }
+}
+
+}  // namespace
 
 namespace picam {
 
+//-------------------------------------------------------------------------------------------------
+struct FrameHandle::Slot {
+  libcamera::Request* request{ nullptr };
+  Camera::Impl* owner{ nullptr };
+  SensorClock::time_point completion_time;  // Written by the libcamera thread before handover
+  std::atomic_uint32_t references{ 0 };
+  std::uint64_t controls_id{};     // Newest control change queued, written when queued
+  std::vector<ImageFrame> frames;  // One per stream
+
+  /// Capture buffer of one stream, with dmabuf views of its planes resolved at setup. CPU views
+  /// are added once the buffer is mapped
+  struct Buffer {
+    libcamera::FrameBuffer* buffer{ nullptr };
+    std::array<ImageFrame::Plane, ImageFrame::MAX_PLANES> planes{};
+    std::array<std::size_t, ImageFrame::MAX_PLANES> plane_lengths{};
+    std::uint32_t plane_count{};
+    bool is_split{ false };  // Colour planes reported by the pipeline as one contiguous plane
+
+    // Distinct dmabufs backing the planes
+    std::array<int, ImageFrame::MAX_PLANES> dmabuf_fds{ -1, -1, -1 };
+    std::uint32_t dmabuf_count{};
+
+    bool is_mapped{ false };                // Guarded by Camera::Impl::mapping_mutex
+    std::atomic_bool cpu_access{ false };  // Between DMA_BUF_SYNC_START and DMA_BUF_SYNC_END
+  };
+  std::vector<Buffer> buffers;  // One per stream
+};
+
 //-------------------------------------------------------------------------------------------------
 struct Camera::Impl {
   Camera::Callback callback{ nullptr };
+  QueuePolicy queue_policy{ QueuePolicy::LatestOnly };
+  OverflowPolicy overflow_policy{ OverflowPolicy::DropOldest };
 
   // Core libcamera objects
-  std::unique_ptr<libcamera::CameraManager> camera_manager;
+  std::shared_ptr<libcamera::CameraManager> camera_manager;
   std::shared_ptr<libcamera::Camera> camera;
   std::unique_ptr<libcamera::CameraConfiguration> config;
   std::unique_ptr<libcamera::FrameBufferAllocator> allocator;
+  std::vector<std::pair<libcamera::Stream*, BufferGeometry>> allocated_streams;
   std::vector<std::unique_ptr<libcamera::Request>> requests;
+  std::vector<FrameHandle::Slot> slots;  // indexed by request cookie
+
+  // Configured streams, in the order of Camera::Config::streams
+  struct StreamState {
+    libcamera::Stream* stream{ nullptr };
+    ColorSpace color_space;
+    Camera::Callback callback;
+    std::optional<CropView> crop;
+  };
+  std::vector<StreamState> streams;
 
-  libcamera::Stream* stream = nullptr;
-  std::map<int, std::pair<void*, unsigned int>> mapped_buffers;
+  // CPU mappings of all capture buffers, released on destruction
+  struct Mapping {
+    void* memory{ nullptr };
+    std::size_t length{};
+  };
+  MappingPolicy mapping_policy{ MappingPolicy::Eager };
+  std::mutex mapping_mutex;  // Serialises lazy mapping from threads holding frame handles
+  std::vector<Mapping> mappings;
 
+  // Completed requests waiting for the consumer. Mailbox for LatestOnly, FIFO otherwise
   std::atomic<libcamera::Request*> latest_request{ nullptr };
+  std::unique_ptr<SpscQueue<libcamera::Request*>> completed_requests;
+
+  // Drop accounting. Written only from the libcamera completion thread
+  std::atomic_uint64_t discarded_frames{ 0 };
+  std::atomic_uint64_t missed_frames{ 0 };
+  std::optional<std::uint32_t> last_sequence;
+
+  // Instrumentation
+  std::atomic_uint64_t completed_count{ 0 };
+  std::atomic_uint64_t cancelled_count{ 0 };
+  std::atomic_uint64_t delivered_count{ 0 };
+  DurationHistogram frame_interval;
+  DurationHistogram handover_latency;
+  std::optional<SensorClock::time_point> last_completion;  // libcamera completion thread only
 
   std::atomic_bool camera_started{ false };
 
+  // Startup
+  bool verbose{ true };
+  SensorClock::time_point start_time;
+  std::atomic_int64_t time_to_first_frame{ 0 };  // Nanoseconds, 0 until the first completion
+
+  // Control changes waiting for the next queued request. Auto exposure of exposure time and of
+  // gain are separate modes (libcamera >= 0.5), resolved when changes are merged
+  struct PendingControls {
+    Controls values;
+    std::optional<bool> auto_exposure_time;
+    std::optional<bool> auto_analogue_gain;
+  };
+  std::mutex controls_mutex;  // Guards pending_controls and last_controls_id
+  PendingControls pending_controls;
+  std::uint64_t last_controls_id{ 0 };
+  std::atomic_bool controls_pending{ false };     // Lets queueRequest skip the lock
+  std::atomic_uint64_t queued_controls_id{ 0 };  // Newest change attached to a request
+
+  // Applied from the libcamera completion thread, which only exists once capture runs
+  ThreadConfig completion_thread;
+  std::once_flag completion_thread_configured;
+
+  // Signalled on every completed request so that consumers can sleep until a frame is pending
+  int event_fd{ -1 };
+
+  // Informational output, suppressed unless Config::verbose
+  template <typename... Args>
+  void log(std::format_string<Args...> fmt, Args&&... args) const {
+    if (verbose) {
+      std::println(fmt, std::forward<Args>(args)...);
+    }
+  }
+
   // Setup methods
-  void setupCamera(const std::string& name_hint);
-  void configureStream(const ImageSize& image_size);
-  void allocateBuffers();
+  void applyPolicies(const Config& camera_config);
+  void setupCamera(const std::string& name_hint, const std::string& camera_id,
+                   const std::string& cached_id);
+  void startStreams(const Config& camera_config, const std::vector<StreamConfig>& specs,
+                    const CachedConfig* cached);
+  auto configureStreams(const std::vector<StreamConfig>& specs, std::uint32_t buffer_count,
+                        const CachedConfig* cached) -> bool;
+  void generateConfiguration(const std::vector<StreamConfig>& specs);
+  auto useCachedFormats(const std::vector<StreamConfig>& specs, const CachedConfig& cached)
+      -> bool;
+  void selectFormats(const std::vector<StreamConfig>& specs, std::uint32_t buffer_count);
+  void mapBuffers();
+  void allocateBuffers(std::uint32_t queue_depth);
   void createRequests();
   void startCapture();
+  void stopCapture();
+  void releaseRequests();
+  void shutdown();
 
   // Runtime methods
   void processRequest(libcamera::Request* request);
   void requestComplete(libcamera::Request* request);
   auto queueRequest(libcamera::Request* request) -> int;
+  void validateControls(const Controls& controls) const;
+  static void mergeControls(PendingControls& pending, const Controls& controls);
+  static void applyControls(const PendingControls& pending, libcamera::ControlList& list);
+  void requeue(libcamera::Request* request);
+  auto takeRequest() -> libcamera::Request*;
+  auto makeFrames(libcamera::Request* request) -> FrameHandle::Slot*;
+  static void describeBuffer(const libcamera::StreamConfiguration& stream_config,
+                             FrameHandle::Slot::Buffer& view);
+  void mapBuffer(FrameHandle::Slot::Buffer& view);
+  auto mapForCpu(FrameHandle::Slot& slot, std::size_t stream) -> const ImageFrame&;
+  static void beginCpuAccess(FrameHandle::Slot::Buffer& view, const std::optional<CropView>& crop,
+                             ImageFrame& frame);
+  void release(FrameHandle::Slot& slot);
+  void deliver(const FrameHandle& handle) const;
+  void countMissedFrames(const libcamera::Request* request);
+  void notifyFrame() const;
+  void clearNotification() const;
+  [[nodiscard]] auto waitForFrame(std::chrono::milliseconds timeout) const -> bool;
 };
 
 //-------------------------------------------------------------------------------------------------
-void Camera::Impl::setupCamera(const std::string& name_hint) {
-  camera_manager = std::make_unique<libcamera::CameraManager>();
-  if (camera_manager->start() != 0) {
-    throw std::runtime_error("Failed to start camera manager");
-  }
+void Camera::Impl::setupCamera(const std::string& name_hint, const std::string& camera_id,
+                               const std::string& cached_id) {
+  camera_manager = sharedCameraManager();
 
-  auto cameras = camera_manager->cameras();
-  if (cameras.empty()) {
-    throw std::runtime_error("No cameras found");
+  if (not camera_id.empty()) {
+    camera = camera_manager->get(camera_id);
+    if (not camera) {
+      throw std::runtime_error(std::format("Camera {} not found", camera_id));
+    }
+  } else if (not cached_id.empty()) {
+    // The camera chosen last time, unless it has gone
+    camera = camera_manager->get(cached_id);
   }
-  std::println("Found {} camera{}", cameras.size(), cameras.size() > 1 ? "s" : "");
 
   std::string camera_name;
-  camera = cameras[0];
-  for (const auto& cam : cameras) {
-    const auto& props = cam->properties();
-    const auto& model = props.get(libcamera::properties::Model);
-    const auto& id = cam->id();
-    std::println("{}\t({})", (model ? *model : "NoName"), id);
-    if (model && !name_hint.empty() && (model->find(name_hint) != std::string::npos)) {
-      camera = cam;
-      camera_name = *model;
+  if (not camera) {
+    auto cameras = camera_manager->cameras();
+    if (cameras.empty()) {
+      throw std::runtime_error("No cameras found");
+    }
+    log("Found {} camera{}", cameras.size(), cameras.size() > 1 ? "s" : "");
+
+    camera = cameras[0];
+    for (const auto& cam : cameras) {
+      const auto& props = cam->properties();
+      const auto& model = props.get(libcamera::properties::Model);
+      const auto& id = cam->id();
+      log("{}\t({})", (model ? *model : "NoName"), id);
+      if (model && !name_hint.empty() && (model->find(name_hint) != std::string::npos)) {
+        camera = cam;
+        camera_name = *model;
+      }
     }
   }
   if (camera_name.empty()) {
@@ -80,7 +597,7 @@ void Camera::Impl::setupCamera(const std::string& name_hint) {
     const auto& model = props.get(libcamera::properties::Model);
     camera_name = model ? *model : "Unknown";
   }
-  std::println("Opening camera: {} ({})", camera_name, camera->id());
+  log("Opening camera: {} ({})", camera_name, camera->id());
 
   if (camera->acquire() != 0) {
     throw std::runtime_error("Failed to acquire camera");
@@ -88,44 +605,139 @@ void Camera::Impl::setupCamera(const std::string& name_hint) {
 }
 
 //-------------------------------------------------------------------------------------------------
-void Camera::Impl::configureStream(const ImageSize& image_size) {
-  config = camera->generateConfiguration({ libcamera::StreamRole::Viewfinder });
-  if ((not config) || config->empty()) {
+auto Camera::Impl::configureStreams(const std::vector<StreamConfig>& specs,
+                                    std::uint32_t buffer_count, const CachedConfig* cached)
+    -> bool {
+  const auto from_cache = (cached != nullptr) && useCachedFormats(specs, *cached);
+  if (not from_cache) {
+    selectFormats(specs, buffer_count);
+  }
+
+  // Apply configuration
+  if (camera->configure(config.get()) != 0) {
+    throw std::runtime_error("Failed to configure camera");
+  }
+
+  // Log the actual configuration that was applied
+  streams.resize(specs.size());
+  for (std::size_t i = 0; i < specs.size(); ++i) {
+    const auto& final_config = config->at(static_cast<unsigned int>(i));
+    log("Stream {} configured format: {}x{}, {}", i, final_config.size.width,
+        final_config.size.height, final_config.pixelFormat.toString());
+
+    auto& state = streams[i];
+    if (final_config.colorSpace) {
+      state.color_space = toColorSpace(*final_config.colorSpace);
+      log("Stream {} configured colour space: {}", i, final_config.colorSpace->toString());
+    }
+    state.stream = final_config.stream();
+    state.callback = specs[i].callback ? specs[i].callback : callback;
+    state.crop.reset();
+    if (specs[i].crop) {
+      state.crop = cropView(final_config, *specs[i].crop);
+      log("Stream {} cropped to {}x{} at ({}, {})", i, specs[i].crop->width,
+          specs[i].crop->height, specs[i].crop->x, specs[i].crop->y);
+    }
+  }
+  return from_cache;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::generateConfiguration(const std::vector<StreamConfig>& specs) {
+  auto roles = std::vector<libcamera::StreamRole>{};
+  roles.reserve(specs.size());
+  for (const auto& spec : specs) {
+    roles.push_back(toStreamRole(spec.role));
+  }
+  config = camera->generateConfiguration(roles);
+  if ((not config) || (config->size() != specs.size())) {
     throw std::runtime_error("Failed to generate camera configuration");
   }
-  libcamera::StreamConfiguration& stream_config = config->at(0);
-
-  std::println("Supported formats:");
-  for (const auto& fmt : stream_config.formats().pixelformats()) {
-    const auto& sizes = stream_config.formats().sizes(fmt);
-    for (const auto& size : sizes) {
-      std::println("  {}x{}, {}", size.width, size.height, fmt.toString());
-    }
-  }
-  // specify desired formats in order of preference, let the camera select one
-  // @note: NV12 seems to be broken on the pi
-  // @note: Add other formats in the list as needed
-  const auto desired_formats = std::array{ libcamera::formats::RGB888, libcamera::formats::YUYV };
-  for (const auto& fmt : desired_formats) {
-    const auto& sizes = stream_config.formats().sizes(fmt);
-    if (not sizes.empty()) {
-      stream_config.pixelFormat = fmt;
-      // Find size closest to target resolution by minimizing total pixel difference
-      auto best_size = sizes[0];
-      auto best_score = std::numeric_limits<int>::max();
-      for (const auto& size : sizes) {
-        const auto score =
-            std::abs(static_cast<int>(size.width) - static_cast<int>(image_size.width)) +
-            std::abs(static_cast<int>(size.height) - static_cast<int>(image_size.height));
-        if (score < best_score) {
-          best_score = score;
-          best_size = size;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::Impl::useCachedFormats(const std::vector<StreamConfig>& specs,
+                                    const CachedConfig& cached) -> bool {
+  if ((cached.camera_id != camera->id()) || (cached.streams.size() != specs.size())) {
+    return false;
+  }
+  generateConfiguration(specs);
+  for (std::size_t i = 0; i < specs.size(); ++i) {
+    const auto& stream = cached.streams[i];
+    auto& stream_config = config->at(static_cast<unsigned int>(i));
+    stream_config.pixelFormat = libcamera::PixelFormat(stream.pixel_format);
+    stream_config.size = libcamera::Size{ stream.width, stream.height };
+    stream_config.bufferCount = stream.buffer_count;
+  }
+
+  // Anything but an exact match means the camera or pipeline changed since the cache was written
+  if (config->validate() != libcamera::CameraConfiguration::Valid) {
+    log("Cached camera configuration is stale, searching formats");
+    return false;
+  }
+  log("Using cached camera configuration");
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::selectFormats(const std::vector<StreamConfig>& specs,
+                                 std::uint32_t buffer_count) {
+  generateConfiguration(specs);
+
+  for (std::size_t i = 0; i < specs.size(); ++i) {
+    const auto& spec = specs[i];
+    libcamera::StreamConfiguration& stream_config = config->at(static_cast<unsigned int>(i));
+    const auto& formats = stream_config.formats();
+
+    if (verbose) {
+      std::println("Stream {} supported formats:", i);
+      for (const auto& fmt : formats.pixelformats()) {
+        for (const auto& size : formats.sizes(fmt)) {
+          std::println("  {}x{}, {}", size.width, size.height, fmt.toString());
         }
       }
-      stream_config.size = best_size;
-      std::println("Closest match to target resolution({}x{}): {}x{}, {}", image_size.width,
-                   image_size.height, best_size.width, best_size.height, fmt.toString());
-      break;
+    }
+
+    // specify desired formats in order of preference, let the camera select one
+    // @note: NV12 is the native ISP output on the pi and half the size of RGB888
+    // @note: Add other formats in the list as needed
+    // @note: Raw streams prefer Bayer formats that pixel_convert and Display can unpack, starting
+    // with the sensor format chosen by the pipeline
+    auto desired_formats = std::vector<libcamera::PixelFormat>{};
+    if (spec.pixel_format != 0) {
+      desired_formats.emplace_back(spec.pixel_format);
+    }
+    if (spec.role != StreamRole::Raw) {
+      desired_formats.push_back(libcamera::formats::NV12);
+      desired_formats.push_back(libcamera::formats::RGB888);
+      desired_formats.push_back(libcamera::formats::YUYV);
+      desired_formats.push_back(libcamera::formats::YUV420);
+    } else {
+      const auto is_decodable = [](const libcamera::PixelFormat& fmt) {
+        return bayerFormat(fmt.fourcc(), fmt.modifier()).has_value();
+      };
+      if (is_decodable(stream_config.pixelFormat)) {
+        desired_formats.push_back(stream_config.pixelFormat);
+      }
+      std::ranges::copy_if(formats.pixelformats(), std::back_inserter(desired_formats),
+                           is_decodable);
+    }
+    desired_formats.push_back(stream_config.pixelFormat);
+
+    for (const auto& fmt : desired_formats) {
+      const auto& sizes = formats.sizes(fmt);
+      if (not sizes.empty()) {
+        stream_config.pixelFormat = fmt;
+        stream_config.size = closestSize(sizes, spec.image_size);
+        log("Closest match to target resolution({}x{}): {}x{}, {}", spec.image_size.width,
+            spec.image_size.height, stream_config.size.width, stream_config.size.height,
+            fmt.toString());
+        break;
+      }
+    }
+
+    if (buffer_count != 0) {
+      stream_config.bufferCount = buffer_count;
     }
   }
 
@@ -135,60 +747,238 @@ void Camera::Impl::configureStream(const ImageSize& image_size) {
     throw std::runtime_error("Invalid camera configuration");
   }
   if (validation == libcamera::CameraConfiguration::Adjusted) {
-    std::println("Camera configuration was adjusted by libcamera");
+    log("Camera configuration was adjusted by libcamera");
   }
+}
 
-  // Apply configuration
-  if (camera->configure(config.get()) != 0) {
-    throw std::runtime_error("Failed to configure camera");
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::allocateBuffers(std::uint32_t queue_depth) {
+  if (not allocator) {
+    allocator = std::make_unique<libcamera::FrameBufferAllocator>(camera);
   }
 
-  // Log the actual configuration that was applied
-  const auto& final_config = config->at(0);
-  std::println("Configured format: {}x{}, {}", final_config.size.width, final_config.size.height,
-               final_config.pixelFormat.toString());
+  // After a reconfiguration, keep the buffers of streams whose geometry did not change
+  const auto is_unchanged = [this](const auto& allocated) {
+    return std::ranges::any_of(streams, [&allocated](const StreamState& state) {
+      return (state.stream == allocated.first) &&
+             (bufferGeometry(state.stream->configuration()) == allocated.second);
+    });
+  };
+  for (const auto& allocated : allocated_streams) {
+    if (not is_unchanged(allocated)) {
+      allocator->free(allocated.first);
+    }
+  }
+  std::erase_if(allocated_streams, [&is_unchanged](const auto& allocated) {
+    return not is_unchanged(allocated);
+  });
 
-  stream = config->at(0).stream();
-}
+  // Every request carries one buffer of each stream, so the stream with the fewest buffers
+  // limits the number of requests
+  auto buffers = std::numeric_limits<std::uint32_t>::max();
+  for (std::size_t i = 0; i < streams.size(); ++i) {
+    auto* const stream = streams[i].stream;
+    const auto is_allocated = std::ranges::any_of(
+        allocated_streams, [stream](const auto& allocated) { return allocated.first == stream; });
+    auto count = allocator->buffers(stream).size();
+    if (is_allocated) {
+      log("Stream {}: reusing {} buffers", i, count);
+    } else {
+      const int ret = allocator->allocate(stream);
+      if (ret <= 0) {
+        throw std::runtime_error("Failed to allocate buffers");
+      }
+      log("Stream {}: allocated {} buffers", i, ret);
+      count = static_cast<std::size_t>(ret);
+      allocated_streams.emplace_back(stream, bufferGeometry(stream->configuration()));
+    }
+    buffers = std::min(buffers, static_cast<std::uint32_t>(count));
+  }
 
-//-------------------------------------------------------------------------------------------------
-void Camera::Impl::allocateBuffers() {
-  allocator = std::make_unique<libcamera::FrameBufferAllocator>(camera);
+  completed_requests.reset();
 
-  const int ret = allocator->allocate(stream);
-  if (ret < 0) {
-    throw std::runtime_error("Failed to allocate buffers");
+  if (queue_policy == QueuePolicy::Fifo) {
+    // Holding every buffer is what makes BlockProducer block. DropOldest leaves at least one
+    // buffer with the camera so capture never stalls
+    auto depth = buffers;
+    if (overflow_policy == OverflowPolicy::DropOldest) {
+      depth = (queue_depth != 0) ? std::min(queue_depth, buffers - 1) : buffers - 1;
+    }
+    completed_requests = std::make_unique<SpscQueue<libcamera::Request*>>(std::max(depth, 1U));
+    log("Frame queue depth: {}", completed_requests->capacity());
   }
-
-  std::println("Allocated {} buffers", ret);
 }
 
 //-------------------------------------------------------------------------------------------------
 void Camera::Impl::createRequests() {
-  const auto& stream_buffers = allocator->buffers(stream);
+  auto request_count = std::numeric_limits<std::size_t>::max();
+  for (const auto& state : streams) {
+    request_count = std::min(request_count, allocator->buffers(state.stream).size());
+  }
 
-  for (const auto& buffer : stream_buffers) {
-    auto request = camera->createRequest();
+  // Everything needed to describe a completed request is resolved here, once, and looked up by
+  // request cookie at runtime
+  slots = std::vector<FrameHandle::Slot>(request_count);
+  for (std::size_t index = 0; index < request_count; ++index) {
+    // Cookie indexes per-request state
+    auto request = camera->createRequest(requests.size());
     if (not request) {
       throw std::runtime_error("Failed to create request");
     }
 
-    if (request->addBuffer(stream, buffer.get()) != 0) {
-      throw std::runtime_error("Failed to add buffer to request");
+    auto& slot = slots[index];
+    slot.request = request.get();
+    slot.owner = this;
+    slot.frames.resize(streams.size());
+    slot.buffers = std::vector<FrameHandle::Slot::Buffer>(streams.size());
+    for (std::size_t i = 0; i < streams.size(); ++i) {
+      const auto& state = streams[i];
+      const auto& buffer = allocator->buffers(state.stream).at(index);
+      if (request->addBuffer(state.stream, buffer.get()) != 0) {
+        throw std::runtime_error("Failed to add buffer to request");
+      }
+      slot.buffers[i].buffer = buffer.get();
+      describeBuffer(state.stream->configuration(), slot.buffers[i]);
     }
 
-    // Map buffer memory
-    for (const auto& plane : buffer->planes()) {
-      // NOLINTNEXTLINE(misc-const-correctness)
-      void* const memory = mmap(nullptr, plane.length, PROT_READ, MAP_SHARED, plane.fd.get(), 0);
-      if (memory == MAP_FAILED) {
-        throw std::runtime_error("Failed to map buffer memory");
+    requests.push_back(std::move(request));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::describeBuffer(const libcamera::StreamConfiguration& stream_config,
+                                  FrameHandle::Slot::Buffer& view) {
+  const auto& buffer_planes = view.buffer->planes();
+  const auto layout = planeLayout(stream_config.pixelFormat);
+  if (buffer_planes.empty() ||
+      ((buffer_planes.size() != 1) && (buffer_planes.size() != layout.count))) {
+    throw std::runtime_error("Unexpected plane layout in capture buffer");
+  }
+
+  // Planes of multi-planar formats usually share one dmabuf at different offsets
+  for (const auto& plane : buffer_planes) {
+    const auto fds = std::span(view.dmabuf_fds).first(view.dmabuf_count);
+    if (std::ranges::find(fds, plane.fd.get()) == fds.end()) {
+      view.dmabuf_fds.at(view.dmabuf_count++) = plane.fd.get();
+    }
+  }
+
+  // Older pipelines report all colour planes as a single contiguous plane. Split it up
+  view.is_split = (buffer_planes.size() == 1) && (layout.count > 1);
+  view.plane_count = layout.count;
+  const auto height = static_cast<std::size_t>(stream_config.size.height);
+  auto split_offset = std::size_t{ 0 };
+  for (std::uint32_t p = 0; p < layout.count; ++p) {
+    const auto& source = buffer_planes[view.is_split ? 0 : p];
+    auto& plane = view.planes.at(p);
+    auto& length = view.plane_lengths.at(p);
+    plane.stride = stream_config.stride / layout.stride_divisor.at(p);
+    plane.fd = source.fd.get();
+    plane.offset = source.offset;
+    length = source.length;
+    if (view.is_split) {
+      length = plane.stride * (height / layout.height_divisor.at(p));
+      if (split_offset + length > source.length) {
+        throw std::runtime_error("Capture buffer too small for its pixel format");
       }
-      mapped_buffers[plane.fd.get()] = std::make_pair(memory, plane.length);
+      plane.offset += static_cast<std::uint32_t>(split_offset);
+      split_offset += length;
     }
+  }
+}
 
-    requests.push_back(std::move(request));
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::mapBuffer(FrameHandle::Slot::Buffer& view) {
+  if (view.is_mapped) {
+    return;
+  }
+
+  // Map each dmabuf once, spanning all of its planes
+  auto memory = std::array<std::byte*, ImageFrame::MAX_PLANES>{};
+  for (std::uint32_t i = 0; i < view.dmabuf_count; ++i) {
+    const auto fd = view.dmabuf_fds.at(i);
+    auto extent = std::size_t{ 0 };
+    for (std::uint32_t p = 0; p < view.plane_count; ++p) {
+      if (view.planes.at(p).fd == fd) {
+        extent = std::max(extent, view.planes.at(p).offset + view.plane_lengths.at(p));
+      }
+    }
+    // NOLINTNEXTLINE(misc-const-correctness)
+    void* const mapped = mmap(nullptr, extent, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      throw std::runtime_error("Failed to map buffer memory");
+    }
+    mappings.push_back({ .memory = mapped, .length = extent });
+    memory.at(i) = static_cast<std::byte*>(mapped);
+  }
+
+  for (std::uint32_t p = 0; p < view.plane_count; ++p) {
+    auto& plane = view.planes.at(p);
+    const auto fds = std::span(view.dmabuf_fds).first(view.dmabuf_count);
+    const auto index = static_cast<std::size_t>(std::ranges::find(fds, plane.fd) - fds.begin());
+    plane.data = std::span(memory.at(index) + plane.offset,  // NOLINT(*-pointer-arithmetic)
+                           view.plane_lengths.at(p));
+  }
+  view.is_mapped = true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::beginCpuAccess(FrameHandle::Slot::Buffer& view,
+                                  const std::optional<CropView>& crop, ImageFrame& frame) {
+  // Invalidates stale cache lines of cached mappings, so the CPU sees what the ISP wrote
+  for (std::uint32_t i = 0; i < view.dmabuf_count; ++i) {
+    syncDmaBuf(view.dmabuf_fds.at(i), DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+  }
+  view.cpu_access.store(true, std::memory_order_relaxed);
+
+  // Expose planes, trimmed to the bytes actually written
+  const auto& meta_planes = view.buffer->metadata().planes();
+  for (std::uint32_t p = 0; p < view.plane_count; ++p) {
+    auto data = view.planes.at(p).data;
+    if ((not view.is_split) && (p < meta_planes.size())) {
+      data = data.first(std::min<std::size_t>(meta_planes[p].bytesused, data.size()));
+    }
+    if (crop) {
+      const auto offset = std::min(crop->offsets.at(p), data.size());
+      data = data.subspan(offset, std::min(crop->lengths.at(p), data.size() - offset));
+    }
+    frame.planes.at(p).data = data;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::Impl::mapForCpu(FrameHandle::Slot& slot, std::size_t stream) -> const ImageFrame& {
+  auto& view = slot.buffers.at(stream);
+  auto& frame = slot.frames.at(stream);
+  if (view.cpu_access.load(std::memory_order_acquire)) {
+    return frame;
+  }
+  if (mapping_policy == MappingPolicy::Never) {
+    throw std::logic_error("CPU mapping of capture buffers is disabled");
+  }
+  const auto lock = std::scoped_lock(mapping_mutex);
+  if (not view.cpu_access.load(std::memory_order_relaxed)) {
+    mapBuffer(view);
+    beginCpuAccess(view, streams.at(stream).crop, frame);
+    view.cpu_access.store(true, std::memory_order_release);
   }
+  return frame;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::release(FrameHandle::Slot& slot) {
+  for (std::size_t i = 0; i < slot.buffers.size(); ++i) {
+    auto& view = slot.buffers[i];
+    if (view.cpu_access.exchange(false, std::memory_order_relaxed)) {
+      for (std::uint32_t fd = 0; fd < view.dmabuf_count; ++fd) {
+        syncDmaBuf(view.dmabuf_fds.at(fd), DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+      }
+      for (auto& plane : slot.frames[i].planes) {
+        plane.data = {};
+      }
+    }
+  }
+  requeue(slot.request);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -210,7 +1000,55 @@ void Camera::Impl::startCapture() {
     }
   }
 
-  std::println("Camera capture started");
+  // Buffers are mapped while the first requests are captured rather than before queuing them.
+  // Frames only reach consumers, which need the mappings, once the camera is constructed
+  if (mapping_policy == MappingPolicy::Eager) {
+    mapBuffers();
+  }
+
+  log("Camera capture started");
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::stopCapture() {
+  if (camera_started.exchange(false, std::memory_order_acq_rel)) {
+    camera->stop();
+  }
+  camera->requestCompleted.disconnect(this, &Camera::Impl::requestComplete);
+
+  // Requests completed but not yet taken are dropped. Nothing requeues them while stopped
+  latest_request.store(nullptr, std::memory_order_relaxed);
+  if (completed_requests) {
+    while (completed_requests->tryPop()) {
+    }
+  }
+  clearNotification();
+
+  // Sequence numbers and completion times restart with capture
+  last_sequence.reset();
+  last_completion.reset();
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::releaseRequests() {
+  const auto lock = std::scoped_lock(mapping_mutex);
+  for (const auto& mapping : mappings) {
+    munmap(mapping.memory, mapping.length);
+  }
+  mappings.clear();
+  requests.clear();
+  slots.clear();
+  streams.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::mapBuffers() {
+  const auto lock = std::scoped_lock(mapping_mutex);
+  for (auto& slot : slots) {
+    for (auto& view : slot.buffers) {
+      mapBuffer(view);
+    }
+  }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -218,113 +1056,627 @@ auto Camera::Impl::queueRequest(libcamera::Request* request) -> int {
   if (!camera_started.load(std::memory_order_acquire)) {
     return -1;
   }
+  if (controls_pending.load(std::memory_order_acquire)) {
+    const auto lock = std::scoped_lock(controls_mutex);
+    applyControls(pending_controls, request->controls());
+    pending_controls = {};
+    queued_controls_id.store(last_controls_id, std::memory_order_relaxed);
+    controls_pending.store(false, std::memory_order_relaxed);
+  }
+  slots.at(request->cookie()).controls_id = queued_controls_id.load(std::memory_order_relaxed);
   return camera->queueRequest(request);
 }
 
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::validateControls(const Controls& controls) const {
+  namespace lc = libcamera::controls;
+  const auto& supported = camera->controls();
+  if (controls.frame_duration_limits) {
+    requireControl(supported, lc::FrameDurationLimits);
+    const auto& [min, max] = *controls.frame_duration_limits;
+    if ((min.count() <= 0) || (min > max)) {
+      throw std::invalid_argument("Invalid frame duration limits");
+    }
+  }
+  if (controls.exposure_time) {
+    requireControl(supported, lc::ExposureTime);
+    requireControl(supported, lc::ExposureTimeMode);
+    if (controls.exposure_time->count() <= 0) {
+      throw std::invalid_argument("Exposure time must be positive");
+    }
+  }
+  if (controls.analogue_gain) {
+    requireControl(supported, lc::AnalogueGain);
+    requireControl(supported, lc::AnalogueGainMode);
+    const auto gain = *controls.analogue_gain;
+    if ((not std::isfinite(gain)) || (gain <= 0.F)) {
+      throw std::invalid_argument("Analogue gain must be positive");
+    }
+  }
+  if (controls.auto_exposure) {
+    requireControl(supported, lc::ExposureTimeMode);
+    requireControl(supported, lc::AnalogueGainMode);
+  }
+  if (controls.auto_white_balance) {
+    requireControl(supported, lc::AwbEnable);
+  }
+  if (controls.scaler_crop) {
+    requireControl(supported, lc::ScalerCrop);
+    const auto& crop = *controls.scaler_crop;
+    if ((crop.width == 0) || (crop.height == 0)) {
+      throw std::invalid_argument("Scaler crop must not be empty");
+    }
+    // Area read out in the configured sensor mode. Reported by most pipelines
+    const auto maximum = camera->properties().get(libcamera::properties::ScalerCropMaximum);
+    if (maximum && ((crop.x < maximum->x) || (crop.y < maximum->y) ||
+                    (crop.x + crop.width > maximum->x + static_cast<int>(maximum->width)) ||
+                    (crop.y + crop.height > maximum->y + static_cast<int>(maximum->height)))) {
+      throw std::invalid_argument(std::format(
+          "Scaler crop {}x{} at ({}, {}) is outside the sensor area {}x{} at ({}, {})", crop.width,
+          crop.height, crop.x, crop.y, maximum->width, maximum->height, maximum->x, maximum->y));
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::mergeControls(PendingControls& pending, const Controls& controls) {
+  auto& values = pending.values;
+  if (controls.frame_duration_limits) {
+    values.frame_duration_limits = controls.frame_duration_limits;
+  }
+  if (controls.exposure_time) {
+    values.exposure_time = controls.exposure_time;
+    pending.auto_exposure_time = false;
+  }
+  if (controls.analogue_gain) {
+    values.analogue_gain = controls.analogue_gain;
+    pending.auto_analogue_gain = false;
+  }
+  if (controls.auto_exposure) {
+    pending.auto_exposure_time = controls.auto_exposure;
+    pending.auto_analogue_gain = controls.auto_exposure;
+  }
+  if (controls.auto_white_balance) {
+    values.auto_white_balance = controls.auto_white_balance;
+  }
+  if (controls.scaler_crop) {
+    values.scaler_crop = controls.scaler_crop;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::applyControls(const PendingControls& pending, libcamera::ControlList& list) {
+  namespace lc = libcamera::controls;
+  const auto& values = pending.values;
+  if (values.frame_duration_limits) {
+    const auto& [min, max] = *values.frame_duration_limits;
+    const auto limits = std::array<std::int64_t, 2>{ min.count(), max.count() };
+    list.set(lc::FrameDurationLimits, libcamera::Span<const std::int64_t, 2>(limits));
+  }
+  if (values.exposure_time) {
+    list.set(lc::ExposureTime, static_cast<std::int32_t>(values.exposure_time->count()));
+  }
+  if (pending.auto_exposure_time) {
+    list.set(lc::ExposureTimeMode, *pending.auto_exposure_time ? lc::ExposureTimeModeAuto
+                                                               : lc::ExposureTimeModeManual);
+  }
+  if (values.analogue_gain) {
+    list.set(lc::AnalogueGain, *values.analogue_gain);
+  }
+  if (pending.auto_analogue_gain) {
+    list.set(lc::AnalogueGainMode, *pending.auto_analogue_gain ? lc::AnalogueGainModeAuto
+                                                               : lc::AnalogueGainModeManual);
+  }
+  if (values.auto_white_balance) {
+    list.set(lc::AwbEnable, *values.auto_white_balance);
+  }
+  if (values.scaler_crop) {
+    const auto& crop = *values.scaler_crop;
+    list.set(lc::ScalerCrop, libcamera::Rectangle(crop.x, crop.y, crop.width, crop.height));
+  }
+}
+
 //-------------------------------------------------------------------------------------------------
 void Camera::Impl::requestComplete(libcamera::Request* request) {
+  std::call_once(completion_thread_configured,
+                 [this] { configureCurrentThread(completion_thread, "picam_complete"); });
   if (request->status() == libcamera::Request::RequestCancelled) {
+    cancelled_count.fetch_add(1, std::memory_order_relaxed);
     return;
   }
+  const auto now = SensorClock::now();
+  slots.at(request->cookie()).completion_time = now;
+  completed_count.fetch_add(1, std::memory_order_relaxed);
+  if (last_completion) {
+    frame_interval.record(now - *last_completion);
+  } else {
+    time_to_first_frame.store((now - start_time).count(), std::memory_order_relaxed);
+  }
+  last_completion = now;
+  countMissedFrames(request);
   processRequest(request);
 }
 
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::countMissedFrames(const libcamera::Request* request) {
+  // All streams share the sensor sequence, so the first one is representative
+  const auto* buffer = slots.at(request->cookie()).buffers.front().buffer;
+  const auto sequence = buffer->metadata().sequence;
+  if (last_sequence && (sequence > *last_sequence + 1)) {
+    missed_frames.fetch_add(sequence - *last_sequence - 1, std::memory_order_relaxed);
+  }
+  last_sequence = sequence;
+}
+
 //-------------------------------------------------------------------------------------------------
 void Camera::Impl::processRequest(libcamera::Request* request) {
-  // Store latest frame, discarding previous if not consumed
-  auto* old = latest_request.exchange(request, std::memory_order_release);
-  // If there was an unconsumed frame, requeue it immediately
-  if (old != nullptr) {
-    old->reuse(libcamera::Request::ReuseBuffers);
-    queueRequest(old);
+  if (queue_policy == QueuePolicy::LatestOnly) {
+    // Store latest frame, discarding previous if not consumed
+    auto* old = latest_request.exchange(request, std::memory_order_release);
+    // If there was an unconsumed frame, requeue it immediately
+    if (old != nullptr) {
+      discarded_frames.fetch_add(1, std::memory_order_relaxed);
+      requeue(old);
+    }
+    notifyFrame();
+    return;
+  }
+
+  if (not completed_requests->tryPush(request)) {
+    // Only reachable with DropOldest, since BlockProducer sizes the queue to hold every buffer.
+    // The consumer may pop concurrently, in which case the push below succeeds without a drop
+    if (const auto oldest = completed_requests->tryPop(); oldest) {
+      discarded_frames.fetch_add(1, std::memory_order_relaxed);
+      requeue(*oldest);
+    }
+    if (not completed_requests->tryPush(request)) {
+      discarded_frames.fetch_add(1, std::memory_order_relaxed);
+      requeue(request);
+      return;
+    }
+  }
+  notifyFrame();
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::requeue(libcamera::Request* request) {
+  request->reuse(libcamera::Request::ReuseBuffers);
+  queueRequest(request);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::Impl::takeRequest() -> libcamera::Request* {
+  if (queue_policy == QueuePolicy::LatestOnly) {
+    return latest_request.exchange(nullptr, std::memory_order_acquire);
+  }
+  return completed_requests->tryPop().value_or(nullptr);
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::notifyFrame() const {
+  static constexpr auto ONE = std::uint64_t{ 1 };
+  // Can only fail if the counter saturates, in which case the fd is readable anyway
+  std::ignore = write(event_fd, &ONE, sizeof(ONE));
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::clearNotification() const {
+  auto count = std::uint64_t{ 0 };
+  // Non-blocking. Fails with EAGAIN if nothing was pending
+  std::ignore = read(event_fd, &count, sizeof(count));
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::Impl::waitForFrame(std::chrono::milliseconds timeout) const -> bool {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto pfd = pollfd{ .fd = event_fd, .events = POLLIN, .revents = 0 };
+  while (true) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    const auto ret = poll(&pfd, 1, static_cast<int>(std::max<std::int64_t>(remaining.count(), 0)));
+    if (ret > 0) {
+      return true;
+    }
+    if ((ret == 0) || (errno != EINTR)) {
+      return false;
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::applyPolicies(const Config& camera_config) {
+  start_time = SensorClock::now();
+  verbose = camera_config.verbose;
+  queue_policy = camera_config.queue_policy;
+  overflow_policy = camera_config.overflow_policy;
+  mapping_policy = camera_config.mapping_policy;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::startStreams(const Config& camera_config,
+                                const std::vector<StreamConfig>& specs,
+                                const CachedConfig* cached) {
+  // Queued with the first requests. Not a setControls() call, so frames report controls_id 0
+  validateControls(camera_config.controls);
+  {
+    const auto lock = std::scoped_lock(controls_mutex);
+    mergeControls(pending_controls, camera_config.controls);
+    controls_pending.store(true, std::memory_order_relaxed);
+  }
+
+  const auto from_cache = configureStreams(specs, camera_config.buffer_count, cached);
+  const auto& cache_path = camera_config.config_cache_path;
+  if ((not cache_path.empty()) && (not from_cache)) {
+    saveConfigCache(cache_path, configCacheKey(camera_config, specs), camera->id(), *config);
+  }
+  allocateBuffers(camera_config.queue_depth);
+  createRequests();
+  startCapture();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::list() -> std::vector<Info> {
+  const auto camera_manager = sharedCameraManager();
+  auto cameras = std::vector<Info>{};
+  for (const auto& camera : camera_manager->cameras()) {
+    const auto& model = camera->properties().get(libcamera::properties::Model);
+    cameras.push_back({ .id = camera->id(), .model = model ? *model : std::string{} });
+  }
+  return cameras;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::holdCameraManager() -> std::shared_ptr<void> {
+  return sharedCameraManager();
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::shutdown() {
+  if (camera) {
+    if (camera_started.exchange(false, std::memory_order_acq_rel)) {
+      camera->stop();
+    }
+    camera->requestCompleted.disconnect(this, &Camera::Impl::requestComplete);
+    camera->release();
+  }
+
+  // Unmap buffers
+  for (const auto& mapping : mappings) {
+    munmap(mapping.memory, mapping.length);
+  }
+  mappings.clear();
+
+  // Stops the camera manager if no other camera uses it
+  camera.reset();
+  camera_manager.reset();
+
+  if (event_fd >= 0) {
+    close(event_fd);
+    event_fd = -1;
   }
 }
 
 //-------------------------------------------------------------------------------------------------
 Camera::Camera(const Config& config, Callback&& image_callback) : impl_(std::make_unique<Impl>()) {
+  impl_->applyPolicies(config);
   impl_->callback = std::move(image_callback);
-  impl_->setupCamera(config.camera_name_hint);
-  impl_->configureStream(config.image_size);
-  impl_->allocateBuffers();
-  impl_->createRequests();
-  impl_->startCapture();
+  impl_->completion_thread = config.completion_thread;
+  impl_->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (impl_->event_fd < 0) {
+    throw std::runtime_error("Failed to create frame notification eventfd");
+  }
+
+  // The destructor does not run if construction throws
+  try {
+    const auto specs = streamSpecs(config);
+    const auto cached = loadConfigCache(config, specs);
+    impl_->setupCamera(config.camera_name_hint, config.camera_id,
+                       cached ? cached->camera_id : std::string{});
+    impl_->startStreams(config, specs, cached ? &*cached : nullptr);
+  } catch (...) {
+    impl_->shutdown();
+    throw;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::reconfigure(const Config& config) {
+  const auto is_held = std::ranges::any_of(impl_->slots, [](const FrameHandle::Slot& slot) {
+    return slot.references.load(std::memory_order_acquire) != 0;
+  });
+  if (is_held) {
+    throw std::logic_error("Release all frame handles before reconfiguring the camera");
+  }
+
+  impl_->stopCapture();
+  impl_->releaseRequests();
+  impl_->applyPolicies(config);
+  impl_->time_to_first_frame.store(0, std::memory_order_relaxed);
+
+  const auto specs = streamSpecs(config);
+  const auto cached = loadConfigCache(config, specs);
+  impl_->startStreams(config, specs, cached ? &*cached : nullptr);
 }
 
 //-------------------------------------------------------------------------------------------------
 Camera::~Camera() {
-  if (impl_->camera) {
-    if (impl_->camera_started.exchange(false, std::memory_order_acq_rel)) {
-      impl_->camera->stop();
-    }
-    impl_->camera->requestCompleted.disconnect(impl_.get(), &Camera::Impl::requestComplete);
-    impl_->camera->release();
+  impl_->shutdown();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::acquire(std::chrono::milliseconds timeout) -> bool {
+  const auto handle = acquireFrame(timeout);
+  if (not handle) {
+    return false;
+  }
+  impl_->deliver(handle);
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::streamFormat(std::size_t stream) const -> ImageFrame::Header {
+  const auto& state = impl_->streams.at(stream);
+  const auto& stream_config = state.stream->configuration();
+  auto header = ImageFrame::Header{};
+  header.stream_id = static_cast<std::uint32_t>(stream);
+  header.pitch = stream_config.stride;
+  header.size = { .width = static_cast<std::uint16_t>(stream_config.size.width),
+                  .height = static_cast<std::uint16_t>(stream_config.size.height) };
+  if (state.crop) {
+    header.size = state.crop->size;
   }
+  header.format = stream_config.pixelFormat;
+  header.format_modifier = stream_config.pixelFormat.modifier();
+  header.color_space = state.color_space;
+  return header;
+}
 
-  // Unmap buffers
-  for (auto& [fd, pair] : impl_->mapped_buffers) {
-    munmap(pair.first, pair.second);
+//-------------------------------------------------------------------------------------------------
+auto Camera::setControls(const Controls& controls) -> std::uint64_t {
+  impl_->validateControls(controls);
+  const auto lock = std::scoped_lock(impl_->controls_mutex);
+  Impl::mergeControls(impl_->pending_controls, controls);
+  impl_->controls_pending.store(true, std::memory_order_release);
+  return ++impl_->last_controls_id;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::eventFd() const -> int {
+  return impl_->event_fd;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::dropCounters() const -> DropCounters {
+  return { .discarded = impl_->discarded_frames.load(std::memory_order_relaxed),
+           .missed = impl_->missed_frames.load(std::memory_order_relaxed) };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::stats() const -> Stats {
+  auto queue_depth = std::size_t{ 0 };
+  if (impl_->completed_requests) {
+    queue_depth = impl_->completed_requests->size();
+  } else if (impl_->latest_request.load(std::memory_order_relaxed) != nullptr) {
+    queue_depth = 1;
+  }
+  return { .completed = impl_->completed_count.load(std::memory_order_relaxed),
+           .cancelled = impl_->cancelled_count.load(std::memory_order_relaxed),
+           .delivered = impl_->delivered_count.load(std::memory_order_relaxed),
+           .drops = dropCounters(),
+           .queue_depth = static_cast<std::uint32_t>(queue_depth),
+           .frame_interval = impl_->frame_interval.snapshot(),
+           .handover_latency = impl_->handover_latency.snapshot(),
+           .time_to_first_frame = std::chrono::nanoseconds{
+               impl_->time_to_first_frame.load(std::memory_order_relaxed) } };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Camera::acquire() -> bool {
+  // The handle returns the buffers to the camera once the callbacks are done with them
+  const auto handle = acquireFrame();
+  if (not handle) {
+    return false;
+  }
+  impl_->deliver(handle);
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Camera::Impl::deliver(const FrameHandle& handle) const {
+  for (std::size_t i = 0; i < streams.size(); ++i) {
+    if (streams[i].callback != nullptr) {
+      streams[i].callback((mapping_policy == MappingPolicy::Never) ? handle.frame(i)
+                                                                   : handle.mapped(i));
+    }
   }
-  impl_->mapped_buffers.clear();
+}
 
-  if (impl_->camera_manager) {
-    impl_->camera_manager->stop();
+//-------------------------------------------------------------------------------------------------
+auto Camera::acquireFrame(std::chrono::milliseconds timeout) -> FrameHandle {
+  if (auto handle = acquireFrame(); handle) {
+    return handle;
+  }
+  if (not impl_->waitForFrame(timeout)) {
+    return {};
   }
+  return acquireFrame();
 }
 
 //-------------------------------------------------------------------------------------------------
-void Camera::acquire() {
-  // Get latest frame
-  libcamera::Request* request = impl_->latest_request.exchange(nullptr, std::memory_order_acquire);
+auto Camera::acquireFrame() -> FrameHandle {
+  // Reset the notification before taking the frame, so that a completion racing with us leaves
+  // the eventfd readable rather than being missed. With a FIFO, more frames may be queued, so
+  // re-arm it after taking one
+  impl_->clearNotification();
+
+  // Get next frame
+  libcamera::Request* request = impl_->takeRequest();
   if (request == nullptr) {
-    return;  // No frame available
+    return {};  // No frame available
   }
+  if (impl_->completed_requests && (impl_->completed_requests->size() > 0)) {
+    impl_->notifyFrame();
+  }
+
+  auto* const slot = impl_->makeFrames(request);
+  if (slot == nullptr) {
+    impl_->requeue(request);
+    return {};
+  }
+  // The request is exclusively ours until the first reference is handed out
+  slot->references.store(1, std::memory_order_relaxed);
+  impl_->delivered_count.fetch_add(1, std::memory_order_relaxed);
+  impl_->handover_latency.record(SensorClock::now() - slot->completion_time);
+  return FrameHandle(slot);
+}
 
+//-------------------------------------------------------------------------------------------------
+auto Camera::Impl::makeFrames(libcamera::Request* request) -> FrameHandle::Slot* {
   if (request->status() != libcamera::Request::RequestComplete) {
-    request->reuse(libcamera::Request::ReuseBuffers);
-    impl_->queueRequest(request);
-    return;
+    return nullptr;
   }
 
-  // Get the buffer
-  auto* const buffer = request->findBuffer(impl_->stream);
-  if (buffer == nullptr) {
-    std::println("No buffer found in request");
-    request->reuse(libcamera::Request::ReuseBuffers);
-    impl_->queueRequest(request);
-    return;
+  auto& slot = slots.at(request->cookie());
+  const auto& sensor_timestamp = request->metadata().get(libcamera::controls::SensorTimestamp);
+  auto metadata = toCaptureMetadata(request->metadata());
+  metadata.controls_id = slot.controls_id;
+
+  for (std::size_t i = 0; i < streams.size(); ++i) {
+    const auto& state = streams[i];
+
+    auto& view = slot.buffers[i];
+    const auto* const buffer = view.buffer;  // Resolved at setup, no per-frame lookup
+
+    // Prefer the start-of-exposure time reported by the pipeline. Fall back to the buffer
+    // timestamp, which some pipelines record at end of frame
+    const auto& buffer_meta = buffer->metadata();
+    const auto timestamp = SensorClock::time_point{ std::chrono::nanoseconds{
+        sensor_timestamp ? *sensor_timestamp : static_cast<std::int64_t>(buffer_meta.timestamp) } };
+    const auto& stream_config = state.stream->configuration();
+
+    // Map libcamera pixel format to SDL format
+    auto pitch = static_cast<std::uint32_t>(stream_config.stride);
+    const auto sdl_format = stream_config.pixelFormat;
+
+    // Create ImageFrame with actual pixel format from camera
+    auto& frame = slot.frames[i];
+    frame.header = { .timestamp = timestamp,
+                     .completion_time = slot.completion_time,
+                     .sequence = buffer_meta.sequence,
+                     .stream_id = static_cast<std::uint32_t>(i),
+                     .pitch = pitch,
+                     .size{ .width = static_cast<std::uint16_t>(stream_config.size.width),
+                            .height = static_cast<std::uint16_t>(stream_config.size.height) },
+                     .format = sdl_format,
+                     .format_modifier = sdl_format.modifier(),
+                     .color_space = state.color_space,
+                     .metadata = metadata,
+                     .statistics = {} };
+    // dmabuf views only. CPU views are exposed once access is synchronised
+    frame.planes = view.planes;
+    frame.plane_count = view.plane_count;
+    for (auto& plane : frame.planes) {
+      plane.data = {};
+    }
+    if (state.crop) {
+      frame.header.size = state.crop->size;
+      for (std::uint32_t p = 0; p < frame.plane_count; ++p) {
+        frame.planes.at(p).offset += static_cast<std::uint32_t>(state.crop->offsets.at(p));
+      }
+    }
+    if (mapping_policy == MappingPolicy::Eager) {
+      beginCpuAccess(slot.buffers[i], state.crop, frame);
+    }
   }
+  return &slot;
+}
 
-  const auto timestamp = std::chrono::system_clock::now();
-  const auto& stream_config = impl_->config->at(0);
-
-  // Map buffer data
-  const auto& plane = buffer->planes()[0];
-  const auto& meta = buffer->metadata().planes()[0];
-  void* data = impl_->mapped_buffers[plane.fd.get()].first;
-  const auto length = std::min(meta.bytesused, plane.length);
-
-  // Map libcamera pixel format to SDL format
-  auto pitch = static_cast<std::uint32_t>(stream_config.stride);
-  const auto sdl_format = stream_config.pixelFormat;
-
-  // Create ImageFrame with actual pixel format from camera
-  const auto frame = ImageFrame{
-    //
-    .header = { .timestamp = timestamp,
-                .pitch = pitch,
-                .size{ .width = static_cast<std::uint16_t>(stream_config.size.width),
-                       .height = static_cast<std::uint16_t>(stream_config.size.height) },
-                .format = sdl_format },
-    .pixels = { static_cast<std::byte*>(data), length }
-  };
+//-------------------------------------------------------------------------------------------------
+FrameHandle::FrameHandle(Slot* slot) noexcept : slot_(slot) {
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameHandle::~FrameHandle() {
+  reset();
+}
 
-  if (impl_->callback != nullptr) {
-    impl_->callback(frame);
+//-------------------------------------------------------------------------------------------------
+FrameHandle::FrameHandle(FrameHandle&& other) noexcept
+  : slot_(std::exchange(other.slot_, nullptr)) {
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::operator=(FrameHandle&& other) noexcept -> FrameHandle& {
+  if (this != &other) {
+    reset();
+    slot_ = std::exchange(other.slot_, nullptr);
   }
+  return *this;
+}
 
-  // Requeue the request for continuous capture
-  request->reuse(libcamera::Request::ReuseBuffers);
-  impl_->queueRequest(request);
+//-------------------------------------------------------------------------------------------------
+FrameHandle::operator bool() const noexcept {
+  return slot_ != nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::frameCount() const noexcept -> std::size_t {
+  return (slot_ != nullptr) ? slot_->frames.size() : 0U;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::frame(std::size_t stream) const -> const ImageFrame& {
+  return slot_->frames.at(stream);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::frame() const -> const ImageFrame& {
+  return slot_->frames.front();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::operator*() const -> const ImageFrame& {
+  return frame();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::operator->() const -> const ImageFrame* {
+  return &frame();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::mapped(std::size_t stream) const -> const ImageFrame& {
+  return slot_->owner->mapForCpu(*slot_, stream);
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameHandle::setStatistics(std::size_t stream, const FrameStatistics& statistics) {
+  if (slot_->references.load(std::memory_order_acquire) != 1) {
+    throw std::logic_error("Frame statistics can only be set through the only handle to a capture");
+  }
+  slot_->frames.at(stream).header.statistics = statistics;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameHandle::clone() const -> FrameHandle {
+  if (slot_ == nullptr) {
+    return {};
+  }
+  // Relaxed is enough, since the caller already holds a reference
+  slot_->references.fetch_add(1, std::memory_order_relaxed);
+  return FrameHandle(slot_);
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameHandle::reset() noexcept {
+  if (slot_ == nullptr) {
+    return;
+  }
+  // Acq-rel so that all reads of the frame by other holders happen before the buffer is reused
+  if (slot_->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    slot_->owner->release(*slot_);
+  }
+  slot_ = nullptr;
 }
 
 }  // namespace picam
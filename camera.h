@@ -4,11 +4,20 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "frame_handle.h"
 #include "image_frame.h"
+#include "stats.h"
+#include "thread_config.h"
 
 namespace picam {
 
@@ -18,6 +27,86 @@ class Camera {
 public:
   using Callback = std::function<void(const ImageFrame& frame)>;
 
+  /// How completed frames are handed over to the consumer
+  enum class QueuePolicy : std::uint8_t {
+    LatestOnly,  //!< Mailbox holding only the newest frame. Lowest latency, for live view
+    Fifo         //!< Bounded FIFO of completed frames, delivered in capture order
+  };
+
+  /// What the FIFO queue policy does when the consumer falls behind
+  enum class OverflowPolicy : std::uint8_t {
+    DropOldest,    //!< Discard the oldest queued frame to make room for the newest
+    BlockProducer  //!< Never discard. Buffers are held back from the camera until consumed, so
+                   //!< the sensor drops frames instead (visible as sequence number gaps)
+  };
+
+  /// When capture buffers are mapped for CPU access
+  enum class MappingPolicy : std::uint8_t {
+    Eager,  //!< Map all buffers at startup. Every frame has CPU access to its pixels
+    Lazy,   //!< Map a buffer the first time FrameHandle::mapped() is called on one of its frames
+    Never   //!< No CPU access. For consumers that only use dmabufs (GPU, hardware encoders)
+  };
+
+  /// Intended use of a stream. Lets the pipeline pick suitable defaults and ISP outputs
+  enum class StreamRole : std::uint8_t {
+    Viewfinder,      //!< Low latency preview
+    VideoRecording,  //!< Continuous capture for encoding or analysis
+    StillCapture,    //!< High quality full resolution images
+    Raw              //!< Unprocessed sensor data
+  };
+
+  /// Specification of one of several streams captured simultaneously
+  struct StreamConfig {
+    /// Intended use of the stream
+    StreamRole role{ StreamRole::Viewfinder };
+
+    /// Target resolution (pixels). Camera will select closest matching resolution
+    ImageSize image_size{};
+
+    /// Software crop, in pixels of the stream image. Frames of the stream are then views of just
+    /// this region of each capture buffer, through plane offsets and the buffer pitch, without
+    /// copying; consumers (conversion, display, sharing) only touch the bytes of the region. The
+    /// origin must start on whole samples of every plane: even coordinates for YUV and raw
+    /// formats, and a multiple of 4 columns for CSI-2 packed 10-bit formats
+    std::optional<ImageRect> crop{};
+
+    /// Pixel format (fourcc). 0 selects the first supported format from a built-in preference
+    /// list. Raw streams prefer Bayer formats that bayerFormat() can unpack, including CSI-2
+    /// packed formats
+    std::uint32_t pixel_format{ 0 };
+
+    /// Callback for frames of this stream. If unset, the camera's image callback is used
+    Callback callback{ nullptr };
+  };
+
+  /// Capture controls that can be changed while the camera runs, without reconfiguring streams.
+  /// Unset fields keep their current value
+  struct Controls {
+    /// Minimum and maximum frame duration. Equal values lock the frame rate (33333us for 30 fps).
+    /// Auto exposure then keeps the exposure time within the frame duration
+    std::optional<std::pair<std::chrono::microseconds, std::chrono::microseconds>>
+        frame_duration_limits{};
+
+    /// Fixed exposure time. Switches exposure time to manual unless auto_exposure is set to true
+    std::optional<std::chrono::microseconds> exposure_time{};
+
+    /// Fixed analogue gain (1.0 is unity). Switches gain to manual unless auto_exposure is set to
+    /// true
+    std::optional<float> analogue_gain{};
+
+    /// Enable automatic control of both exposure time and analogue gain
+    std::optional<bool> auto_exposure{};
+
+    /// Enable automatic white balance
+    std::optional<bool> auto_white_balance{};
+
+    /// Region of interest on the sensor, in pixel array coordinates (libcamera ScalerCrop). The
+    /// ISP scales this region, rather than the full field of view, to the size of each stream.
+    /// The pipeline rounds it to what the hardware supports; CaptureMetadata::scaler_crop reports
+    /// the region applied. Must lie within the area read out in the current sensor mode
+    std::optional<ImageRect> scaler_crop{};
+  };
+
   struct Config {
     static constexpr auto DEFAULT_IMAGE_SIZE = ImageSize{ .width = 1920U, .height = 1080U };
 
@@ -25,16 +114,162 @@ public:
     std::string camera_name_hint;
 
     /// Target resolution (pixels). Camera will select closest matching resolution
+    /// Ignored if 'streams' is specified
     ImageSize image_size{ DEFAULT_IMAGE_SIZE };
+
+    /// Software crop of the image (see StreamConfig::crop). Ignored if 'streams' is specified
+    std::optional<ImageRect> crop{};
+
+    /// Streams to capture simultaneously, e.g. a small viewfinder alongside a full resolution
+    /// video stream. Every capture then produces one frame per stream, tagged with its index in
+    /// this list. If empty, a single viewfinder stream of 'image_size' is captured
+    std::vector<StreamConfig> streams{};
+
+    /// Frame handover policy
+    QueuePolicy queue_policy{ QueuePolicy::LatestOnly };
+
+    /// Overflow behaviour of the FIFO queue policy
+    OverflowPolicy overflow_policy{ OverflowPolicy::DropOldest };
+
+    /// CPU mapping of capture buffers
+    MappingPolicy mapping_policy{ MappingPolicy::Eager };
+
+    /// Number of capture buffers to allocate. 0 selects the pipeline default
+    std::uint32_t buffer_count{ 0 };
+
+    /// Capacity of the FIFO for OverflowPolicy::DropOldest. 0 selects one less than the number
+    /// of buffers, so the camera always has a buffer to capture into
+    std::uint32_t queue_depth{ 0 };
+
+    /// Placement and scheduling of the libcamera thread that completes requests (ISP callback).
+    /// Applied when the first request completes. Pin it to an isolated core on small systems, so
+    /// that it does not contend with the consumer and the GL driver
+    ThreadConfig completion_thread{};
+
+    /// Controls applied from the first capture request. Can be changed later with setControls()
+    Controls controls{};
+
+    /// Print the cameras found, the formats each stream supports and the configuration chosen.
+    /// Listing formats probes every format and size, which noticeably slows down startup
+    bool verbose{ true };
+
+    /// File caching the camera selected and the stream configuration validated for this config.
+    /// When the cache matches, later starts open the camera directly and skip the format search.
+    /// A stale cache (camera gone, configuration no longer valid) is ignored and rewritten.
+    /// Empty disables caching
+    std::string config_cache_path{};
+
+    /// Id of the camera to open (see Camera::list()). Takes precedence over the name hint, and
+    /// distinguishes identical sensors, e.g. the two cameras of a stereo rig
+    std::string camera_id{};
+  };
+
+  /// Camera found by libcamera
+  struct Info {
+    std::string id;     //!< Unique and stable id, for Config::camera_id
+    std::string model;  //!< Sensor model, matched by Config::camera_name_hint
+  };
+
+  /// Frames lost between sensor and consumer
+  struct DropCounters {
+    std::uint64_t discarded{};  //!< Captured frames discarded by the queue policy
+    std::uint64_t missed{};     //!< Frames never captured, from gaps in sequence numbers
+  };
+
+  /// Capture pipeline instrumentation. Always on; counters are updated with relaxed atomics
+  struct Stats {
+    std::uint64_t completed{};       //!< Requests completed by the pipeline
+    std::uint64_t cancelled{};       //!< Requests cancelled by the pipeline
+    std::uint64_t delivered{};       //!< Frames handed to the consumer
+    DropCounters drops;              //!< Frames lost between sensor and consumer
+    std::uint32_t queue_depth{};     //!< Frames waiting for the consumer when sampled
+    DurationStats frame_interval;    //!< Time between consecutive request completions
+    DurationStats handover_latency;  //!< Request completion to frame acquisition
+
+    /// Time from construction, or the latest reconfigure(), to the first completed request. 0
+    /// until then
+    std::chrono::nanoseconds time_to_first_frame{};
+
+    /// @return Average capture rate in frames per second, or 0 if unknown
+    [[nodiscard]] auto frameRate() const -> double {
+      const auto mean = frame_interval.mean();
+      return (mean.count() > 0) ? 1e9 / static_cast<double>(mean.count()) : 0.0;
+    }
   };
 
-  /// Initialise a camera
+  /// @return Cameras present, in libcamera's order. Cameras in use are listed too
+  [[nodiscard]] static auto list() -> std::vector<Info>;
+
+  /// Keep the libcamera camera manager running while the returned reference is held. Otherwise it
+  /// is started, and cameras enumerated, by each call to list() or construction of a Camera when no
+  /// other camera is open. Hold it across list() and opening the cameras to start it only once
+  [[nodiscard]] static auto holdCameraManager() -> std::shared_ptr<void>;
+
+  /// Initialise a camera. Several cameras can be open at once; they share the libcamera camera
+  /// manager and the libcamera thread that completes their requests
   /// @param config Camera capture configuration
   /// @param image_callback Callback to trigger on image capture
   Camera(const Config& config, Callback&& image_callback);
 
-  /// Acquire an image. Trigger callback when an image becomes available
-  void acquire();
+  /// Acquire an image without blocking. Trigger callback if an image is available, once for each
+  /// stream. The frame is only valid inside the callback; use acquireFrame() to hold on to it
+  /// for longer. Frames have CPU access to pixels unless the mapping policy is Never
+  /// @return true if frames were delivered to the callbacks
+  auto acquire() -> bool;
+
+  /// Wait for an image and trigger callback when it becomes available
+  /// @param timeout Maximum time to wait
+  /// @return true if frames were delivered to the callbacks, false on timeout
+  auto acquire(std::chrono::milliseconds timeout) -> bool;
+
+  /// Take the next capture without blocking. Callbacks are not triggered. The handle references
+  /// the frames of all streams, and their buffers are returned for capture when the last handle
+  /// is released
+  /// @return Handle to the frames, or an empty handle if no frame is available
+  auto acquireFrame() -> FrameHandle;
+
+  /// Wait for the next capture
+  /// @param timeout Maximum time to wait
+  /// @return Handle to the frames, or an empty handle on timeout
+  auto acquireFrame(std::chrono::milliseconds timeout) -> FrameHandle;
+
+  /// File descriptor that becomes readable when a frame is pending, for integration into
+  /// poll/epoll event loops. Call acquire() when readable. The camera owns the descriptor; do not
+  /// read from or close it
+  [[nodiscard]] auto eventFd() const -> int;
+
+  /// Change the streams (resolution, formats, buffers) and queue policies of the camera, without
+  /// releasing it or restarting the camera manager. Capture stops, the camera is reconfigured and
+  /// capture restarts. Buffers of streams whose format, size and buffer count are unchanged are
+  /// kept; the others are reallocated. Frames completed but not yet acquired are dropped.
+  /// Must be called from the thread that acquires frames, with all frame handles released
+  /// (throws std::logic_error otherwise), including frames held by clients of a FrameBusServer;
+  /// call FrameBusServer::reconfigure() afterwards. The camera name hint and completion thread
+  /// settings are ignored, since the camera stays acquired. If reconfiguration throws, the camera
+  /// is left stopped and can only be destroyed
+  /// @param config New capture configuration
+  void reconfigure(const Config& config);
+
+  /// Format of the frames a stream delivers with the current configuration. Timestamps,
+  /// sequence number and metadata are zero
+  /// @param stream Index of the stream, in Config::streams
+  /// @return Header with the size, pixel format, pitch and colour space of the stream
+  [[nodiscard]] auto streamFormat(std::size_t stream = 0) const -> ImageFrame::Header;
+
+  /// Change capture controls. Thread-safe and does not block capture. The values are attached to
+  /// the next request queued to the camera; calls made before that are merged, later ones
+  /// overriding earlier ones. Throws std::invalid_argument if the camera does not support a
+  /// control or a value is out of range
+  /// @param controls Controls to change
+  /// @return Id of this change, reported in CaptureMetadata::controls_id of frames whose request
+  /// carried it or a later change
+  auto setControls(const Controls& controls) -> std::uint64_t;
+
+  /// @return Number of frames dropped so far
+  [[nodiscard]] auto dropCounters() const -> DropCounters;
+
+  /// @return Snapshot of capture statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
 
   ~Camera();
   Camera(const Camera&) = delete;
@@ -43,6 +278,7 @@ public:
   auto operator=(Camera&&) = delete;
 
 private:
+  friend class FrameHandle;
   struct Impl;
   std::unique_ptr<Impl> impl_;
 };
@@ -0,0 +1,219 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "camera_group.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <deque>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <poll.h>
+
+namespace picam {
+
+namespace {
+
+//-------------------------------------------------------------------------------------------------
+/// @return Camera configurations with the ids of distinct cameras filled in. Cameras named by id
+/// are taken first, then each name hint takes the first matching camera still free
+auto resolveCameraIds(std::vector<Camera::Config> configs) -> std::vector<Camera::Config> {
+  const auto available = Camera::list();
+  auto taken = std::vector<bool>(available.size(), false);
+  for (const auto& config : configs) {
+    for (std::size_t i = 0; i < available.size(); ++i) {
+      if (available[i].id == config.camera_id) {
+        taken[i] = true;
+      }
+    }
+  }
+  for (auto& config : configs) {
+    if (not config.camera_id.empty()) {
+      continue;
+    }
+    auto found = false;
+    for (std::size_t i = 0; (i < available.size()) && not found; ++i) {
+      const auto& model = available[i].model;
+      if ((not taken[i]) && (model.find(config.camera_name_hint) != std::string::npos)) {
+        config.camera_id = available[i].id;
+        taken[i] = true;
+        found = true;
+      }
+    }
+    if (not found) {
+      throw std::runtime_error(
+          std::format("No free camera matching '{}' for camera group", config.camera_name_hint));
+    }
+  }
+  return configs;
+}
+
+}  // namespace
+
+//-------------------------------------------------------------------------------------------------
+struct CameraGroup::Impl {
+  std::vector<std::unique_ptr<Camera>> cameras;
+  Callback callback{ nullptr };
+  std::chrono::nanoseconds tolerance{};
+  std::size_t max_pending{ 1 };
+
+  // Captures waiting for partners, oldest first. One queue per camera. Declared after the
+  // cameras, so that they are released first
+  std::vector<std::deque<FrameHandle>> pending;
+  std::vector<pollfd> poll_fds;
+
+  // Instrumentation
+  std::atomic_uint64_t matched_count{ 0 };
+  std::atomic_uint64_t unmatched_count{ 0 };
+  DurationHistogram skew;
+
+  void collect();
+  auto match() -> std::vector<FrameHandle>;
+  void dropOldest(std::deque<FrameHandle>& queue);
+};
+
+//-------------------------------------------------------------------------------------------------
+void CameraGroup::Impl::collect() {
+  for (std::size_t i = 0; i < cameras.size(); ++i) {
+    auto& queue = pending.at(i);
+    while (auto handle = cameras[i]->acquireFrame()) {
+      queue.push_back(std::move(handle));
+      if (queue.size() > max_pending) {
+        dropOldest(queue);
+      }
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto CameraGroup::Impl::match() -> std::vector<FrameHandle> {
+  const auto timestamp = [](const std::deque<FrameHandle>& queue) {
+    return queue.front()->header.timestamp;
+  };
+  const auto is_empty = [](const std::deque<FrameHandle>& queue) { return queue.empty(); };
+
+  while (std::ranges::none_of(pending, is_empty)) {
+    // Captures more than the tolerance older than the latest of the oldest captures cannot be
+    // paired: every capture still to come from that camera is later still
+    auto latest = SensorClock::time_point::min();
+    for (const auto& queue : pending) {
+      latest = std::max(latest, timestamp(queue));
+    }
+    for (auto& queue : pending) {
+      while ((not queue.empty()) && (latest - timestamp(queue) > tolerance)) {
+        dropOldest(queue);
+      }
+    }
+    if (std::ranges::any_of(pending, is_empty)) {
+      break;
+    }
+
+    // Otherwise the oldest captures are within the tolerance, unless dropping revealed a later
+    // one, which sets a new reference
+    const auto is_later = [&](const std::deque<FrameHandle>& queue) {
+      return timestamp(queue) > latest;
+    };
+    if (std::ranges::any_of(pending, is_later)) {
+      continue;
+    }
+    auto earliest = latest;
+    auto set = std::vector<FrameHandle>{};
+    set.reserve(pending.size());
+    for (auto& queue : pending) {
+      earliest = std::min(earliest, timestamp(queue));
+      set.push_back(std::move(queue.front()));
+      queue.pop_front();
+    }
+    skew.record(latest - earliest);
+    matched_count.fetch_add(1, std::memory_order_relaxed);
+    return set;
+  }
+  return {};
+}
+
+//-------------------------------------------------------------------------------------------------
+void CameraGroup::Impl::dropOldest(std::deque<FrameHandle>& queue) {
+  queue.pop_front();
+  unmatched_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+CameraGroup::CameraGroup(const Config& config, Callback&& callback)
+  : impl_(std::make_unique<Impl>()) {
+  if (config.cameras.empty()) {
+    throw std::invalid_argument("Camera group needs at least one camera");
+  }
+  impl_->callback = std::move(callback);
+  impl_->tolerance = config.sync_tolerance;
+  impl_->max_pending = std::max<std::size_t>(config.max_pending, 1);
+
+  // Started once for resolving ids and opening every camera, rather than once each
+  const auto camera_manager = Camera::holdCameraManager();
+  for (const auto& camera_config : resolveCameraIds(config.cameras)) {
+    impl_->cameras.push_back(std::make_unique<Camera>(camera_config, Camera::Callback{}));
+    impl_->poll_fds.push_back(
+        { .fd = impl_->cameras.back()->eventFd(), .events = POLLIN, .revents = 0 });
+  }
+  impl_->pending.resize(impl_->cameras.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+CameraGroup::~CameraGroup() = default;
+
+//-------------------------------------------------------------------------------------------------
+auto CameraGroup::acquire(std::chrono::milliseconds timeout) -> bool {
+  const auto set = acquireSet(timeout);
+  if (set.empty()) {
+    return false;
+  }
+  if (impl_->callback) {
+    impl_->callback(set);
+  }
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto CameraGroup::acquireSet(std::chrono::milliseconds timeout) -> std::vector<FrameHandle> {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    impl_->collect();
+    if (auto set = impl_->match(); not set.empty()) {
+      return set;
+    }
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      return {};
+    }
+    // Wakes when any camera has a capture
+    const auto ret =
+        poll(impl_->poll_fds.data(), impl_->poll_fds.size(), static_cast<int>(remaining.count()));
+    if ((ret < 0) && (errno != EINTR)) {
+      throw std::runtime_error("Failed to wait for camera frames");
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto CameraGroup::size() const -> std::size_t {
+  return impl_->cameras.size();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto CameraGroup::camera(std::size_t index) -> Camera& {
+  return *impl_->cameras.at(index);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto CameraGroup::stats() const -> Stats {
+  return { .matched = impl_->matched_count.load(std::memory_order_relaxed),
+           .unmatched = impl_->unmatched_count.load(std::memory_order_relaxed),
+           .skew = impl_->skew.snapshot() };
+}
+
+}  // namespace picam
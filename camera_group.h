@@ -0,0 +1,94 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "camera.h"
+#include "frame_handle.h"
+#include "stats.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Several cameras captured together, e.g. the sensors of a stereo rig. Captures of the cameras
+/// are paired by sensor timestamp and delivered as matched sets, one capture per camera.
+///
+/// The cameras share the libcamera camera manager, so their requests complete on the same
+/// libcamera thread, and one consumer thread waits on all of them. Sensors that are not
+/// hardware-synchronised drift relative to each other; captures whose partners are outside the
+/// tolerance are dropped rather than mispaired. Lock the frame rate of all sensors to the same
+/// value (Camera::Controls::frame_duration_limits) to keep them in step
+class CameraGroup {
+public:
+  /// Receives a matched set: one capture per camera, in the order of Config::cameras
+  using Callback = std::function<void(std::span<const FrameHandle> captures)>;
+
+  struct Config {
+    /// Configuration of each camera. Name hints are resolved to distinct cameras in order: each
+    /// opens the first camera matching its hint that an earlier entry has not taken. Image
+    /// callbacks of the cameras are not used. Give each camera its own config_cache_path
+    std::vector<Camera::Config> cameras{};
+
+    /// Largest difference between the start-of-exposure times of the captures in a set
+    std::chrono::microseconds sync_tolerance{ 1000 };
+
+    /// Captures of each camera kept while waiting for the others. Held captures keep their
+    /// buffers from the camera; more than two rarely helps
+    std::size_t max_pending{ 2 };
+  };
+
+  /// Synchronisation instrumentation. Counters are updated with relaxed atomics
+  struct Stats {
+    std::uint64_t matched{};    //!< Sets delivered
+    std::uint64_t unmatched{};  //!< Captures dropped without a partner within the tolerance
+    DurationStats skew;         //!< Spread of start-of-exposure times within delivered sets
+  };
+
+  /// Open and start all cameras
+  /// @param config Group configuration
+  /// @param callback Callback for matched sets, triggered by acquire()
+  CameraGroup(const Config& config, Callback&& callback);
+
+  /// Wait for a matched set and trigger the callback with it. The captures are only valid
+  /// inside the callback unless cloned
+  /// @param timeout Maximum time to wait
+  /// @return true if a set was delivered, false on timeout
+  auto acquire(std::chrono::milliseconds timeout) -> bool;
+
+  /// Wait for a matched set. Callbacks are not triggered
+  /// @param timeout Maximum time to wait
+  /// @return One capture per camera, or an empty vector on timeout
+  auto acquireSet(std::chrono::milliseconds timeout) -> std::vector<FrameHandle>;
+
+  /// @return Number of cameras in the group
+  [[nodiscard]] auto size() const -> std::size_t;
+
+  /// @param index Index of the camera in Config::cameras
+  /// @return The camera, e.g. to change its controls or read its statistics
+  [[nodiscard]] auto camera(std::size_t index) -> Camera&;
+
+  /// @return Snapshot of synchronisation statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  /// Frame handles of the group must be released before it is destroyed
+  ~CameraGroup();
+  CameraGroup(const CameraGroup&) = delete;
+  CameraGroup(CameraGroup&&) = delete;
+  auto operator=(const CameraGroup&) = delete;
+  auto operator=(CameraGroup&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
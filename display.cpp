@@ -4,15 +4,25 @@
 
 #include "display.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <optional>
 #include <print>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
+#define EGL_NO_X11
+#define GLFW_EXPOSE_NATIVE_EGL
+#include <GLFW/glfw3native.h>
 
 // Load OpenGL functions via GLFW
 #define GL_GLEXT_PROTOTYPES
@@ -20,70 +30,223 @@
 #include <GL/glext.h>
 #include <libcamera/formats.h>
 
+#include "dmabuf_importer.h"
+#include "pixel_convert.h"
+
 namespace {
+
+/// From OES_EGL_image_external (not part of the desktop GL headers)
+constexpr GLenum TEXTURE_EXTERNAL_OES = 0x8D65;
+
+/// From EXT_disjoint_timer_query (not part of the desktop GL headers)
+constexpr GLenum TIME_ELAPSED_EXT = 0x88BF;
+constexpr GLenum GPU_DISJOINT_EXT = 0x8FBB;
+using GlGetQueryObjectUi64vExt = void (*)(GLuint id, GLenum pname, GLuint64* params);
+
+/// Upper bound on waiting for the GPU to release a resource
+constexpr auto FENCE_TIMEOUT_NS = GLuint64{ 1'000'000'000 };
+
+constexpr auto RGB_BYTES_PER_PIXEL = 3U;
+
+/// Context API extensions accepting a negative swap interval for adaptive vsync
+constexpr auto ADAPTIVE_VSYNC_EXTENSIONS = std::array{
+  "GLX_EXT_swap_control_tear", "WGL_EXT_swap_control_tear", "EGL_EXT_swap_control_tear"
+};
+
+/// Plane arrangement of YUV formats converted in the fragment shader. Values are passed to the
+/// shader as-is
+enum class YuvLayout : GLint {
+  Packed422 = 0,      //!< YUYV: one RGBA8 texel holds Y0 U Y1 V for two pixels
+  SemiPlanar420 = 1,  //!< NV12: R8 luma plane and RG8 interleaved chroma plane at half resolution
+  Planar420 = 2       //!< YUV420: R8 luma plane and two R8 chroma planes at half resolution
+};
+
+/// Texture holding one plane of a YUV format
+struct YuvPlaneTexture {
+  GLenum internal_format{};
+  GLenum format{};
+  GLuint texel_bytes{};
+  GLsizei width_divisor{ 1 };  //!< Texels per row relative to image width
+  GLsizei height_divisor{ 1 };
+  GLint filter{ GL_LINEAR };
+};
+
+constexpr auto MAX_YUV_PLANES = picam::ImageFrame::MAX_PLANES;
+
+//-------------------------------------------------------------------------------------------------
+auto yuvLayout(std::uint32_t format) -> std::optional<YuvLayout> {
+  if (format == libcamera::formats::YUYV) {
+    return YuvLayout::Packed422;
+  }
+  if (format == libcamera::formats::NV12) {
+    return YuvLayout::SemiPlanar420;
+  }
+  if (format == libcamera::formats::YUV420) {
+    return YuvLayout::Planar420;
+  }
+  return std::nullopt;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto yuvPlaneTextures(YuvLayout layout) -> std::span<const YuvPlaneTexture> {
+  // clang-format off
+  static constexpr auto PACKED_422 = std::array{
+    YuvPlaneTexture{ GL_RGBA8, GL_RGBA, 4, 2, 1, GL_NEAREST }
+  };
+  static constexpr auto SEMI_PLANAR_420 = std::array{
+    YuvPlaneTexture{ GL_R8, GL_RED, 1, 1, 1, GL_LINEAR },
+    YuvPlaneTexture{ GL_RG8, GL_RG, 2, 2, 2, GL_LINEAR }
+  };
+  static constexpr auto PLANAR_420 = std::array{
+    YuvPlaneTexture{ GL_R8, GL_RED, 1, 1, 1, GL_LINEAR },
+    YuvPlaneTexture{ GL_R8, GL_RED, 1, 2, 2, GL_LINEAR },
+    YuvPlaneTexture{ GL_R8, GL_RED, 1, 2, 2, GL_LINEAR }
+  };
+  // clang-format on
+  switch (layout) {
+    case YuvLayout::Packed422:
+      return PACKED_422;
+    case YuvLayout::SemiPlanar420:
+      return SEMI_PLANAR_420;
+    case YuvLayout::Planar420:
+      return PLANAR_420;
+  }
+  return {};
+}
+
+/// Texture holding the samples of a raw Bayer format as stored: the bytes of 8-bit and CSI-2 packed
+/// rows in R8 texels, and 16-bit samples in RG8 texels. Unpacking is left to the shader
+struct RawPlaneTexture {
+  GLenum internal_format{};
+  GLenum format{};
+  GLuint texel_bytes{};
+  GLsizei width{};  //!< Texels per row
+};
+
+//-------------------------------------------------------------------------------------------------
+auto rawPlaneTexture(const picam::BayerFormat& bayer, std::uint32_t width) -> RawPlaneTexture {
+  if (bayer.packing == picam::BayerFormat::Packing::Unpacked) {
+    return { GL_RG8, GL_RG, 2, static_cast<GLsizei>(width) };
+  }
+  return { GL_R8, GL_RED, 1, static_cast<GLsizei>(bayer.rowBytes(width)) };
+}
+
 //-------------------------------------------------------------------------------------------------
 void glfwErrorCallback(int error, const char* description) {
   std::println(stderr, "GLFW Error {}: {}", error, description);
 }
 
 //-------------------------------------------------------------------------------------------------
-// NOLINTBEGIN
-// The following is vibe-coded. I take no responsibility for anything
-void convertToRGB(const picam::ImageFrame& frame, std::vector<std::uint8_t>& rgb_data) {
-  const auto width = frame.header.size.width;
-  const auto height = frame.header.size.height;
-  const auto pitch = frame.header.pitch;
-  const auto* src = reinterpret_cast<const std::uint8_t*>(frame.pixels.data());
-
-  rgb_data.resize(width * height * 3);
-  const auto format = frame.header.format;
+/// @return Swap interval implementing the present mode. Needs a current context
+auto swapInterval(picam::Display::PresentMode mode) -> int {
+  if (mode == picam::Display::PresentMode::Vsync) {
+    return 1;
+  }
+  // A negative interval selects adaptive vsync. GLFW looks the extension up in the strings of the
+  // context API in use (GLX, WGL or EGL)
+  const auto has_adaptive = std::ranges::any_of(ADAPTIVE_VSYNC_EXTENSIONS, [](const char* name) {
+    return glfwExtensionSupported(name) == GLFW_TRUE;
+  });
+  return has_adaptive ? -1 : 0;
+}
 
-  if (format == libcamera::formats::RGB888) {
-    for (std::uint32_t y = 0; y < height; ++y) {
-      std::memcpy(&rgb_data[y * width * 3], &src[y * pitch], width * 3);
-    }
-  } else if (format == libcamera::formats::YUYV) {
-    // Convert YUYV (YUV 4:2:2) to RGB
-    // YUYV format: Y0 U0 Y1 V0 (4 bytes for 2 pixels)
-    for (std::uint32_t y = 0; y < height; ++y) {
-      const auto* row = &src[y * pitch];
-      auto* rgb_row = &rgb_data[y * width * 3];
-
-      for (std::uint32_t x = 0; x < width; x += 2) {
-        const int y0 = row[x * 2];
-        const int u = row[x * 2 + 1];
-        const int y1 = row[x * 2 + 2];
-        const int v = row[x * 2 + 3];
-
-        // YUV to RGB conversion (ITU-R BT.601)
-        const int c0 = y0 - 16;
-        const int c1 = y1 - 16;
-        const int d = u - 128;
-        const int e = v - 128;
-
-        // Pixel 0
-        rgb_row[x * 3] = std::clamp((298 * c0 + 409 * e + 128) >> 8, 0, 255);
-        rgb_row[x * 3 + 1] = std::clamp((298 * c0 - 100 * d - 208 * e + 128) >> 8, 0, 255);
-        rgb_row[x * 3 + 2] = std::clamp((298 * c0 + 516 * d + 128) >> 8, 0, 255);
-
-        // Pixel 1
-        rgb_row[(x + 1) * 3] = std::clamp((298 * c1 + 409 * e + 128) >> 8, 0, 255);
-        rgb_row[(x + 1) * 3 + 1] = std::clamp((298 * c1 - 100 * d - 208 * e + 128) >> 8, 0, 255);
-        rgb_row[(x + 1) * 3 + 2] = std::clamp((298 * c1 + 516 * d + 128) >> 8, 0, 255);
-      }
-    }
-  } else {
-    // Unsupported format - fill with magenta as error indicator
-    std::println(stderr, "Warning: Unsupported pixel format ({}), displaying error pattern",
-                 format);
-    for (std::size_t i = 0; i < rgb_data.size(); i += 3) {
-      rgb_data[i] = 255;      // R
-      rgb_data[i + 1] = 0;    // G
-      rgb_data[i + 2] = 255;  // B
+//-------------------------------------------------------------------------------------------------
+/// Convert to RGB888 with the converter of the frame format, selected again when it changes
+void convertForDisplay(std::optional<picam::PixelConverter>& converter,
+                       const picam::ImageFrame& frame, std::span<std::byte> rgb_bytes) {
+  const auto rgb_data = std::span(reinterpret_cast<std::uint8_t*>(rgb_bytes.data()),  // NOLINT
+                                  rgb_bytes.size());
+  if (not converter || not converter->accepts(frame.header)) {
+    converter.reset();
+    if (picam::PixelConverter::supports(frame.header)) {
+      converter.emplace(frame.header, picam::OutputFormat::Rgb888);
     }
   }
+  // Frames without CPU access (camera configured not to map buffers) can only be imported
+  const auto has_pixels = (frame.plane_count > 0) && not frame.planes[0].data.empty();
+  if (has_pixels && converter) {
+    converter->convert(frame, rgb_data);
+    return;
+  }
+
+  // Unsupported format - fill with magenta as error indicator
+  std::println(stderr, "Warning: Unsupported pixel format ({}){}, displaying error pattern",
+               frame.header.format, has_pixels ? "" : " or no CPU access");
+  for (std::size_t i = 0; i + 2 < rgb_data.size(); i += RGB_BYTES_PER_PIXEL) {
+    rgb_data[i] = UINT8_MAX;      // R
+    rgb_data[i + 1] = 0;          // G
+    rgb_data[i + 2] = UINT8_MAX;  // B
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return New texture with immutable storage
+auto createTexture(GLenum internal_format, GLsizei width, GLsizei height, GLint filter) -> GLuint {
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, internal_format, width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto compileProgram(const char* vertex_shader_source, const char* fragment_shader_source)
+    -> GLuint {
+  // Compile vertex shader
+  const auto vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
+  glCompileShader(vertex_shader);
+
+  static constexpr auto LOG_BUFFER_SIZE = 512;
+  using LogBuffer = std::array<char, LOG_BUFFER_SIZE>;
+
+  GLint success = 0;
+  glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+  if (success == 0) {
+    auto info_log = LogBuffer{};
+    glGetShaderInfoLog(vertex_shader, info_log.size(), nullptr, info_log.data());
+    glDeleteShader(vertex_shader);
+    throw std::runtime_error(std::string("Vertex shader compilation failed: ") + info_log.data());
+  }
+
+  // Compile fragment shader
+  const auto fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
+  glCompileShader(fragment_shader);
+
+  glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+  if (success == 0) {
+    auto info_log = LogBuffer{};
+    glGetShaderInfoLog(fragment_shader, info_log.size(), nullptr, info_log.data());
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    throw std::runtime_error(std::string("Fragment shader compilation failed: ") + info_log.data());
+  }
+
+  const auto program = glCreateProgram();
+  glAttachShader(program, vertex_shader);
+  glAttachShader(program, fragment_shader);
+  glLinkProgram(program);
+
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == 0) {
+    auto info_log = LogBuffer{};
+    glGetProgramInfoLog(program, info_log.size(), nullptr, info_log.data());
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    glDeleteProgram(program);
+    throw std::runtime_error(std::string("Shader program linking failed: ") + info_log.data());
+  }
+
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+  return program;
 }
-// NOLINTEND
 
 }  // namespace
 
@@ -91,24 +254,120 @@ namespace picam {
 
 //-------------------------------------------------------------------------------------------------
 struct Display::Impl {
+  /// Texture a view is rendered from
+  enum class Source : std::uint8_t { Rgb, Yuv, Raw, External };
+
+  /// Textures of one displayed feed. Storage is allocated once per format
+  struct View {
+    Source source{ Source::Rgb };
+    ImageFrame::Header frame_header{};  // Of the frame shown
+
+    GLuint texture_id{ 0 };  // RGB888, converted on the CPU if necessary
+    ImageFrame::Header rgb_storage_header{};
+    std::optional<PixelConverter> converter;  // CPU conversion of the current format
+
+    GLuint external_texture_id{ 0 };  // Imported dmabuf texture of the current frame, if any
+
+    // Raw YUV planes for conversion in the fragment shader
+    std::array<GLuint, MAX_YUV_PLANES> yuv_textures{};
+    ImageFrame::Header yuv_storage_header{};
+    YuvLayout yuv_layout{ YuvLayout::Packed422 };
+
+    // Raw Bayer samples for unpacking and demosaicing in the fragment shader
+    GLuint raw_texture{ 0 };
+    ImageFrame::Header raw_storage_header{};
+    BayerFormat raw_format{};
+  };
+
+  Display::Config config;
   GLFWwindow* window{ nullptr };
-  GLuint texture_id{ 0 };
-  ImageFrame::Header current_frame_header{};
-  std::vector<std::uint8_t> rgb_buffer;  // For pixel format conversion
+  std::unique_ptr<DmaBufImporter> importer;
+  std::vector<View> views = std::vector<View>(1);  // Tiled in a grid, in row order
+
+  // Presentation state
+  bool has_new_frames{ false };    // Updated since the last swap
+  bool is_drawn{ false };          // The back buffer holds the updated frames
+  bool is_redraw_needed{ false };  // Window resized or exposed since the last swap
+
+  /// Region of a texture updated from a pixel unpack buffer
+  struct TextureUpload {
+    GLuint texture{ 0 };
+    GLenum format{ GL_RGB };
+    GLsizei width{};
+    GLsizei height{};
+    std::size_t pitch{};        // Source bytes per row. Must be a multiple of texel_bytes
+    std::size_t texel_bytes{};  // Source bytes per texel
+  };
+
+  // Pixel unpack buffers that uploads are streamed through. The CPU fills one while the GPU may
+  // still be copying from the others, and a fence per buffer guards against overwriting data
+  // the GPU has not consumed yet
+  struct UploadBuffer {
+    GLuint pbo{ 0 };
+    std::size_t size{ 0 };
+    GLsync fence{ nullptr };
+  };
+  static constexpr auto UPLOAD_BUFFER_COUNT = 3U;
+  std::array<UploadBuffer, UPLOAD_BUFFER_COUNT> upload_buffers{};
+  std::size_t next_upload_buffer{ 0 };
 
   GLuint shader_program{ 0 };
+  GLuint external_program{ 0 };
+  GLuint yuv_program{ 0 };
+  GLint yuv_layout_location{ -1 };
+  GLint yuv_matrix_location{ -1 };
+  GLint yuv_offset_location{ -1 };
+  GLuint raw_program{ 0 };
+  GLint raw_packing_location{ -1 };
+  GLint raw_depth_location{ -1 };
+  GLint raw_size_location{ -1 };
+  GLint raw_offset_location{ -1 };
   GLuint vao{ 0 };
   GLuint vbo{ 0 };
 
-  float image_aspect_ratio{ 1.0F };
+  // Instrumentation
+  std::atomic_uint64_t frame_count{ 0 };
+  std::atomic_uint64_t presented_count{ 0 };
+  DurationHistogram convert_time;
+  DurationHistogram upload_time;
+  DurationHistogram render_time;
+  DurationHistogram swap_time;
+  DurationHistogram gpu_time;
+
+  // GPU timer queries, read back a few frames later so that collecting results never stalls
+  static constexpr auto GPU_QUERY_COUNT = 4U;
+  GlGetQueryObjectUi64vExt get_query_result{ nullptr };  // null if timer queries are unsupported
+  std::array<GLuint, GPU_QUERY_COUNT> gpu_queries{};
+  std::array<bool, GPU_QUERY_COUNT> gpu_query_pending{};
+  std::size_t next_gpu_query{ 0 };
+  bool gpu_query_active{ false };
 
   void initWindow();
+  static void requestRedraw(GLFWwindow* window);
+  void initImporter();
   void initGL();
+  void initGpuTimer();
+  void beginGpuTimer();
+  void endGpuTimer();
+  void collectGpuTimes();
   void createShaders();
   void setupQuad();
-  void uploadTexture(const std::uint8_t* rgb_data, const ImageSize& size) const;
-  void updateQuadForLetterbox() const;
-  void render() const;
+  template <typename Fill>
+  void streamUpload(const TextureUpload& upload, Fill&& fill);
+  void upload(View& view, const ImageFrame& frame);
+  void uploadRgb(View& view, const ImageFrame& frame);
+  static void allocateRgbTexture(View& view, const ImageFrame::Header& header);
+  static void allocateYuvTextures(View& view, const ImageFrame::Header& header, YuvLayout layout);
+  auto uploadYuvPlanes(View& view, const ImageFrame& frame) -> bool;
+  static void allocateRawTexture(View& view, const ImageFrame::Header& header,
+                                 const BayerFormat& bayer);
+  auto uploadRaw(View& view, const ImageFrame& frame) -> bool;
+  void allocateTextures(View& view, const ImageFrame::Header& header) const;
+  void resizeViews(std::size_t count);
+  static void releaseView(View& view);
+  [[nodiscard]] auto isImported() const -> bool;
+  void draw(const View& view) const;
+  void render();
   void cleanup();
 };
 
@@ -125,6 +384,10 @@ void Display::Impl::initWindow() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+  if (config.import_dmabuf) {
+    // dmabuf import needs an EGL display
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+  }
 
   static constexpr auto DEFAULT_WIDTH = 1280;
   static constexpr auto DEFAULT_HEIGHT = 720;
@@ -134,7 +397,17 @@ void Display::Impl::initWindow() {
     throw std::runtime_error("Failed to create GLFW window");
   }
   glfwMakeContextCurrent(window);
-  glfwSwapInterval(1);
+  glfwSwapInterval(swapInterval(config.present_mode));
+
+  // Frames are presented only when new ones arrive. Redraw the current ones when the window changes
+  glfwSetWindowUserPointer(window, this);
+  glfwSetWindowRefreshCallback(window, [](GLFWwindow* w) { requestRedraw(w); });
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int, int) { requestRedraw(w); });
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::requestRedraw(GLFWwindow* window) {
+  static_cast<Impl*>(glfwGetWindowUserPointer(window))->is_redraw_needed = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -166,54 +439,146 @@ void Display::Impl::createShaders() {
     }
   )";
 
-  // Compile vertex shader
-  const auto vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
-  glCompileShader(vertex_shader);
-
-  static constexpr auto LOG_BUFFER_SIZE = 512;
-  using LogBuffer = std::array<char, LOG_BUFFER_SIZE>;
+  // Samples imported dmabufs. The texture unit performs any YUV to RGB conversion
+  const char* external_fragment_shader_source = R"(
+    #version 300 es
+    #extension GL_OES_EGL_image_external_essl3 : require
+    precision mediump float;
+    
+    in vec2 TexCoord;
+    out vec4 FragColor;
+    
+    uniform samplerExternalOES textureSampler;
+    
+    void main() {
+      FragColor = texture(textureSampler, TexCoord);
+    }
+  )";
 
-  GLint success = 0;
-  glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-  if (success == 0) {
-    auto info_log = LogBuffer{};
-    glGetShaderInfoLog(vertex_shader, info_log.size(), nullptr, info_log.data());
-    glDeleteShader(vertex_shader);
-    throw std::runtime_error(std::string("Vertex shader compilation failed: ") + info_log.data());
-  }
+  // Converts raw YUV planes to RGB. Packed 4:2:2 is fetched texel-exact since each texel holds
+  // two luma samples; 4:2:0 formats use the hardware bilinear filter on all planes
+  const char* yuv_fragment_shader_source = R"(
+    #version 300 es
+    precision highp float;
+    precision highp int;
+    
+    in vec2 TexCoord;
+    out vec4 FragColor;
+    
+    uniform sampler2D plane0;  // YUYV: Y0 U Y1 V at half width. NV12, YUV420: Y
+    uniform sampler2D plane1;  // NV12: UV, YUV420: U. At half width and height
+    uniform sampler2D plane2;  // YUV420: V at half width and height
+    uniform int planeLayout;   // 0: YUYV, 1: NV12, 2: YUV420
+    uniform mat3 yuvToRgb;
+    uniform vec3 yuvOffset;
+    
+    void main() {
+      vec3 yuv;
+      if (planeLayout == 0) {
+        ivec2 size = textureSize(plane0, 0);
+        int x = clamp(int(TexCoord.x * float(size.x * 2)), 0, size.x * 2 - 1);
+        int y = clamp(int(TexCoord.y * float(size.y)), 0, size.y - 1);
+        vec4 texel = texelFetch(plane0, ivec2(x / 2, y), 0);
+        yuv = vec3(((x & 1) == 0) ? texel.r : texel.b, texel.g, texel.a);
+      } else if (planeLayout == 1) {
+        yuv = vec3(texture(plane0, TexCoord).r, texture(plane1, TexCoord).rg);
+      } else {
+        yuv = vec3(texture(plane0, TexCoord).r, texture(plane1, TexCoord).r,
+                   texture(plane2, TexCoord).r);
+      }
+      FragColor = vec4(clamp(yuvToRgb * (yuv - yuvOffset), 0.0, 1.0), 1.0);
+    }
+  )";
 
-  // Compile fragment shader
-  const auto fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
-  glCompileShader(fragment_shader);
+  // Unpacks raw Bayer samples and demosaics them by bilinear interpolation, like the CPU kernels
+  // but at full sample precision. Samples are fetched texel-exact; those one past the edges of
+  // the image are mirrored by two, which keeps their colour
+  const char* raw_fragment_shader_source = R"(
+    #version 300 es
+    precision highp float;
+    precision highp int;
+    
+    in vec2 TexCoord;
+    out vec4 FragColor;
+    
+    uniform sampler2D rawSamples;  // R8: 8-bit samples or CSI-2 packed bytes. RG8: 16-bit
+    uniform int packing;           // BayerFormat::Packing. 0: 8-bit, 1: 16-bit LE, 2: CSI-2
+    uniform int bitDepth;
+    uniform ivec2 imageSize;
+    uniform ivec2 redOffset;       // Column and row of the red sample in each 2x2 block
+    
+    int byteAt(int x, int y) {
+      return int(texelFetch(rawSamples, ivec2(x, y), 0).r * 255.0 + 0.5);
+    }
+    
+    float fetch(int x, int y) {
+      x = (x < 0) ? 1 : ((x >= imageSize.x) ? imageSize.x - 2 : x);
+      y = (y < 0) ? 1 : ((y >= imageSize.y) ? imageSize.y - 2 : y);
+      int value;
+      if (packing == 0) {
+        value = byteAt(x, y);
+      } else if (packing == 1) {
+        ivec2 bytes = ivec2(texelFetch(rawSamples, ivec2(x, y), 0).rg * 255.0 + 0.5);
+        value = bytes.r | (bytes.g << 8);
+      } else if (bitDepth == 10) {
+        // 4 samples in 5 bytes: most significant bits, then 2 low bits of each in the last byte
+        int group = (x / 4) * 5;
+        int lane = x % 4;
+        value = (byteAt(group + lane, y) << 2) | ((byteAt(group + 4, y) >> (2 * lane)) & 3);
+      } else {
+        // 2 samples in 3 bytes: most significant bits, then 4 low bits of each in the last byte
+        int group = (x / 2) * 3;
+        int lane = x % 2;
+        value = (byteAt(group + lane, y) << 4) | ((byteAt(group + 2, y) >> (4 * lane)) & 15);
+      }
+      return float(value) / float((1 << bitDepth) - 1);
+    }
+    
+    void main() {
+      int x = clamp(int(TexCoord.x * float(imageSize.x)), 0, imageSize.x - 1);
+      int y = clamp(int(TexCoord.y * float(imageSize.y)), 0, imageSize.y - 1);
+      float c = fetch(x, y);
+      float horizontal = (fetch(x - 1, y) + fetch(x + 1, y)) * 0.5;
+      float vertical = (fetch(x, y - 1) + fetch(x, y + 1)) * 0.5;
+      float adjacent = (horizontal + vertical) * 0.5;
+      float diagonal = (fetch(x - 1, y - 1) + fetch(x + 1, y - 1) + fetch(x - 1, y + 1) +
+                        fetch(x + 1, y + 1)) * 0.25;
+      bool redColumn = ((x & 1) == redOffset.x);
+      vec3 rgb;
+      if ((y & 1) == redOffset.y) {
+        rgb = redColumn ? vec3(c, adjacent, diagonal) : vec3(horizontal, c, vertical);
+      } else {
+        rgb = redColumn ? vec3(vertical, c, horizontal) : vec3(diagonal, adjacent, c);
+      }
+      FragColor = vec4(rgb, 1.0);
+    }
+  )";
 
-  glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-  if (success == 0) {
-    auto info_log = LogBuffer{};
-    glGetShaderInfoLog(fragment_shader, info_log.size(), nullptr, info_log.data());
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    throw std::runtime_error(std::string("Fragment shader compilation failed: ") + info_log.data());
+  shader_program = compileProgram(vertex_shader_source, fragment_shader_source);
+  if (importer) {
+    external_program = compileProgram(vertex_shader_source, external_fragment_shader_source);
   }
-
-  shader_program = glCreateProgram();
-  glAttachShader(shader_program, vertex_shader);
-  glAttachShader(shader_program, fragment_shader);
-  glLinkProgram(shader_program);
-
-  glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-  if (success == 0) {
-    auto info_log = LogBuffer{};
-    glGetProgramInfoLog(shader_program, info_log.size(), nullptr, info_log.data());
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    glDeleteProgram(shader_program);
-    throw std::runtime_error(std::string("Shader program linking failed: ") + info_log.data());
+  if (config.gpu_yuv_conversion) {
+    yuv_program = compileProgram(vertex_shader_source, yuv_fragment_shader_source);
+    yuv_layout_location = glGetUniformLocation(yuv_program, "planeLayout");
+    yuv_matrix_location = glGetUniformLocation(yuv_program, "yuvToRgb");
+    yuv_offset_location = glGetUniformLocation(yuv_program, "yuvOffset");
+    glUseProgram(yuv_program);
+    glUniform1i(glGetUniformLocation(yuv_program, "plane0"), 0);
+    glUniform1i(glGetUniformLocation(yuv_program, "plane1"), 1);
+    glUniform1i(glGetUniformLocation(yuv_program, "plane2"), 2);
+    glUseProgram(0);
+  }
+  if (config.gpu_debayer) {
+    raw_program = compileProgram(vertex_shader_source, raw_fragment_shader_source);
+    raw_packing_location = glGetUniformLocation(raw_program, "packing");
+    raw_depth_location = glGetUniformLocation(raw_program, "bitDepth");
+    raw_size_location = glGetUniformLocation(raw_program, "imageSize");
+    raw_offset_location = glGetUniformLocation(raw_program, "redOffset");
+    glUseProgram(raw_program);
+    glUniform1i(glGetUniformLocation(raw_program, "rawSamples"), 0);
+    glUseProgram(0);
   }
-
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
 
   std::println(stdout, "OpenGL shaders compiled and linked successfully");
 }
@@ -235,10 +600,10 @@ void Display::Impl::setupQuad() {
   glGenVertexArrays(1, &vao);
   glBindVertexArray(vao);
 
-  // Generate and bind VBO (use GL_DYNAMIC_DRAW for letterbox updates)
+  // Generate and bind VBO. Views are letterboxed with the viewport, so it never changes
   glGenBuffers(1, &vbo);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES.data(), GL_DYNAMIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES.data(), GL_STATIC_DRAW);
 
   // Position attribute
   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
@@ -254,73 +619,424 @@ void Display::Impl::setupQuad() {
   glBindVertexArray(0);
 }
 
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::initImporter() {
+  if (not config.import_dmabuf) {
+    return;
+  }
+  importer = std::make_unique<DmaBufImporter>(glfwGetEGLDisplay());
+  if (not importer->isSupported()) {
+    std::println(stderr, "Warning: dmabuf import not supported, falling back to CPU upload");
+    importer.reset();
+    return;
+  }
+  std::println(stdout, "Zero-copy dmabuf import enabled");
+}
+
 //-------------------------------------------------------------------------------------------------
 void Display::Impl::initGL() {
+  initImporter();
   createShaders();
   setupQuad();
+  initGpuTimer();
 
-  // Create texture
-  glGenTextures(1, &texture_id);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-
-  // Set texture parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Texture storage is allocated on the first frame, and again only when the format changes
+  for (auto& buffer : upload_buffers) {
+    glGenBuffers(1, &buffer.pbo);
+  }
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+  // Rows of camera frames and converted images are not necessarily 4-byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
   std::println(stdout, "OpenGL initialized successfully");
+  std::println(stdout, "Pixel conversion using {} kernels", toString(bestSimdLevel()));
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::initGpuTimer() {
+  if (glfwExtensionSupported("GL_EXT_disjoint_timer_query") == GLFW_FALSE) {
+    std::println(stdout, "GPU timing unavailable (no GL_EXT_disjoint_timer_query)");
+    return;
+  }
+  // Only the 64-bit result query is specific to the extension. The rest is core in GLES 3.0
+  get_query_result = reinterpret_cast<GlGetQueryObjectUi64vExt>(  // NOLINT(*-reinterpret-cast)
+      glfwGetProcAddress("glGetQueryObjectui64vEXT"));
+  if (get_query_result != nullptr) {
+    glGenQueries(static_cast<GLsizei>(gpu_queries.size()), gpu_queries.data());
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::beginGpuTimer() {
+  // Skip timing this frame rather than wait, if the oldest query is still in flight. A query
+  // begun by an earlier update that was not presented yet covers this one too
+  if ((get_query_result == nullptr) || gpu_query_active || gpu_query_pending.at(next_gpu_query)) {
+    return;
+  }
+  glBeginQuery(TIME_ELAPSED_EXT, gpu_queries.at(next_gpu_query));
+  gpu_query_active = true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::endGpuTimer() {
+  if (not gpu_query_active) {
+    return;
+  }
+  glEndQuery(TIME_ELAPSED_EXT);
+  gpu_query_active = false;
+  gpu_query_pending.at(next_gpu_query) = true;
+  next_gpu_query = (next_gpu_query + 1) % GPU_QUERY_COUNT;
 }
 
 //-------------------------------------------------------------------------------------------------
-void Display::Impl::uploadTexture(const std::uint8_t* rgb_data, const ImageSize& size) const {
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, static_cast<GLsizei>(size.width),
-               static_cast<GLsizei>(size.height), 0, GL_RGB, GL_UNSIGNED_BYTE, rgb_data);
+void Display::Impl::collectGpuTimes() {
+  if (get_query_result == nullptr) {
+    return;
+  }
+
+  // A disjoint event (e.g. GPU frequency change) invalidates all timers in flight
+  GLint disjoint = 0;
+  glGetIntegerv(GPU_DISJOINT_EXT, &disjoint);
+
+  for (std::size_t i = 0; i < GPU_QUERY_COUNT; ++i) {
+    if (not gpu_query_pending.at(i)) {
+      continue;
+    }
+    GLuint available = 0;
+    glGetQueryObjectuiv(gpu_queries.at(i), GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == 0) {
+      continue;
+    }
+    gpu_query_pending.at(i) = false;
+    if (disjoint == 0) {
+      GLuint64 elapsed_ns = 0;
+      get_query_result(gpu_queries.at(i), GL_QUERY_RESULT, &elapsed_ns);
+      gpu_time.record(std::chrono::nanoseconds{ static_cast<std::int64_t>(elapsed_ns) });
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+template <typename Fill>
+void Display::Impl::streamUpload(const TextureUpload& upload, Fill&& fill) {
+  if ((upload.width <= 0) || (upload.height <= 0)) {
+    return;
+  }
+  const auto row_bytes = static_cast<std::size_t>(upload.width) * upload.texel_bytes;
+  const auto size = (upload.pitch * static_cast<std::size_t>(upload.height - 1)) + row_bytes;
+
+  auto& buffer = upload_buffers.at(next_upload_buffer);
+  next_upload_buffer = (next_upload_buffer + 1) % UPLOAD_BUFFER_COUNT;
+
+  if (buffer.fence != nullptr) {
+    glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+  if (buffer.size < size) {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    buffer.size = size;
+  }
+
+  // The fence above guarantees the GPU is done with this buffer, so skip the driver's implicit sync
+  static constexpr GLbitfield MAP_FLAGS =
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+  auto* mapped =
+      glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), MAP_FLAGS);
+  if (mapped == nullptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    std::println(stderr, "Warning: Failed to map pixel unpack buffer");
+    return;
+  }
+  std::forward<Fill>(fill)(std::span(static_cast<std::byte*>(mapped), size));
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glBindTexture(GL_TEXTURE_2D, upload.texture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(upload.pitch / upload.texel_bytes));
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, upload.width, upload.height, upload.format,
+                  GL_UNSIGNED_BYTE, nullptr);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
   glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 //-------------------------------------------------------------------------------------------------
-void Display::Impl::updateQuadForLetterbox() const {
-  // Get current window size
-  int window_width = 0;
-  int window_height = 0;
-  glfwGetFramebufferSize(window, &window_width, &window_height);
+void Display::Impl::uploadRgb(View& view, const ImageFrame& frame) {
+  const auto width = static_cast<GLsizei>(frame.header.size.width);
+  const auto height = static_cast<GLsizei>(frame.header.size.height);
+
+  if ((view.texture_id == 0) || not matchesFormat(frame.header, view.rgb_storage_header)) {
+    allocateRgbTexture(view, frame.header);
+  }
+
+  auto upload = TextureUpload{ .texture = view.texture_id,
+                               .format = GL_RGB,
+                               .width = width,
+                               .height = height,
+                               .pitch = static_cast<std::size_t>(width) * RGB_BYTES_PER_PIXEL,
+                               .texel_bytes = RGB_BYTES_PER_PIXEL };
+
+  // RGB888 is uploaded straight from the camera buffer, row padding included
+  const auto& plane = frame.planes[0];
+  const auto pitch = static_cast<std::size_t>(plane.stride);
+  const auto is_direct = (frame.header.format == libcamera::formats::RGB888) &&
+                         ((pitch % RGB_BYTES_PER_PIXEL) == 0) && (height > 0) &&
+                         (plane.data.size() >= (pitch * static_cast<std::size_t>(height - 1)) +
+                                                   upload.pitch);
+  if (is_direct) {
+    upload.pitch = pitch;
+    streamUpload(upload, [&plane](std::span<std::byte> dst) {
+      std::memcpy(dst.data(), plane.data.data(), dst.size());
+    });
+    return;
+  }
+
+  // Anything else is converted on the CPU, directly into the upload buffer
+  streamUpload(upload, [this, &view, &frame](std::span<std::byte> dst) {
+    const auto timer = ScopedTimer(convert_time);
+    convertForDisplay(view.converter, frame, dst);
+  });
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::allocateRgbTexture(View& view, const ImageFrame::Header& header) {
+  glDeleteTextures(1, &view.texture_id);
+  view.texture_id = createTexture(GL_RGB8, static_cast<GLsizei>(header.size.width),
+                                  static_cast<GLsizei>(header.size.height), GL_LINEAR);
+  view.rgb_storage_header = header;
+}
 
-  if (window_width == 0 || window_height == 0) {
-    return;  // Window minimized
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::allocateYuvTextures(View& view, const ImageFrame::Header& header,
+                                        YuvLayout layout) {
+  glDeleteTextures(static_cast<GLsizei>(view.yuv_textures.size()), view.yuv_textures.data());
+  view.yuv_textures = {};
+
+  const auto width = static_cast<GLsizei>(header.size.width);
+  const auto height = static_cast<GLsizei>(header.size.height);
+  const auto planes = yuvPlaneTextures(layout);
+  for (std::size_t i = 0; i < planes.size(); ++i) {
+    const auto& plane = planes[i];
+    view.yuv_textures.at(i) = createTexture(plane.internal_format, width / plane.width_divisor,
+                                            height / plane.height_divisor, plane.filter);
+  }
+  view.yuv_storage_header = header;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Display::Impl::uploadYuvPlanes(View& view, const ImageFrame& frame) -> bool {
+  const auto layout = yuvLayout(frame.header.format);
+  if ((yuv_program == 0) || not layout) {
+    return false;
   }
 
-  const float window_aspect = static_cast<float>(window_width) / static_cast<float>(window_height);
+  const auto width = static_cast<GLsizei>(frame.header.size.width);
+  const auto height = static_cast<GLsizei>(frame.header.size.height);
+  const auto planes = yuvPlaneTextures(*layout);
+  if (((width % 2) != 0) || ((height % 2) != 0) || (frame.plane_count < planes.size())) {
+    return false;
+  }
 
-  // Calculate letterbox dimensions
-  float quad_width = 1.0F;
-  float quad_height = 1.0F;
+  // Rows are addressed with GL_UNPACK_ROW_LENGTH, so pitch must be a whole number of texels
+  auto uploads = std::array<TextureUpload, MAX_YUV_PLANES>{};
+  for (std::size_t i = 0; i < planes.size(); ++i) {
+    const auto& plane = planes[i];
+    const auto& source = frame.planes.at(i);
+    auto& upload = uploads.at(i);
+    upload = { .texture = 0,
+               .format = plane.format,
+               .width = width / plane.width_divisor,
+               .height = height / plane.height_divisor,
+               .pitch = source.stride,
+               .texel_bytes = plane.texel_bytes };
+    const auto row_bytes = static_cast<std::size_t>(upload.width) * upload.texel_bytes;
+    const auto required_bytes =
+        (upload.pitch * static_cast<std::size_t>(upload.height - 1)) + row_bytes;
+    if (((upload.pitch % upload.texel_bytes) != 0) || (source.data.size() < required_bytes)) {
+      return false;
+    }
+  }
+
+  if ((view.yuv_textures[0] == 0) || not matchesFormat(frame.header, view.yuv_storage_header)) {
+    allocateYuvTextures(view, frame.header, *layout);
+  }
 
-  if (window_aspect > image_aspect_ratio) {
-    quad_width = image_aspect_ratio / window_aspect;
+  for (std::size_t i = 0; i < planes.size(); ++i) {
+    auto& upload = uploads.at(i);
+    upload.texture = view.yuv_textures.at(i);
+    const auto src = frame.planes.at(i).data;
+    streamUpload(upload, [src](std::span<std::byte> dst) {
+      std::memcpy(dst.data(), src.data(), dst.size());
+    });
+  }
+
+  view.yuv_layout = *layout;
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::allocateRawTexture(View& view, const ImageFrame::Header& header,
+                                       const BayerFormat& bayer) {
+  glDeleteTextures(1, &view.raw_texture);
+  const auto plane = rawPlaneTexture(bayer, header.size.width);
+  view.raw_texture = createTexture(plane.internal_format, plane.width,
+                                   static_cast<GLsizei>(header.size.height), GL_NEAREST);
+  view.raw_storage_header = header;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Display::Impl::uploadRaw(View& view, const ImageFrame& frame) -> bool {
+  const auto bayer = bayerFormat(frame.header.format, frame.header.format_modifier);
+  if ((raw_program == 0) || not bayer || (frame.plane_count == 0)) {
+    return false;
+  }
+
+  const auto height = static_cast<GLsizei>(frame.header.size.height);
+  if ((frame.header.size.width < 2) || (height < 2)) {
+    return false;
+  }
+
+  // Rows are addressed with GL_UNPACK_ROW_LENGTH, so pitch must be a whole number of texels
+  const auto plane = rawPlaneTexture(*bayer, frame.header.size.width);
+  const auto& source = frame.planes[0];
+  auto upload = TextureUpload{ .texture = 0,
+                               .format = plane.format,
+                               .width = plane.width,
+                               .height = height,
+                               .pitch = source.stride,
+                               .texel_bytes = plane.texel_bytes };
+  const auto row_bytes = static_cast<std::size_t>(upload.width) * upload.texel_bytes;
+  const auto required_bytes =
+      (upload.pitch * static_cast<std::size_t>(upload.height - 1)) + row_bytes;
+  if (((upload.pitch % upload.texel_bytes) != 0) || (source.data.size() < required_bytes)) {
+    return false;
+  }
+
+  if ((view.raw_texture == 0) || not matchesFormat(frame.header, view.raw_storage_header)) {
+    allocateRawTexture(view, frame.header, *bayer);
+  }
+
+  upload.texture = view.raw_texture;
+  const auto src = source.data;
+  streamUpload(upload, [src](std::span<std::byte> dst) {
+    std::memcpy(dst.data(), src.data(), dst.size());
+  });
+
+  view.raw_format = *bayer;
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::upload(View& view, const ImageFrame& frame) {
+  view.external_texture_id = 0;
+  // The external sampler converts YUV but cannot demosaic, so raw frames are always uploaded
+  const auto is_raw = bayerFormat(frame.header.format, frame.header.format_modifier).has_value();
+  if (importer && not is_raw) {
+    view.external_texture_id = importer->texture(frame);
+  }
+
+  if (view.external_texture_id != 0) {
+    view.source = Source::External;
+  } else if (uploadYuvPlanes(view, frame)) {
+    view.source = Source::Yuv;
+  } else if (uploadRaw(view, frame)) {
+    view.source = Source::Raw;
   } else {
-    quad_height = window_aspect / image_aspect_ratio;
+    uploadRgb(view, frame);
+    view.source = Source::Rgb;
   }
+  view.frame_header = frame.header;
+}
 
-  const std::array<float, 16> quad_vertices = {
-    // positions                    // texCoords
-    -quad_width, quad_height,  0.0F, 0.0F,  // top-left
-    -quad_width, -quad_height, 0.0F, 1.0F,  // bottom-left
-    quad_width,  -quad_height, 1.0F, 1.0F,  // bottom-right
-    quad_width,  quad_height,  1.0F, 0.0F   // top-right
-  };
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::allocateTextures(View& view, const ImageFrame::Header& header) const {
+  const auto layout = yuvLayout(header.format);
+  const auto bayer = bayerFormat(header.format, header.format_modifier);
+  if ((raw_program != 0) && bayer) {
+    if ((view.raw_texture == 0) || not matchesFormat(header, view.raw_storage_header)) {
+      allocateRawTexture(view, header, *bayer);
+    }
+  } else if ((yuv_program != 0) && layout) {
+    if ((view.yuv_textures[0] == 0) || not matchesFormat(header, view.yuv_storage_header)) {
+      allocateYuvTextures(view, header, *layout);
+    }
+  } else if ((view.texture_id == 0) || not matchesFormat(header, view.rgb_storage_header)) {
+    allocateRgbTexture(view, header);
+  }
+}
 
-  // Update VBO with new vertices
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quad_vertices), quad_vertices.data());
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::resizeViews(std::size_t count) {
+  for (auto i = count; i < views.size(); ++i) {
+    releaseView(views[i]);
+  }
+  views.resize(count);
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::releaseView(View& view) {
+  glDeleteTextures(1, &view.texture_id);
+  glDeleteTextures(static_cast<GLsizei>(view.yuv_textures.size()), view.yuv_textures.data());
+  glDeleteTextures(1, &view.raw_texture);
+  view = {};
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Display::Impl::isImported() const -> bool {
+  const auto is_external = [](const View& view) { return view.source == Source::External; };
+  return std::ranges::any_of(views, is_external);
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::Impl::draw(const View& view) const {
+  switch (view.source) {
+    case Source::Rgb:
+      glUseProgram(shader_program);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, view.texture_id);
+      break;
+    case Source::Yuv: {
+      const auto transform = yuvToRgbTransform(view.frame_header.color_space);
+      glUseProgram(yuv_program);
+      glUniform1i(yuv_layout_location, static_cast<GLint>(view.yuv_layout));
+      glUniformMatrix3fv(yuv_matrix_location, 1, GL_TRUE, transform.matrix.data());
+      glUniform3fv(yuv_offset_location, 1, transform.offset.data());
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_2D, view.yuv_textures[2]);
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, view.yuv_textures[1]);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, view.yuv_textures[0]);
+      break;
+    }
+    case Source::Raw: {
+      glUseProgram(raw_program);
+      glUniform1i(raw_packing_location, static_cast<GLint>(view.raw_format.packing));
+      glUniform1i(raw_depth_location, view.raw_format.bit_depth);
+      glUniform2i(raw_size_location, view.frame_header.size.width,
+                  view.frame_header.size.height);
+      glUniform2i(raw_offset_location, static_cast<GLint>(view.raw_format.redColumn()),
+                  static_cast<GLint>(view.raw_format.redRow()));
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, view.raw_texture);
+      break;
+    }
+    case Source::External:
+      glUseProgram(external_program);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(TEXTURE_EXTERNAL_OES, view.external_texture_id);
+      break;
+  }
+
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 }
 
 //-------------------------------------------------------------------------------------------------
-void Display::Impl::render() const {
+void Display::Impl::render() {
   int window_width = 0;
   int window_height = 0;
   glfwGetFramebufferSize(window, &window_width, &window_height);
@@ -329,25 +1045,80 @@ void Display::Impl::render() const {
   glClearColor(0.0F, 0.0F, 0.0F, 1.0F);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  updateQuadForLetterbox();
-
-  glUseProgram(shader_program);
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
+  // Views fill a near-square grid of equal tiles, in row order from the top left. Each view is
+  // letterboxed within its tile by the viewport, so all views draw the same quad
+  const auto count = static_cast<int>(views.size());
+  const auto columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(count))));
+  const auto rows = std::max(1, (count + columns - 1) / columns);
+  const auto tile_width = window_width / columns;
+  const auto tile_height = window_height / rows;
 
+  auto is_external = false;
   glBindVertexArray(vao);
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  for (int i = 0; i < count; ++i) {
+    const auto& view = views.at(static_cast<std::size_t>(i));
+    const auto& size = view.frame_header.size;
+    if ((tile_width == 0) || (tile_height == 0) || (size.width == 0) || (size.height == 0)) {
+      continue;  // Window minimized, or no frame yet
+    }
+    const auto image_aspect = static_cast<float>(size.width) / static_cast<float>(size.height);
+    auto width = tile_width;
+    auto height = tile_height;
+    if (static_cast<float>(tile_width) > image_aspect * static_cast<float>(tile_height)) {
+      width = static_cast<int>(image_aspect * static_cast<float>(tile_height));
+    } else {
+      height = static_cast<int>(static_cast<float>(tile_width) / image_aspect);
+    }
+    // Window coordinates start at the bottom left
+    const auto x = ((i % columns) * tile_width) + ((tile_width - width) / 2);
+    const auto row = i / columns;
+    const auto y = window_height - ((row + 1) * tile_height) + ((tile_height - height) / 2);
+    glViewport(x, y, width, height);
+    draw(view);
+    is_external = is_external || (view.source == Source::External);
+  }
   glBindVertexArray(0);
 
-  glfwSwapBuffers(window);
+  // The GPU samples imported textures directly from the camera buffers. Wait until it is done
+  // before returning, since the buffer is requeued to the camera once the frame callback exits.
+  // NOLINTNEXTLINE(misc-const-correctness)
+  GLsync fence = is_external ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : nullptr;
+  if (fence != nullptr) {
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    glDeleteSync(fence);
+  }
 }
 
 //-------------------------------------------------------------------------------------------------
 void Display::Impl::cleanup() {
-  if (texture_id != 0) {
-    glDeleteTextures(1, &texture_id);
-    texture_id = 0;
+  importer.reset();
+  if (get_query_result != nullptr) {
+    glDeleteQueries(static_cast<GLsizei>(gpu_queries.size()), gpu_queries.data());
+    get_query_result = nullptr;
+  }
+  if (external_program != 0) {
+    glDeleteProgram(external_program);
+    external_program = 0;
+  }
+  if (yuv_program != 0) {
+    glDeleteProgram(yuv_program);
+    yuv_program = 0;
+  }
+  for (auto& view : views) {
+    releaseView(view);
+  }
+  if (raw_program != 0) {
+    glDeleteProgram(raw_program);
+    raw_program = 0;
+  }
+  for (auto& buffer : upload_buffers) {
+    if (buffer.fence != nullptr) {
+      glDeleteSync(buffer.fence);
+    }
+    if (buffer.pbo != 0) {
+      glDeleteBuffers(1, &buffer.pbo);
+    }
+    buffer = {};
   }
   if (vao != 0) {
     glDeleteVertexArrays(1, &vao);
@@ -369,7 +1140,12 @@ void Display::Impl::cleanup() {
 }
 
 //-------------------------------------------------------------------------------------------------
-Display::Display() : impl_(std::make_unique<Impl>()) {
+Display::Display() : Display(Config{}) {
+}
+
+//-------------------------------------------------------------------------------------------------
+Display::Display(const Config& config) : impl_(std::make_unique<Impl>()) {
+  impl_->config = config;
   impl_->initWindow();
   impl_->initGL();
 }
@@ -381,17 +1157,91 @@ Display::~Display() {
 
 //-------------------------------------------------------------------------------------------------
 void Display::update(const ImageFrame& frame) {
-  convertToRGB(frame, impl_->rgb_buffer);
-  impl_->uploadTexture(impl_->rgb_buffer.data(), frame.header.size);
+  update(std::span(&frame, 1));
+}
+
+//-------------------------------------------------------------------------------------------------
+void Display::update(std::span<const ImageFrame> frames) {
+  impl_->collectGpuTimes();
+  impl_->beginGpuTimer();
+
+  const auto upload_start = std::chrono::steady_clock::now();
+  impl_->resizeViews(frames.size());
+
+  // Imported textures are dropped when the format of a feed changes. Check every feed first, so
+  // that textures imported for the other views stay valid
+  if (impl_->importer) {
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+      if (not matchesFormat(frames[i].header, impl_->views[i].frame_header)) {
+        impl_->importer->clear();
+        break;
+      }
+    }
+  }
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    impl_->upload(impl_->views[i], frames[i]);
+  }
+  impl_->upload_time.record(std::chrono::steady_clock::now() - upload_start);
+
+  // Imported buffers return to the camera when the frame callback exits, so draw from them now.
+  // Anything else is drawn once by present(), however many updates came before it
+  impl_->is_drawn = impl_->isImported();
+  if (impl_->is_drawn) {
+    const auto render_timer = ScopedTimer(impl_->render_time);
+    impl_->render();
+  }
+  impl_->has_new_frames = true;
+  impl_->frame_count.fetch_add(1, std::memory_order_relaxed);
+}
 
-  if (frame.header.size.width > 0 && frame.header.size.height > 0) {
-    impl_->image_aspect_ratio =
-        static_cast<float>(frame.header.size.width) / static_cast<float>(frame.header.size.height);
+//-------------------------------------------------------------------------------------------------
+auto Display::present() -> bool {
+  // Redraw the current frames for a resized or exposed window. Imported buffers are back with the
+  // camera by now, so feeds shown from them wait for their next frame instead
+  if (impl_->is_redraw_needed && not impl_->isImported()) {
+    impl_->has_new_frames = true;
+    impl_->is_drawn = false;
+  }
+  impl_->is_redraw_needed = false;
+  if (not impl_->has_new_frames) {
+    return false;  // The previous image stays on screen
+  }
+  if (not impl_->is_drawn) {
+    const auto render_timer = ScopedTimer(impl_->render_time);
+    impl_->render();
   }
+  impl_->endGpuTimer();
+  {
+    const auto swap_timer = ScopedTimer(impl_->swap_time);
+    glfwSwapBuffers(impl_->window);
+  }
+  impl_->has_new_frames = false;
+  impl_->is_drawn = false;
+  impl_->presented_count.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
 
-  impl_->current_frame_header = frame.header;
+//-------------------------------------------------------------------------------------------------
+void Display::reconfigure(const ImageFrame::Header& header, std::size_t view) {
+  // Capture buffers may have been replaced, possibly under the same descriptor numbers
+  if (impl_->importer) {
+    impl_->importer->clear();
+  }
+  if (view >= impl_->views.size()) {
+    impl_->resizeViews(view + 1);
+  }
+  impl_->allocateTextures(impl_->views[view], header);
+}
 
-  impl_->render();
+//-------------------------------------------------------------------------------------------------
+auto Display::stats() const -> Stats {
+  return { .frames = impl_->frame_count.load(std::memory_order_relaxed),
+           .presented = impl_->presented_count.load(std::memory_order_relaxed),
+           .convert = impl_->convert_time.snapshot(),
+           .upload = impl_->upload_time.snapshot(),
+           .render = impl_->render_time.snapshot(),
+           .swap = impl_->swap_time.snapshot(),
+           .gpu = impl_->gpu_time.snapshot() };
 }
 
 //-------------------------------------------------------------------------------------------------
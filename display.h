@@ -4,22 +4,91 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 
 #include "image_frame.h"
+#include "stats.h"
 
 namespace picam {
 
 //=================================================================================================
-/// OpenGL display window using GLFW for rendering camera frames
+/// OpenGL display window using GLFW for rendering camera frames. Several feeds, e.g. of a
+/// CameraGroup, are tiled in one window and rendered in one pass
 class Display {
 public:
+  /// How present() synchronises buffer swaps with the display refresh
+  enum class PresentMode : std::uint8_t {
+    Vsync,      //!< Swap at vertical blank. No tearing; present() blocks until the next refresh
+    LowLatency  //!< Swap without waiting. Adaptive vsync (a late swap tears instead of waiting a
+                //!< whole refresh) where the GLX, WGL or EGL context has EXT_swap_control_tear.
+                //!< Otherwise, as with most EGL drivers, swaps are unsynchronised: they tear on
+                //!< X11, while Wayland compositors show the latest frame at their next refresh
+  };
+
+  struct Config {
+    /// Import camera dmabufs directly as GL textures instead of converting and uploading pixels
+    /// through the CPU. Falls back to CPU upload if the platform does not support it
+    bool import_dmabuf{ false };
+
+    /// Upload YUYV, NV12 and YUV420 frames as-is and convert them to RGB in the fragment shader,
+    /// using the colour space reported by the camera. If false, frames are converted on the CPU
+    bool gpu_yuv_conversion{ true };
+
+    /// Upload raw Bayer frames as-is, and unpack and demosaic them in the fragment shader at full
+    /// sample precision. If false, frames are demosaiced on the CPU from 8 bits per sample
+    bool gpu_debayer{ true };
+
+    /// Buffer swap behaviour of present()
+    PresentMode present_mode{ PresentMode::Vsync };
+  };
+
+  /// Rendering instrumentation. Always on; durations are recorded with relaxed atomics
+  struct Stats {
+    std::uint64_t frames{};     //!< Updates, of any number of feeds
+    std::uint64_t presented{};  //!< Buffer swaps. Fewer than updates if updates outpace present()
+    DurationStats convert;      //!< CPU pixel conversion (frames not uploaded as-is)
+    DurationStats upload;       //!< Texture update of all feeds, including conversion and import
+    DurationStats render;       //!< Draw of all feeds
+    DurationStats swap;         //!< Buffer swap, including the wait for vertical blank
+    DurationStats gpu;          //!< GPU time of upload and draw (needs GL_EXT_disjoint_timer_query)
+  };
+
+  /// Create a display with default configuration
   Display();
 
-  /// Update the display with a new camera frame
+  /// Create a display
+  /// @param config Display configuration
+  explicit Display(const Config& config);
+
+  /// Update the display with a new camera frame. The frame is shown by the next present()
   /// @param frame Camera image frame to display
   void update(const ImageFrame& frame);
 
+  /// Update the display with one frame of each feed, tiled in a grid in row order. Feeds keep
+  /// their textures between updates, so pass them in the same order each time
+  /// @param frames Frames to display, one per feed
+  void update(std::span<const ImageFrame> frames);
+
+  /// Show the newest frames, if any arrived since the last call. Draws them (unless already drawn
+  /// from imported dmabufs, which must happen before update() returns) and swaps buffers. Call it
+  /// once per iteration of the render loop, independently of frame arrival: the loop paces itself
+  /// to the display refresh with PresentMode::Vsync, and frames updated in between are skipped
+  /// @return true if buffers were swapped, false if there was nothing new to show
+  auto present() -> bool;
+
+  /// Prepare for frames of a reconfigured camera (see Camera::reconfigure). Releases imported
+  /// dmabufs, since the camera may have replaced its buffers. Texture storage is reallocated only
+  /// if the format or size changed, and then ahead of the first frame
+  /// @param header Header of the frames that will follow, e.g. from Camera::streamFormat()
+  /// @param view Index of the feed in update()
+  void reconfigure(const ImageFrame::Header& header, std::size_t view = 0);
+
+  /// @return Snapshot of rendering statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
   /// Process window events (must be called periodically)
   /// @return false if window should close, true otherwise
   auto processEvents() -> bool;
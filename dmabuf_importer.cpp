@@ -0,0 +1,190 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "dmabuf_importer.h"
+#include "egl_context.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <print>
+#include <string_view>
+#include <vector>
+
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+namespace {
+
+/// From OES_EGL_image_external (not part of the desktop GL headers)
+constexpr GLenum TEXTURE_EXTERNAL_OES = 0x8D65;
+using GlEglImageTargetTexture2DOes = void (*)(GLenum target, void* image);
+
+//-------------------------------------------------------------------------------------------------
+auto colorSpaceHint(picam::ColorSpace::Encoding encoding) -> EGLint {
+  switch (encoding) {
+    case picam::ColorSpace::Encoding::Rec709:
+      return EGL_ITU_REC709_EXT;
+    case picam::ColorSpace::Encoding::Rec2020:
+      return EGL_ITU_REC2020_EXT;
+    default:
+      return EGL_ITU_REC601_EXT;
+  }
+}
+
+}  // namespace
+
+namespace picam {
+
+//-------------------------------------------------------------------------------------------------
+struct DmaBufImporter::Impl {
+  struct Image {
+    int fd{ -1 };
+    std::uint32_t offset{};
+    EGLImageKHR image{ EGL_NO_IMAGE_KHR };
+    GLuint texture{ 0 };
+  };
+
+  EGLDisplay display{ EGL_NO_DISPLAY };
+  PFNEGLCREATEIMAGEKHRPROC create_image{ nullptr };
+  PFNEGLDESTROYIMAGEKHRPROC destroy_image{ nullptr };
+  GlEglImageTargetTexture2DOes image_target_texture{ nullptr };
+  std::vector<Image> images;  // Few buffers in flight, so a linear search beats hashing
+
+  [[nodiscard]] auto supported() const -> bool;
+  auto import(const ImageFrame& frame) -> GLuint;
+};
+
+//-------------------------------------------------------------------------------------------------
+auto DmaBufImporter::Impl::supported() const -> bool {
+  return (create_image != nullptr) && (destroy_image != nullptr) &&
+         (image_target_texture != nullptr);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto DmaBufImporter::Impl::import(const ImageFrame& frame) -> GLuint {
+  // clang-format off
+  static constexpr auto PLANE_ATTRIBS = std::array<std::array<EGLint, 3>, ImageFrame::MAX_PLANES>{ {
+    { EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGL_DMA_BUF_PLANE0_PITCH_EXT },
+    { EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT, EGL_DMA_BUF_PLANE1_PITCH_EXT },
+    { EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT, EGL_DMA_BUF_PLANE2_PITCH_EXT }
+  } };
+  // clang-format on
+  static constexpr auto MAX_ATTRIBS = 6 + (6 * ImageFrame::MAX_PLANES) + 4 + 1;
+
+  auto attribs = std::array<EGLint, MAX_ATTRIBS>{};
+  auto count = std::size_t{ 0 };
+  const auto append = [&attribs, &count](EGLint name, EGLint value) {
+    attribs.at(count++) = name;
+    attribs.at(count++) = value;
+  };
+  append(EGL_WIDTH, static_cast<EGLint>(frame.header.size.width));
+  append(EGL_HEIGHT, static_cast<EGLint>(frame.header.size.height));
+  append(EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(frame.header.format));
+  // Planes may share a single dmabuf at different offsets
+  const auto plane_count = std::min<std::size_t>(frame.plane_count, ImageFrame::MAX_PLANES);
+  for (std::size_t i = 0; i < plane_count; ++i) {
+    const auto& plane = frame.planes.at(i);
+    const auto& names = PLANE_ATTRIBS.at(i);
+    append(names[0], plane.fd);
+    append(names[1], static_cast<EGLint>(plane.offset));
+    append(names[2], static_cast<EGLint>(plane.stride));
+  }
+  // Colour space hints are ignored for RGB formats
+  const auto is_full_range = (frame.header.color_space.range == ColorSpace::Range::Full);
+  append(EGL_YUV_COLOR_SPACE_HINT_EXT, colorSpaceHint(frame.header.color_space.encoding));
+  append(EGL_SAMPLE_RANGE_HINT_EXT,
+         is_full_range ? EGL_YUV_FULL_RANGE_EXT : EGL_YUV_NARROW_RANGE_EXT);
+  attribs.at(count) = EGL_NONE;
+
+  // NOLINTNEXTLINE(misc-const-correctness)
+  EGLImageKHR image =
+      create_image(display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs.data());
+  if (image == EGL_NO_IMAGE_KHR) {
+    std::println(stderr, "Failed to import dmabuf (fd {}) as EGL image: 0x{:x}",
+                 frame.planes[0].fd, eglGetError());
+    return 0;
+  }
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(TEXTURE_EXTERNAL_OES, texture);
+  glTexParameteri(TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  image_target_texture(TEXTURE_EXTERNAL_OES, image);
+  glBindTexture(TEXTURE_EXTERNAL_OES, 0);
+
+  images.push_back({ .fd = frame.planes[0].fd,
+                     .offset = frame.planes[0].offset,
+                     .image = image,
+                     .texture = texture });
+  return texture;
+}
+
+//-------------------------------------------------------------------------------------------------
+DmaBufImporter::DmaBufImporter(void* egl_display) : impl_(std::make_unique<Impl>()) {
+  impl_->display = static_cast<EGLDisplay>(egl_display);
+  if (impl_->display == EGL_NO_DISPLAY) {
+    return;
+  }
+
+  const auto* egl_extensions = eglQueryString(impl_->display, EGL_EXTENSIONS);
+  const auto* gl_extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (not hasExtension(egl_extensions, "EGL_EXT_image_dma_buf_import") ||
+      not hasExtension(gl_extensions, "GL_OES_EGL_image_external")) {
+    return;
+  }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+  impl_->create_image =
+      reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(eglGetProcAddress("eglCreateImageKHR"));
+  impl_->destroy_image =
+      reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(eglGetProcAddress("eglDestroyImageKHR"));
+  impl_->image_target_texture = reinterpret_cast<GlEglImageTargetTexture2DOes>(
+      eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+  // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+//-------------------------------------------------------------------------------------------------
+DmaBufImporter::~DmaBufImporter() {
+  clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto DmaBufImporter::isSupported() const -> bool {
+  return impl_->supported();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto DmaBufImporter::texture(const ImageFrame& frame) -> unsigned int {
+  // The first plane identifies the buffer
+  const auto& plane = frame.planes[0];
+  if ((not impl_->supported()) || (frame.plane_count == 0) || (plane.fd < 0)) {
+    return 0;
+  }
+  for (const auto& image : impl_->images) {
+    if ((image.fd == plane.fd) && (image.offset == plane.offset)) {
+      return image.texture;
+    }
+  }
+  return impl_->import(frame);
+}
+
+//-------------------------------------------------------------------------------------------------
+void DmaBufImporter::clear() {
+  for (auto& image : impl_->images) {
+    glDeleteTextures(1, &image.texture);
+    impl_->destroy_image(impl_->display, image.image);
+  }
+  impl_->images.clear();
+}
+
+}  // namespace picam
@@ -0,0 +1,47 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <memory>
+
+#include "image_frame.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Imports camera dmabufs as GL_TEXTURE_EXTERNAL_OES textures via EGL_EXT_image_dma_buf_import,
+/// so frames can be sampled by the GPU without the CPU touching any pixels. Colour conversion of
+/// YUV formats is done by the GPU's texture sampler.
+///
+/// Must be created and used on the thread that has the GL context current.
+class DmaBufImporter {
+public:
+  /// @param egl_display EGLDisplay on which the current GL context was created
+  explicit DmaBufImporter(void* egl_display);
+
+  /// @return true if the EGL display and current GL context support dmabuf import
+  [[nodiscard]] auto isSupported() const -> bool;
+
+  /// Get an external texture aliasing the frame's dmabuf. Images are created on first use of a
+  /// buffer and cached, so steady-state cost is a lookup.
+  /// @param frame Frame with a valid dmabuf descriptor
+  /// @return GL texture name, or 0 if the frame could not be imported
+  auto texture(const ImageFrame& frame) -> unsigned int;
+
+  /// Release all imported images and their textures. Call when frame format changes
+  void clear();
+
+  ~DmaBufImporter();
+  DmaBufImporter(const DmaBufImporter&) = delete;
+  DmaBufImporter(DmaBufImporter&&) = delete;
+  auto operator=(const DmaBufImporter&) = delete;
+  auto operator=(DmaBufImporter&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
@@ -0,0 +1,134 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "egl_context.h"
+
+#include <array>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace {
+
+//-------------------------------------------------------------------------------------------------
+[[noreturn]] void throwEglError(std::string_view what) {
+  throw std::runtime_error(std::format("{} (EGL error 0x{:x})", what, eglGetError()));
+}
+
+}  // namespace
+
+namespace picam {
+
+//-------------------------------------------------------------------------------------------------
+auto hasExtension(const char* extensions, std::string_view name) -> bool {
+  if (extensions == nullptr) {
+    return false;
+  }
+  const auto list = std::string_view(extensions);
+  auto pos = list.find(name);
+  while (pos != std::string_view::npos) {
+    const auto end = pos + name.size();
+    const auto starts_word = (pos == 0) || (list[pos - 1] == ' ');
+    const auto ends_word = (end == list.size()) || (list[end] == ' ');
+    if (starts_word && ends_word) {
+      return true;
+    }
+    pos = list.find(name, end);
+  }
+  return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+struct EglContext::Impl {
+  EGLDisplay display{ EGL_NO_DISPLAY };
+  EGLContext context{ EGL_NO_CONTEXT };
+
+  void create();
+
+  // Also releases a partially created context, when the constructor throws
+  ~Impl();
+  Impl() = default;
+  Impl(const Impl&) = delete;
+  Impl(Impl&&) = delete;
+  auto operator=(const Impl&) = delete;
+  auto operator=(Impl&&) = delete;
+};
+
+//-------------------------------------------------------------------------------------------------
+void EglContext::Impl::create() {
+  // Client extensions are queried without a display
+  if (not hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS),
+                       "EGL_MESA_platform_surfaceless")) {
+    throw std::runtime_error("EGL surfaceless platform is not supported");
+  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display == nullptr) {
+    throw std::runtime_error("eglGetPlatformDisplayEXT is not available");
+  }
+  display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  if ((display == EGL_NO_DISPLAY) || (eglInitialize(display, nullptr, nullptr) == EGL_FALSE)) {
+    display = EGL_NO_DISPLAY;
+    throwEglError("Failed to initialize surfaceless EGL display");
+  }
+  if (not hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+    throw std::runtime_error("EGL display does not support surfaceless contexts");
+  }
+  if (eglBindAPI(EGL_OPENGL_ES_API) == EGL_FALSE) {
+    throwEglError("Failed to bind the OpenGL ES API");
+  }
+
+  // Nothing is drawn to EGL surfaces, but surfaceless platforms only offer pbuffer configs
+  static constexpr auto CONFIG_ATTRIBS = std::array<EGLint, 5>{
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_NONE
+  };
+  auto config = EGLConfig{};
+  auto config_count = EGLint{ 0 };
+  if ((eglChooseConfig(display, CONFIG_ATTRIBS.data(), &config, 1, &config_count) == EGL_FALSE) ||
+      (config_count == 0)) {
+    throwEglError("No EGL config for OpenGL ES 3.0");
+  }
+
+  static constexpr auto CONTEXT_ATTRIBS = std::array<EGLint, 3>{ EGL_CONTEXT_CLIENT_VERSION, 3,
+                                                                 EGL_NONE };
+  context = eglCreateContext(display, config, EGL_NO_CONTEXT, CONTEXT_ATTRIBS.data());
+  if (context == EGL_NO_CONTEXT) {
+    throwEglError("Failed to create OpenGL ES 3.0 context");
+  }
+  if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE) {
+    throwEglError("Failed to make the offscreen context current");
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+EglContext::Impl::~Impl() {
+  if (display == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context != EGL_NO_CONTEXT) {
+    eglDestroyContext(display, context);
+  }
+  eglTerminate(display);
+}
+
+//-------------------------------------------------------------------------------------------------
+EglContext::EglContext() : impl_(std::make_unique<Impl>()) {
+  impl_->create();
+}
+
+//-------------------------------------------------------------------------------------------------
+EglContext::~EglContext() = default;
+
+//-------------------------------------------------------------------------------------------------
+auto EglContext::eglDisplay() const -> void* {
+  return impl_->display;
+}
+
+}  // namespace picam
@@ -0,0 +1,43 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+namespace picam {
+
+/// @return true if a space-separated extension string, as from eglQueryString() or
+/// glGetString(), lists the extension. False for a null string
+[[nodiscard]] auto hasExtension(const char* extensions, std::string_view name) -> bool;
+
+//=================================================================================================
+/// Offscreen OpenGL ES 3.0 context for GPU processing of frames on nodes without a display. Uses
+/// the surfaceless EGL platform (EGL_MESA_platform_surfaceless), which needs neither a window
+/// system nor a GBM device; render into framebuffer objects. Camera dmabufs can be imported with
+/// DmaBufImporter on eglDisplay().
+///
+/// The context is made current on the creating thread, and must only be used there
+class EglContext {
+public:
+  /// Create the context and make it current. Throws std::runtime_error if the platform does not
+  /// support surfaceless GLES 3.0 contexts
+  EglContext();
+
+  /// @return EGLDisplay the context was created on, e.g. for DmaBufImporter
+  [[nodiscard]] auto eglDisplay() const -> void*;
+
+  ~EglContext();
+  EglContext(const EglContext&) = delete;
+  EglContext(EglContext&&) = delete;
+  auto operator=(const EglContext&) = delete;
+  auto operator=(EglContext&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
@@ -0,0 +1,346 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "frame_analysis.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <libcamera/formats.h>
+
+#include "worker_pool.h"
+
+// NOLINTBEGIN(*-pointer-arithmetic,*-reinterpret-cast,*-magic-numbers)
+
+namespace {
+
+/// Where the luma of a pixel comes from
+enum class LumaLayout : std::uint8_t {
+  Planar,  //!< Luma plane of NV12 and YUV420
+  Yuyv,    //!< Even bytes of packed YUYV
+  Rgb      //!< Weighted sum of the colours of RGB888
+};
+
+using LumaTable = std::array<std::uint8_t, 256>;
+
+/// Expands limited range luma ([16, 235]) to full range
+constexpr auto LIMITED_TO_FULL = [] {
+  auto table = LumaTable{};
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    const auto value = ((static_cast<int>(i) - 16) * 255 + 109) / 219;
+    table.at(i) = static_cast<std::uint8_t>(std::clamp(value, 0, 255));
+  }
+  return table;
+}();
+
+constexpr auto IDENTITY = [] {
+  auto table = LumaTable{};
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    table.at(i) = static_cast<std::uint8_t>(i);
+  }
+  return table;
+}();
+
+/// Luma of one frame, as selected from its format
+struct LumaSource {
+  LumaLayout layout{ LumaLayout::Planar };
+  const std::uint8_t* data{ nullptr };
+  std::size_t pitch{};
+  std::uint32_t width{};
+  std::uint32_t height{};
+  const LumaTable* to_full_range{ &IDENTITY };
+};
+
+//-------------------------------------------------------------------------------------------------
+// @return Layout of the luma of a pixel format, or nothing if it has none
+auto lumaLayout(std::uint32_t format) -> std::optional<LumaLayout> {
+  namespace formats = libcamera::formats;
+  if ((format == formats::NV12) || (format == formats::YUV420)) {
+    return LumaLayout::Planar;
+  }
+  if (format == formats::YUYV) {
+    return LumaLayout::Yuyv;
+  }
+  if (format == formats::RGB888) {
+    return LumaLayout::Rgb;
+  }
+  return std::nullopt;
+}
+
+//-------------------------------------------------------------------------------------------------
+template <LumaLayout L>
+inline auto lumaAt(const std::uint8_t* row, std::uint32_t x) -> std::uint8_t {
+  if constexpr (L == LumaLayout::Planar) {
+    return row[x];
+  } else if constexpr (L == LumaLayout::Yuyv) {
+    return row[static_cast<std::size_t>(x) * 2];
+  } else {
+    // ITU-R BT.601 luma weights, summing to 256
+    const auto* px = &row[static_cast<std::size_t>(x) * 3];
+    return static_cast<std::uint8_t>(((77 * px[0]) + (150 * px[1]) + (29 * px[2]) + 128) >> 8);
+  }
+}
+
+/// Sums over the samples of some rows
+struct Accumulator {
+  std::array<std::uint32_t, picam::FrameStatistics::HISTOGRAM_BINS> histogram{};
+  std::uint64_t luma_sum{};
+  std::uint64_t focus_sum{};
+  std::uint64_t changed{};
+};
+
+/// Sampling grid and motion reference of one frame, shared by the threads analysing its rows
+struct Grid {
+  std::uint32_t subsampling{};
+  std::uint32_t columns{};
+  std::uint8_t motion_threshold{};
+  const std::uint8_t* reference{ nullptr };  // Samples of the previous frame
+  std::uint8_t* samples{ nullptr };          // Samples of this frame
+};
+
+//-------------------------------------------------------------------------------------------------
+// Analyse the sample rows in image rows [first, last). Focus is the squared gradient towards the
+// right and lower neighbours of each sample, so rows outside the range are read but not sampled
+template <LumaLayout L>
+auto analyzeRows(const LumaSource& source, const Grid& grid, std::uint32_t first,
+                 std::uint32_t last) -> Accumulator {
+  static constexpr auto BIN_SHIFT = 3U;  // 256 levels in 32 bins
+  const auto& to_full = *source.to_full_range;
+  const auto step = grid.subsampling;
+  const auto last_column = source.width - 1;
+  const auto last_row = source.height - 1;
+
+  auto sums = Accumulator{};
+  for (auto y = (first + step - 1) / step * step; y < last; y += step) {
+    const auto* row = &source.data[static_cast<std::size_t>(y) * source.pitch];
+    const auto* below = &source.data[static_cast<std::size_t>(std::min(y + 1, last_row)) *
+                                     source.pitch];
+    const auto offset = static_cast<std::size_t>(y / step) * grid.columns;
+    const auto* reference = &grid.reference[offset];
+    auto* samples = &grid.samples[offset];
+    for (std::uint32_t column = 0; column < grid.columns; ++column) {
+      const auto x = column * step;
+      const int luma = to_full[lumaAt<L>(row, x)];
+      const int dx = to_full[lumaAt<L>(row, std::min(x + 1, last_column))] - luma;
+      const int dy = to_full[lumaAt<L>(below, x)] - luma;
+      ++sums.histogram.at(static_cast<std::size_t>(luma) >> BIN_SHIFT);
+      sums.luma_sum += static_cast<std::uint64_t>(luma);
+      sums.focus_sum += static_cast<std::uint64_t>((dx * dx) + (dy * dy));
+      sums.changed += (std::abs(luma - reference[column]) > grid.motion_threshold) ? 1U : 0U;
+      samples[column] = static_cast<std::uint8_t>(luma);
+    }
+  }
+  return sums;
+}
+
+using RowsAnalyzer = Accumulator (*)(const LumaSource& source, const Grid& grid,
+                                     std::uint32_t first, std::uint32_t last);
+
+//-------------------------------------------------------------------------------------------------
+auto rowsAnalyzer(LumaLayout layout) -> RowsAnalyzer {
+  switch (layout) {
+    case LumaLayout::Planar:
+      return analyzeRows<LumaLayout::Planar>;
+    case LumaLayout::Yuyv:
+      return analyzeRows<LumaLayout::Yuyv>;
+    case LumaLayout::Rgb:
+      return analyzeRows<LumaLayout::Rgb>;
+  }
+  return analyzeRows<LumaLayout::Planar>;
+}
+
+}  // namespace
+
+namespace picam {
+
+//-------------------------------------------------------------------------------------------------
+struct FrameAnalyzer::Impl {
+  Config config;
+
+  // Samples of the previous and the current frame, in grid order
+  std::vector<std::uint8_t> reference;
+  std::vector<std::uint8_t> samples;
+  ImageSize reference_size{};
+  bool has_reference{ false };
+  std::uint64_t frame_count{ 0 };
+
+  // State of the frame being analysed. Sums are merged from the threads analysing its rows
+  LumaSource source;
+  Grid grid;
+  RowsAnalyzer analyze_rows{ nullptr };
+  std::array<std::atomic_uint32_t, FrameStatistics::HISTOGRAM_BINS> histogram{};
+  std::atomic_uint64_t luma_sum{ 0 };
+  std::atomic_uint64_t focus_sum{ 0 };
+  std::atomic_uint64_t changed{ 0 };
+
+  void begin(const ImageFrame& frame);
+  void analyze(std::uint32_t first, std::uint32_t last);
+  auto finish() -> FrameStatistics;
+};
+
+//-------------------------------------------------------------------------------------------------
+// Select the luma of the frame and prepare the sampling grid. Throws before any row is analysed,
+// since rows are analysed on the worker pool
+void FrameAnalyzer::Impl::begin(const ImageFrame& frame) {
+  const auto& header = frame.header;
+  const auto layout = lumaLayout(header.format);
+  if (not layout) {
+    throw std::invalid_argument("Frame analysis needs YUV or RGB888 frames");
+  }
+  const auto width = static_cast<std::uint32_t>(header.size.width);
+  const auto height = static_cast<std::uint32_t>(header.size.height);
+  const auto pixel_bytes = (*layout == LumaLayout::Planar) ? 1U
+                           : (*layout == LumaLayout::Yuyv) ? 2U
+                                                           : 3U;
+  const auto& plane = frame.planes.at(0);
+  if ((frame.plane_count == 0) || (width == 0) || (height == 0) ||
+      (plane.data.size() <
+       (static_cast<std::size_t>(plane.stride) * (height - 1)) + (width * pixel_bytes))) {
+    throw std::invalid_argument("Source buffer too small for image dimensions");
+  }
+
+  const auto is_limited = (*layout != LumaLayout::Rgb) &&
+                          (header.color_space.range == ColorSpace::Range::Limited);
+  source = { .layout = *layout,
+             .data = reinterpret_cast<const std::uint8_t*>(plane.data.data()),
+             .pitch = plane.stride,
+             .width = width,
+             .height = height,
+             .to_full_range = is_limited ? &LIMITED_TO_FULL : &IDENTITY };
+  analyze_rows = rowsAnalyzer(*layout);
+
+  // A new size invalidates the motion reference
+  const auto step = config.subsampling;
+  const auto columns = (width + step - 1) / step;
+  const auto rows = (height + step - 1) / step;
+  if (header.size != reference_size) {
+    reference_size = header.size;
+    has_reference = false;
+    reference.assign(static_cast<std::size_t>(columns) * rows, 0);
+    samples.assign(reference.size(), 0);
+  }
+  grid = { .subsampling = step,
+           .columns = columns,
+           .motion_threshold = config.motion_threshold,
+           .reference = reference.data(),
+           .samples = samples.data() };
+
+  for (auto& bin : histogram) {
+    bin.store(0, std::memory_order_relaxed);
+  }
+  luma_sum.store(0, std::memory_order_relaxed);
+  focus_sum.store(0, std::memory_order_relaxed);
+  changed.store(0, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameAnalyzer::Impl::analyze(std::uint32_t first, std::uint32_t last) {
+  const auto sums = analyze_rows(source, grid, first, last);
+  for (std::size_t i = 0; i < sums.histogram.size(); ++i) {
+    if (sums.histogram.at(i) != 0) {
+      histogram.at(i).fetch_add(sums.histogram.at(i), std::memory_order_relaxed);
+    }
+  }
+  luma_sum.fetch_add(sums.luma_sum, std::memory_order_relaxed);
+  focus_sum.fetch_add(sums.focus_sum, std::memory_order_relaxed);
+  changed.fetch_add(sums.changed, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameAnalyzer::Impl::finish() -> FrameStatistics {
+  auto stats = FrameStatistics{};
+  for (std::size_t i = 0; i < histogram.size(); ++i) {
+    stats.histogram.at(i) = histogram.at(i).load(std::memory_order_relaxed);
+  }
+  stats.samples = static_cast<std::uint32_t>(samples.size());
+  const auto mean = [count = static_cast<double>(stats.samples)](const std::atomic_uint64_t& sum) {
+    return static_cast<float>(static_cast<double>(sum.load(std::memory_order_relaxed)) / count);
+  };
+  stats.mean_luma = mean(luma_sum);
+  stats.focus = mean(focus_sum);
+  stats.motion = has_reference ? mean(changed) : 0.0F;
+
+  const auto interval = config.keyframe_interval;
+  const auto is_keyframe = (interval > 0) && ((frame_count % interval) == 0);
+  const auto has_motion = not has_reference || (stats.motion >= config.motion_trigger);
+  stats.interesting = (has_motion || is_keyframe) && (stats.focus >= config.min_focus);
+
+  // This frame is the reference of the next
+  std::swap(reference, samples);
+  has_reference = true;
+  ++frame_count;
+  return stats;
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameAnalyzer::FrameAnalyzer(const Config& config) : impl_(std::make_unique<Impl>()) {
+  if (config.subsampling < 2) {
+    throw std::invalid_argument("Frame analysis subsampling must be at least 2");
+  }
+  impl_->config = config;
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameAnalyzer::~FrameAnalyzer() = default;
+
+//-------------------------------------------------------------------------------------------------
+auto FrameAnalyzer::supports(const ImageFrame::Header& header) -> bool {
+  return lumaLayout(header.format).has_value();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameAnalyzer::analyze(const ImageFrame& frame, std::size_t max_threads) -> FrameStatistics {
+  impl_->begin(frame);
+
+  // Bands of whole sample rows. Small grids are analysed on the calling thread, where waking the
+  // pool would cost more than it saves
+  static constexpr auto PARALLEL_MIN_SAMPLES = std::size_t{ 32768 };
+  static constexpr auto MIN_SAMPLE_ROWS_PER_BAND = 8U;
+  static constexpr auto BANDS_PER_THREAD = 4U;
+  const auto height = impl_->source.height;
+  const auto step = impl_->grid.subsampling;
+  const auto sample_rows = (height + step - 1) / step;
+  auto& pool = WorkerPool::shared();
+  const auto available = pool.concurrency();
+  const auto threads = (max_threads == 0) ? available : std::min(max_threads, available);
+  const auto bands = std::min<std::size_t>(threads * BANDS_PER_THREAD,
+                                           sample_rows / MIN_SAMPLE_ROWS_PER_BAND);
+  if ((impl_->samples.size() < PARALLEL_MIN_SAMPLES) || (threads < 2) || (bands < 2)) {
+    impl_->analyze(0, height);
+  } else {
+    const auto rows_per_band =
+        static_cast<std::uint32_t>((sample_rows + bands - 1) / bands) * step;
+    pool.parallelFor(bands, [this, rows_per_band, height](std::size_t band) {
+      const auto first = static_cast<std::uint32_t>(band) * rows_per_band;
+      impl_->analyze(first, std::min(first + rows_per_band, height));
+    });
+  }
+  return impl_->finish();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameAnalyzer::analyze(const ImageFrame& frame, const PixelConverter& converter,
+                            std::span<std::uint8_t> dst, std::size_t max_threads)
+    -> FrameStatistics {
+  impl_->begin(frame);
+  converter.convert(frame, dst, max_threads, [this](std::uint32_t first, std::uint32_t last) {
+    impl_->analyze(first, last);
+  });
+  return impl_->finish();
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameAnalyzer::reset() {
+  impl_->has_reference = false;
+}
+
+}  // namespace picam
+
+// NOLINTEND(*-pointer-arithmetic,*-reinterpret-cast,*-magic-numbers)
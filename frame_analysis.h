@@ -0,0 +1,89 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include "image_frame.h"
+#include "pixel_convert.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Per-frame statistics for deciding which frames to keep: a luma histogram, a focus score and
+/// motion against the previous frame, computed from a grid of one pixel in Config::subsampling
+/// along each axis. Rows are analysed in bands on WorkerPool::shared(), or in the same pass as
+/// their conversion to another format (see analyze() with a PixelConverter), so that each source
+/// row is read from memory once.
+///
+/// YUV frames (YUYV, NV12, YUV420) are analysed from their luma and RGB888 frames from the ITU-R
+/// BT.601 weighted sum of their colours. Raw frames are not supported.
+///
+/// Motion is measured against the previous frame analysed, so use one analyzer per stream, from
+/// one thread at a time
+class FrameAnalyzer {
+public:
+  struct Config {
+    /// Analyse one pixel in this many along each axis. At least 2
+    std::uint32_t subsampling{ 4 };
+
+    /// Change of the luma of a sample between frames that counts as motion
+    std::uint8_t motion_threshold{ 16 };
+
+    /// Fraction of samples that must change for a frame to be interesting
+    float motion_trigger{ 0.01F };
+
+    /// Frames with a lower focus score are never interesting, e.g. while the lens refocuses or
+    /// the camera shakes. 0 disables the check
+    float min_focus{ 0.0F };
+
+    /// Also mark one frame in this many as interesting whatever the motion, so that recordings
+    /// keep some context. 0 disables
+    std::uint32_t keyframe_interval{ 0 };
+  };
+
+  /// Throws std::invalid_argument if the subsampling is less than 2
+  /// @param config Analysis configuration
+  explicit FrameAnalyzer(const Config& config);
+
+  /// @return true if frames with the specified header can be analysed
+  [[nodiscard]] static auto supports(const ImageFrame::Header& header) -> bool;
+
+  /// Analyse a frame. Throws std::invalid_argument if its format is not supported or its planes
+  /// are too small for its size
+  /// @param frame Frame to analyse. Needs CPU access to the pixels
+  /// @param max_threads Threads to split the frame over, including the caller. 0 uses the whole
+  ///                    shared pool; 1 analyses on the calling thread only
+  /// @return Statistics of the frame, to attach to its header
+  auto analyze(const ImageFrame& frame, std::size_t max_threads = 0) -> FrameStatistics;
+
+  /// Analyse a frame while converting it, in a single pass over the source. Throws as above, and
+  /// as PixelConverter::convert()
+  /// @param frame Frame to analyse and convert
+  /// @param converter Converter for the format of the frame
+  /// @param dst Destination of the converted image
+  /// @param max_threads As above
+  /// @return Statistics of the frame, to attach to its header or the converted image's
+  auto analyze(const ImageFrame& frame, const PixelConverter& converter,
+               std::span<std::uint8_t> dst, std::size_t max_threads = 0) -> FrameStatistics;
+
+  /// Forget the previous frame, e.g. after moving the camera. The next frame is interesting
+  void reset();
+
+  ~FrameAnalyzer();
+  FrameAnalyzer(const FrameAnalyzer&) = delete;
+  FrameAnalyzer(FrameAnalyzer&&) = delete;
+  auto operator=(const FrameAnalyzer&) = delete;
+  auto operator=(FrameAnalyzer&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
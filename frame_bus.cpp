@@ -0,0 +1,665 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "frame_bus.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <linux/dma-buf.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// NOLINTBEGIN(*-pointer-arithmetic,*-reinterpret-cast)
+
+namespace picam {
+
+namespace {
+
+// Wire protocol. Server and clients are built from the same sources, so messages are plain
+// structs; the magic numbers catch mismatched builds. Messages have no implicit padding and send
+// floats as their bit patterns, so that every byte sent has a defined value
+constexpr auto FRAME_MESSAGE = std::uint32_t{ 0x50434635 };    // "PCF5"
+constexpr auto RELEASE_MESSAGE = std::uint32_t{ 0x50435231 };  // "PCR1"
+constexpr auto RESET_MESSAGE = std::uint32_t{ 0x50435831 };    // "PCX1"
+
+struct WirePlane {
+  std::uint64_t buffer_id;  // See bufferId()
+  std::uint32_t offset;
+  std::uint32_t stride;
+};
+
+struct WireMetadata {
+  std::int64_t exposure_time_us;
+  std::int64_t frame_duration_us;
+  std::uint32_t analogue_gain;  // Bit patterns of the floats
+  std::uint32_t digital_gain;
+  std::uint32_t colour_temperature;
+  std::uint32_t lux;
+  ImageRect scaler_crop;
+  std::uint64_t controls_id;
+};
+
+struct WireStatistics {
+  std::array<std::uint32_t, FrameStatistics::HISTOGRAM_BINS> histogram;
+  std::uint32_t samples;
+  std::uint32_t mean_luma;  // Bit patterns of the floats
+  std::uint32_t focus;
+  std::uint32_t motion;
+  std::uint8_t interesting;
+  std::array<std::uint8_t, 3> reserved{};
+};
+
+struct FrameMessage {
+  std::uint32_t type;
+  std::uint32_t frame_id;
+  std::int64_t timestamp_ns;
+  std::int64_t completion_time_ns;
+  std::uint32_t sequence;
+  std::uint32_t stream_id;
+  std::uint32_t pitch;
+  std::uint16_t width;
+  std::uint16_t height;
+  std::uint32_t format;
+  std::uint32_t reserved0{};
+  std::uint64_t format_modifier;
+  std::uint8_t encoding;
+  std::uint8_t range;
+  std::array<std::uint8_t, 6> reserved1{};
+  WireMetadata metadata;
+  WireStatistics statistics;
+  std::uint32_t plane_count;
+  std::array<WirePlane, ImageFrame::MAX_PLANES> planes;
+  std::uint32_t new_buffer_count;  // Buffers not sent before, attached as SCM_RIGHTS in order
+  std::uint32_t reserved2{};
+  std::array<std::uint64_t, ImageFrame::MAX_PLANES> new_buffer_ids;
+};
+
+struct ReleaseMessage {
+  std::uint32_t type;
+  std::uint32_t frame_id;
+};
+
+// Tells a client to drop the buffers it was sent, which the camera may have freed
+struct ResetMessage {
+  std::uint32_t type;
+};
+
+static_assert(std::has_unique_object_representations_v<FrameMessage>);
+static_assert(std::has_unique_object_representations_v<ReleaseMessage>);
+static_assert(std::has_unique_object_representations_v<ResetMessage>);
+
+using FdControlBuffer = std::array<std::byte, CMSG_SPACE(sizeof(int) * ImageFrame::MAX_PLANES)>;
+
+//-------------------------------------------------------------------------------------------------
+auto makeAddress(const std::string& path) -> sockaddr_un {
+  auto address = sockaddr_un{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument("Socket path too long: " + path);
+  }
+  std::ranges::copy(path, std::begin(address.sun_path));
+  return address;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toNanoseconds(SensorClock::time_point time) -> std::int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return Id of the buffer behind a dmabuf descriptor: the inode of the dmabuf, which is the same
+/// in every process and not reused for later buffers. Descriptor numbers are: a camera that frees
+/// its buffers (see Camera::reconfigure) usually gets the same numbers for the new ones
+auto bufferId(int fd) -> std::uint64_t {
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    throw std::runtime_error(std::string("Failed to identify dmabuf: ") + std::strerror(errno));
+  }
+  return info.st_ino;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toWire(const CaptureMetadata& metadata) -> WireMetadata {
+  return { .exposure_time_us = metadata.exposure_time.count(),
+           .frame_duration_us = metadata.frame_duration.count(),
+           .analogue_gain = std::bit_cast<std::uint32_t>(metadata.analogue_gain),
+           .digital_gain = std::bit_cast<std::uint32_t>(metadata.digital_gain),
+           .colour_temperature = metadata.colour_temperature,
+           .lux = std::bit_cast<std::uint32_t>(metadata.lux),
+           .scaler_crop = metadata.scaler_crop,
+           .controls_id = metadata.controls_id };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto fromWire(const WireMetadata& wire) -> CaptureMetadata {
+  return { .exposure_time = std::chrono::microseconds(wire.exposure_time_us),
+           .frame_duration = std::chrono::microseconds(wire.frame_duration_us),
+           .analogue_gain = std::bit_cast<float>(wire.analogue_gain),
+           .digital_gain = std::bit_cast<float>(wire.digital_gain),
+           .colour_temperature = wire.colour_temperature,
+           .lux = std::bit_cast<float>(wire.lux),
+           .scaler_crop = wire.scaler_crop,
+           .controls_id = wire.controls_id };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toWire(const FrameStatistics& statistics) -> WireStatistics {
+  return { .histogram = statistics.histogram,
+           .samples = statistics.samples,
+           .mean_luma = std::bit_cast<std::uint32_t>(statistics.mean_luma),
+           .focus = std::bit_cast<std::uint32_t>(statistics.focus),
+           .motion = std::bit_cast<std::uint32_t>(statistics.motion),
+           .interesting = static_cast<std::uint8_t>(statistics.interesting ? 1 : 0),
+           .reserved = {} };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto fromWire(const WireStatistics& wire) -> FrameStatistics {
+  return { .histogram = wire.histogram,
+           .samples = wire.samples,
+           .mean_luma = std::bit_cast<float>(wire.mean_luma),
+           .focus = std::bit_cast<float>(wire.focus),
+           .motion = std::bit_cast<float>(wire.motion),
+           .interesting = (wire.interesting != 0) };
+}
+
+//-------------------------------------------------------------------------------------------------
+void syncDmaBuf(int fd, std::uint64_t flags) {
+  auto sync = dma_buf_sync{ .flags = flags };
+  while ((ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) < 0) && (errno == EINTR)) {
+  }
+}
+
+}  // namespace
+
+//=================================================================================================
+struct FrameBusServer::Impl {
+  struct Client {
+    int fd{ -1 };
+    std::vector<std::uint64_t> known_buffers;                 // Buffers sent to the client
+    std::vector<std::pair<std::uint32_t, FrameHandle>> held;  // Frames the client holds, by id
+  };
+
+  Config config;
+  int listen_fd{ -1 };
+  int wake_fd{ -1 };  // Wakes the service thread for shutdown
+  std::jthread service_thread;
+  std::atomic_bool running{ true };
+
+  mutable std::mutex clients_mutex;  // Between publish() and the service thread
+  std::vector<Client> clients;
+  std::uint32_t next_frame_id{ 1 };
+
+  // Instrumentation
+  std::atomic_uint64_t published_count{ 0 };
+  std::atomic_uint64_t sent_count{ 0 };
+  std::atomic_uint64_t skipped_count{ 0 };
+
+  void listen();
+  void serviceLoop();
+  void acceptClient();
+  auto receiveReleases(Client& client) -> bool;
+  auto send(Client& client, FrameMessage message, const ImageFrame& frame) -> bool;
+};
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusServer::Impl::listen() {
+  const auto address = makeAddress(config.socket_path);
+  unlink(config.socket_path.c_str());  // Left behind by a previous run
+  listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if ((listen_fd < 0) ||
+      (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) ||
+      (::listen(listen_fd, static_cast<int>(config.max_clients)) != 0)) {
+    throw std::runtime_error("Failed to listen on " + config.socket_path);
+  }
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd < 0) {
+    throw std::runtime_error("Failed to create frame bus eventfd");
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusServer::Impl::serviceLoop() {
+  auto pfds = std::vector<pollfd>{};
+  while (running.load(std::memory_order_acquire)) {
+    pfds.clear();
+    pfds.push_back({ .fd = wake_fd, .events = POLLIN, .revents = 0 });
+    pfds.push_back({ .fd = listen_fd, .events = POLLIN, .revents = 0 });
+    {
+      const auto lock = std::scoped_lock(clients_mutex);
+      for (const auto& client : clients) {
+        pfds.push_back({ .fd = client.fd, .events = POLLIN, .revents = 0 });
+      }
+    }
+    if (poll(pfds.data(), pfds.size(), -1) < 0) {
+      continue;  // EINTR
+    }
+    if ((pfds[1].revents & POLLIN) != 0) {
+      acceptClient();
+    }
+
+    // Frames of disconnected clients are released outside the lock
+    auto disconnected = std::vector<Client>{};
+    {
+      const auto lock = std::scoped_lock(clients_mutex);
+      for (auto it = pfds.begin() + 2; it != pfds.end(); ++it) {
+        if (it->revents == 0) {
+          continue;
+        }
+        const auto client = std::ranges::find(clients, it->fd, &Client::fd);
+        if ((client != clients.end()) && not receiveReleases(*client)) {
+          disconnected.push_back(std::move(*client));
+          clients.erase(client);
+        }
+      }
+    }
+    for (auto& client : disconnected) {
+      close(client.fd);
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusServer::Impl::acceptClient() {
+  const auto fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  const auto lock = std::scoped_lock(clients_mutex);
+  if (clients.size() >= config.max_clients) {
+    std::println(stderr, "Warning: Frame bus client refused, limit of {} reached",
+                 config.max_clients);
+    close(fd);
+    return;
+  }
+  clients.push_back({ .fd = fd, .known_buffers = {}, .held = {} });
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameBusServer::Impl::receiveReleases(Client& client) -> bool {
+  while (true) {
+    auto message = ReleaseMessage{};
+    const auto ret = recv(client.fd, &message, sizeof(message), MSG_DONTWAIT);
+    if (ret == 0) {
+      return false;  // Orderly disconnect
+    }
+    if (ret < 0) {
+      return (errno == EAGAIN) || (errno == EINTR);
+    }
+    if ((static_cast<std::size_t>(ret) != sizeof(message)) || (message.type != RELEASE_MESSAGE)) {
+      std::println(stderr, "Warning: Disconnecting frame bus client after invalid message");
+      return false;
+    }
+    std::erase_if(client.held, [&message](const auto& held) {
+      return held.first == message.frame_id;
+    });
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameBusServer::Impl::send(Client& client, FrameMessage message, const ImageFrame& frame)
+    -> bool {
+  // Attach buffers the client has not seen yet. Planes may share a buffer
+  auto fds = std::array<int, ImageFrame::MAX_PLANES>{};
+  message.new_buffer_count = 0;
+  for (std::uint32_t i = 0; i < frame.plane_count; ++i) {
+    const auto id = message.planes.at(i).buffer_id;
+    const auto new_end = message.new_buffer_ids.begin() + message.new_buffer_count;
+    if ((std::ranges::find(client.known_buffers, id) != client.known_buffers.end()) ||
+        (std::find(message.new_buffer_ids.begin(), new_end, id) != new_end)) {
+      continue;
+    }
+    fds.at(message.new_buffer_count) = frame.planes.at(i).fd;
+    message.new_buffer_ids.at(message.new_buffer_count++) = id;
+  }
+
+  auto iov = iovec{ .iov_base = &message, .iov_len = sizeof(message) };
+  auto control = FdControlBuffer{};
+  auto header = msghdr{};
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  if (message.new_buffer_count > 0) {
+    header.msg_control = control.data();
+    header.msg_controllen = CMSG_SPACE(sizeof(int) * message.new_buffer_count);
+    auto* cmsg = CMSG_FIRSTHDR(&header);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * message.new_buffer_count);
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * message.new_buffer_count);
+  }
+  // Never blocks: a client with a full socket buffer misses the frame. A broken connection is
+  // noticed and cleaned up by the service thread
+  if (sendmsg(client.fd, &header, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+    return false;
+  }
+  client.known_buffers.insert(client.known_buffers.end(), message.new_buffer_ids.begin(),
+                              message.new_buffer_ids.begin() + message.new_buffer_count);
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusServer::FrameBusServer(const Config& config) : impl_(std::make_unique<Impl>()) {
+  impl_->config = config;
+  try {
+    impl_->listen();
+  } catch (...) {
+    if (impl_->listen_fd >= 0) {
+      close(impl_->listen_fd);
+    }
+    throw;
+  }
+  impl_->service_thread = std::jthread([impl = impl_.get()] { impl->serviceLoop(); });
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusServer::~FrameBusServer() {
+  impl_->running.store(false, std::memory_order_release);
+  static constexpr auto ONE = std::uint64_t{ 1 };
+  std::ignore = write(impl_->wake_fd, &ONE, sizeof(ONE));
+  impl_->service_thread = {};  // joins
+
+  for (const auto& client : impl_->clients) {
+    close(client.fd);
+  }
+  impl_->clients.clear();  // Releases all frames held by clients
+  close(impl_->listen_fd);
+  close(impl_->wake_fd);
+  unlink(impl_->config.socket_path.c_str());
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusServer::publish(const FrameHandle& handle, std::size_t stream) {
+  const auto& frame = handle.frame(stream);
+  if ((frame.plane_count == 0) || (frame.planes[0].fd < 0)) {
+    throw std::invalid_argument("Frame bus needs frames with dmabuf descriptors");
+  }
+  impl_->published_count.fetch_add(1, std::memory_order_relaxed);
+
+  const auto& header = frame.header;
+  auto message = FrameMessage{};
+  message.type = FRAME_MESSAGE;
+  message.timestamp_ns = toNanoseconds(header.timestamp);
+  message.completion_time_ns = toNanoseconds(header.completion_time);
+  message.sequence = header.sequence;
+  message.stream_id = header.stream_id;
+  message.pitch = header.pitch;
+  message.width = header.size.width;
+  message.height = header.size.height;
+  message.format = header.format;
+  message.format_modifier = header.format_modifier;
+  message.encoding = static_cast<std::uint8_t>(header.color_space.encoding);
+  message.range = static_cast<std::uint8_t>(header.color_space.range);
+  message.metadata = toWire(header.metadata);
+  message.statistics = toWire(header.statistics);
+  message.plane_count = frame.plane_count;
+  for (std::uint32_t i = 0; i < frame.plane_count; ++i) {
+    const auto& plane = frame.planes.at(i);
+    message.planes.at(i) = {
+      .buffer_id = bufferId(plane.fd), .offset = plane.offset, .stride = plane.stride
+    };
+  }
+
+  const auto lock = std::scoped_lock(impl_->clients_mutex);
+  message.frame_id = impl_->next_frame_id++;
+  for (auto& client : impl_->clients) {
+    if ((client.held.size() >= impl_->config.max_frames_per_client) ||
+        not impl_->send(client, message, frame)) {
+      impl_->skipped_count.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    client.held.emplace_back(message.frame_id, handle.clone());
+    impl_->sent_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusServer::reconfigure() {
+  const auto lock = std::scoped_lock(impl_->clients_mutex);
+  const auto holds_frames = [](const Impl::Client& client) { return not client.held.empty(); };
+  if (std::ranges::any_of(impl_->clients, holds_frames)) {
+    throw std::logic_error("Frame bus clients still hold frames");
+  }
+  // A client that misses the reset keeps its mappings, but is sent the new buffers all the same
+  const auto message = ResetMessage{ .type = RESET_MESSAGE };
+  for (auto& client : impl_->clients) {
+    client.known_buffers.clear();
+    std::ignore = ::send(client.fd, &message, sizeof(message), MSG_DONTWAIT | MSG_NOSIGNAL);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameBusServer::stats() const -> Stats {
+  auto clients = std::uint32_t{ 0 };
+  {
+    const auto lock = std::scoped_lock(impl_->clients_mutex);
+    clients = static_cast<std::uint32_t>(impl_->clients.size());
+  }
+  return { .clients = clients,
+           .published = impl_->published_count.load(std::memory_order_relaxed),
+           .sent = impl_->sent_count.load(std::memory_order_relaxed),
+           .skipped = impl_->skipped_count.load(std::memory_order_relaxed) };
+}
+
+//=================================================================================================
+struct FrameBusClient::Impl {
+  // Buffer received from the server, mapped for CPU reads
+  struct Buffer {
+    std::uint64_t id{};  // See bufferId()
+    int fd{ -1 };
+    std::byte* memory{ nullptr };
+    std::size_t length{};
+  };
+
+  int socket_fd{ -1 };
+  std::vector<Buffer> buffers;
+
+  void addBuffer(std::uint64_t id, int fd);
+  [[nodiscard]] auto findBuffer(std::uint64_t id) const -> const Buffer*;
+  void clearBuffers();
+};
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusClient::Impl::addBuffer(std::uint64_t id, int fd) {
+  if (findBuffer(id) != nullptr) {
+    close(fd);  // Sent again after a reset this client missed
+    return;
+  }
+  const auto size = lseek(fd, 0, SEEK_END);
+  auto* memory = (size > 0) ? mmap(nullptr, static_cast<std::size_t>(size), PROT_READ,
+                                   MAP_SHARED, fd, 0)
+                            : MAP_FAILED;
+  if (memory == MAP_FAILED) {
+    // Still usable by dmabuf consumers (GPU, encoders)
+    std::println(stderr, "Warning: Failed to map frame bus buffer: {}", std::strerror(errno));
+    buffers.push_back({ .id = id, .fd = fd, .memory = nullptr, .length = 0 });
+    return;
+  }
+  buffers.push_back({ .id = id,
+                      .fd = fd,
+                      .memory = static_cast<std::byte*>(memory),
+                      .length = static_cast<std::size_t>(size) });
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameBusClient::Impl::findBuffer(std::uint64_t id) const -> const Buffer* {
+  const auto it = std::ranges::find(buffers, id, &Buffer::id);
+  return (it != buffers.end()) ? &*it : nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusClient::Impl::clearBuffers() {
+  for (const auto& buffer : buffers) {
+    if (buffer.memory != nullptr) {
+      munmap(buffer.memory, buffer.length);
+    }
+    close(buffer.fd);
+  }
+  buffers.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusClient::FrameBusClient(const std::string& socket_path) : impl_(std::make_unique<Impl>()) {
+  const auto address = makeAddress(socket_path);
+  impl_->socket_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if ((impl_->socket_fd < 0) ||
+      (connect(impl_->socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) !=
+       0)) {
+    if (impl_->socket_fd >= 0) {
+      close(impl_->socket_fd);
+    }
+    throw std::runtime_error("Failed to connect to frame bus at " + socket_path);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusClient::~FrameBusClient() {
+  impl_->clearBuffers();
+  close(impl_->socket_fd);  // The server releases anything still held
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameBusClient::acquire(std::chrono::milliseconds timeout) -> std::optional<Frame> {
+  auto pfd = pollfd{ .fd = impl_->socket_fd, .events = POLLIN, .revents = 0 };
+  if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) {
+    return std::nullopt;
+  }
+
+  auto message = FrameMessage{};
+  auto iov = iovec{ .iov_base = &message, .iov_len = sizeof(message) };
+  auto control = FdControlBuffer{};
+  auto header = msghdr{};
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = control.data();
+  header.msg_controllen = control.size();
+  const auto ret = recvmsg(impl_->socket_fd, &header, MSG_CMSG_CLOEXEC);
+  if (ret == 0) {
+    throw std::runtime_error("Frame bus server disconnected");
+  }
+  if (ret < 0) {
+    return std::nullopt;  // EINTR
+  }
+
+  // Take ownership of received descriptors first, so that none leak if the message is bad
+  auto received = std::vector<int>{};
+  for (auto* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+      const auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const auto* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+      received.insert(received.end(), data, data + count);
+    }
+  }
+  if ((static_cast<std::size_t>(ret) == sizeof(ResetMessage)) &&
+      (message.type == RESET_MESSAGE) && received.empty()) {
+    // The server checked that no frames of these buffers are held (FrameBusServer::reconfigure)
+    impl_->clearBuffers();
+    return std::nullopt;
+  }
+  if ((static_cast<std::size_t>(ret) != sizeof(message)) || (message.type != FRAME_MESSAGE) ||
+      (message.plane_count > ImageFrame::MAX_PLANES) ||
+      (received.size() != message.new_buffer_count)) {
+    std::ranges::for_each(received, [](int fd) { close(fd); });
+    throw std::runtime_error("Invalid frame bus message (mismatched server build?)");
+  }
+  for (std::size_t i = 0; i < received.size(); ++i) {
+    impl_->addBuffer(message.new_buffer_ids.at(i), received[i]);
+  }
+
+  auto frame = ImageFrame{};
+  auto& frame_header = frame.header;
+  frame_header.timestamp =
+      SensorClock::time_point{ std::chrono::nanoseconds{ message.timestamp_ns } };
+  frame_header.completion_time =
+      SensorClock::time_point{ std::chrono::nanoseconds{ message.completion_time_ns } };
+  frame_header.sequence = message.sequence;
+  frame_header.stream_id = message.stream_id;
+  frame_header.pitch = message.pitch;
+  frame_header.size = { .width = message.width, .height = message.height };
+  frame_header.format = message.format;
+  frame_header.format_modifier = message.format_modifier;
+  frame_header.color_space = { .encoding = static_cast<ColorSpace::Encoding>(message.encoding),
+                               .range = static_cast<ColorSpace::Range>(message.range) };
+  frame_header.metadata = fromWire(message.metadata);
+  frame_header.statistics = fromWire(message.statistics);
+  frame.plane_count = message.plane_count;
+  for (std::uint32_t i = 0; i < message.plane_count; ++i) {
+    const auto& wire = message.planes.at(i);
+    const auto* buffer = impl_->findBuffer(wire.buffer_id);
+    if (buffer == nullptr) {
+      throw std::runtime_error("Frame bus message names an unknown buffer");
+    }
+    auto& plane = frame.planes.at(i);
+    plane = { .data = {}, .stride = wire.stride, .fd = buffer->fd, .offset = wire.offset };
+    if ((buffer->memory != nullptr) && (wire.offset < buffer->length)) {
+      // A plane extends to the next plane in the same buffer, or to the end of the buffer
+      auto end = buffer->length;
+      for (std::uint32_t j = 0; j < message.plane_count; ++j) {
+        const auto& other = message.planes.at(j);
+        if ((other.buffer_id == wire.buffer_id) && (other.offset > wire.offset)) {
+          end = std::min<std::size_t>(end, other.offset);
+        }
+      }
+      plane.data = std::span(buffer->memory + wire.offset, end - wire.offset);
+    }
+  }
+  for (std::uint32_t i = 0; i < frame.plane_count; ++i) {
+    if ((i == 0) || (frame.planes.at(i).fd != frame.planes.at(i - 1).fd)) {
+      syncDmaBuf(frame.planes.at(i).fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+    }
+  }
+  return Frame(this, message.frame_id, frame);
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameBusClient::release(std::uint32_t id, const ImageFrame& frame) {
+  for (std::uint32_t i = 0; i < frame.plane_count; ++i) {
+    if ((i == 0) || (frame.planes.at(i).fd != frame.planes.at(i - 1).fd)) {
+      syncDmaBuf(frame.planes.at(i).fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+    }
+  }
+  const auto message = ReleaseMessage{ .type = RELEASE_MESSAGE, .frame_id = id };
+  // If the server is gone, there is nothing left to release
+  std::ignore = send(impl_->socket_fd, &message, sizeof(message), MSG_NOSIGNAL);
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusClient::Frame::Frame(FrameBusClient* client, std::uint32_t id, const ImageFrame& frame)
+  : client_(client), id_(id), frame_(frame) {
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusClient::Frame::Frame(Frame&& other) noexcept
+  : client_(std::exchange(other.client_, nullptr)), id_(other.id_), frame_(other.frame_) {
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameBusClient::Frame::~Frame() {
+  if (client_ != nullptr) {
+    client_->release(id_, frame_);
+  }
+}
+
+}  // namespace picam
+
+// NOLINTEND(*-pointer-arithmetic,*-reinterpret-cast)
@@ -0,0 +1,133 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "frame_handle.h"
+#include "image_frame.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Shares the frames of one camera with other processes, without copying pixels. Only one process
+/// can own a libcamera camera; it runs the server and publishes captures to any number of
+/// clients connected over a Unix socket.
+///
+/// Capture buffers are passed to each client once, as dmabuf descriptors (SCM_RIGHTS); after
+/// that, frames are announced with small descriptor messages that name the buffers and carry the
+/// whole frame header, capture metadata and analysis statistics included. Each client holds a
+/// reference to a frame until it releases it, and a capture buffer returns to the camera when the
+/// last reference, in any process, is released. A client that exits or crashes releases
+/// everything it held. Clients that fall behind skip frames instead of starving the camera
+class FrameBusServer {
+public:
+  struct Config {
+    /// Path of the Unix socket to listen on. Replaced if it exists
+    std::string socket_path{ "/tmp/picam.sock" };
+
+    /// Maximum number of connected clients
+    std::uint32_t max_clients{ 8 };
+
+    /// Frames a client may hold at once. Frames published while a client holds this many are
+    /// not sent to it. Keep the total across clients below the number of capture buffers
+    std::uint32_t max_frames_per_client{ 1 };
+  };
+
+  /// Bus instrumentation
+  struct Stats {
+    std::uint32_t clients{};    //!< Clients connected when sampled
+    std::uint64_t published{};  //!< Frames offered to clients
+    std::uint64_t sent{};       //!< Frame messages sent, summed over clients
+    std::uint64_t skipped{};    //!< Frames not sent to a client that was at its limit or busy
+  };
+
+  /// Start listening for clients
+  /// @param config Server configuration
+  explicit FrameBusServer(const Config& config);
+
+  /// Offer a capture to all connected clients. Does not block. Each client that receives it
+  /// holds its own reference to the frame. Frames must carry dmabuf descriptors
+  /// @param handle Capture to publish. Not consumed; the caller may keep using it
+  /// @param stream Index of the stream to publish, in Camera::Config::streams
+  void publish(const FrameHandle& handle, std::size_t stream = 0);
+
+  /// Make clients drop the buffers they were sent, after the camera has been reconfigured (see
+  /// Camera::reconfigure), so that they do not keep buffers the camera freed mapped. Frames sent
+  /// afterwards attach their buffers again. Frames clients hold count as frame handles held, which
+  /// make Camera::reconfigure throw std::logic_error, and make this throw std::logic_error too
+  void reconfigure();
+
+  /// @return Snapshot of bus statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  /// Disconnects clients and releases all frames they held. Must be destroyed before the Camera
+  ~FrameBusServer();
+  FrameBusServer(const FrameBusServer&) = delete;
+  FrameBusServer(FrameBusServer&&) = delete;
+  auto operator=(const FrameBusServer&) = delete;
+  auto operator=(FrameBusServer&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+//=================================================================================================
+/// Receives frames published by a FrameBusServer in another process. Dmabufs are mapped for CPU
+/// reads once, when first received. Not safe to use from several threads at once
+class FrameBusClient {
+public:
+  /// Frame received from the server. The server's reference is released on destruction, so hold
+  /// frames only as long as needed. Must be destroyed before the client that produced it
+  class Frame {
+  public:
+    /// @return The frame. Pixel data is read-only; dmabuf descriptors are local to this process
+    [[nodiscard]] auto frame() const -> const ImageFrame& {
+      return frame_;
+    }
+
+    ~Frame();
+    Frame(const Frame&) = delete;
+    Frame(Frame&& other) noexcept;
+    auto operator=(const Frame&) = delete;
+    auto operator=(Frame&&) = delete;
+
+  private:
+    friend class FrameBusClient;
+    Frame(FrameBusClient* client, std::uint32_t id, const ImageFrame& frame);
+    FrameBusClient* client_;
+    std::uint32_t id_;
+    ImageFrame frame_;
+  };
+
+  /// Connect to a server
+  /// @param socket_path Path of the server's Unix socket
+  explicit FrameBusClient(const std::string& socket_path);
+
+  /// Wait for the next frame
+  /// @param timeout Maximum time to wait
+  /// @return The frame, or nothing on timeout or when the server reset its buffers (see
+  ///         FrameBusServer::reconfigure). Throws if the server disconnected
+  auto acquire(std::chrono::milliseconds timeout) -> std::optional<Frame>;
+
+  ~FrameBusClient();
+  FrameBusClient(const FrameBusClient&) = delete;
+  FrameBusClient(FrameBusClient&&) = delete;
+  auto operator=(const FrameBusClient&) = delete;
+  auto operator=(FrameBusClient&&) = delete;
+
+private:
+  void release(std::uint32_t id, const ImageFrame& frame);
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
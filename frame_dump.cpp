@@ -0,0 +1,646 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "frame_dump.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// NOLINTBEGIN(*-pointer-arithmetic,*-reinterpret-cast)
+
+namespace picam {
+
+namespace {
+
+// File format. Dumps are written and read by the same sources, so records are plain structs; the
+// magic numbers and version catch files from mismatched builds
+constexpr auto FILE_MAGIC = std::uint32_t{ 0x50434431 };     // "PCD1"
+constexpr auto RECORD_MAGIC = std::uint32_t{ 0x50445231 };   // "PDR1"
+constexpr auto TRAILER_MAGIC = std::uint32_t{ 0x50444931 };  // "PDI1"
+constexpr auto FORMAT_VERSION = std::uint32_t{ 2 };
+
+// Sections are aligned to pages, which covers the block size O_DIRECT needs on common devices.
+// Planes are aligned for vector loads
+constexpr auto PAGE_BYTES = std::size_t{ 4096 };
+constexpr auto PLANE_ALIGNMENT = std::size_t{ 64 };
+
+// Structs written to disk have no implicit padding, which would be written as indeterminate bytes
+struct FileHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t page_size;
+};
+
+struct DiskPlane {
+  std::uint64_t offset;  // From the start of the record
+  std::uint64_t size;
+  std::uint32_t stride;
+  std::uint32_t reserved;
+};
+
+struct RecordHeader {
+  std::uint32_t magic;
+  std::uint32_t plane_count;
+  std::uint64_t record_size;  // Padding included
+  std::int64_t timestamp_ns;
+  std::int64_t completion_time_ns;
+  std::uint32_t sequence;
+  std::uint32_t stream_id;
+  std::uint32_t pitch;
+  std::uint16_t width;
+  std::uint16_t height;
+  std::uint32_t format;
+  std::uint32_t reserved0;
+  std::uint64_t format_modifier;
+  std::uint8_t encoding;
+  std::uint8_t range;
+  std::array<std::uint8_t, 6> reserved1;
+  std::int64_t exposure_time_us;
+  std::int64_t frame_duration_us;
+  float analogue_gain;
+  float digital_gain;
+  std::uint32_t colour_temperature;
+  float lux;
+  ImageRect scaler_crop;
+  std::uint64_t controls_id;
+  std::array<DiskPlane, ImageFrame::MAX_PLANES> planes;
+};
+
+struct IndexEntry {
+  std::uint64_t offset;
+  std::uint64_t size;
+  std::int64_t timestamp_ns;
+};
+
+struct Trailer {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t index_offset;
+  std::uint64_t entry_count;
+};
+
+static_assert(std::is_trivially_copyable_v<RecordHeader>);
+static_assert(sizeof(FileHeader) <= PAGE_BYTES);
+
+//-------------------------------------------------------------------------------------------------
+constexpr auto alignUp(std::size_t value, std::size_t alignment) -> std::size_t {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toNanoseconds(SensorClock::time_point time) -> std::int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toTimePoint(std::int64_t ns) -> SensorClock::time_point {
+  return SensorClock::time_point(
+      std::chrono::duration_cast<SensorClock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return Record header of a frame, with the planes laid out after it
+auto makeRecordHeader(const ImageFrame& frame) -> RecordHeader {
+  const auto& header = frame.header;
+  const auto& metadata = header.metadata;
+  auto record = RecordHeader{ .magic = RECORD_MAGIC,
+                              .plane_count = frame.plane_count,
+                              .record_size = 0,
+                              .timestamp_ns = toNanoseconds(header.timestamp),
+                              .completion_time_ns = toNanoseconds(header.completion_time),
+                              .sequence = header.sequence,
+                              .stream_id = header.stream_id,
+                              .pitch = header.pitch,
+                              .width = header.size.width,
+                              .height = header.size.height,
+                              .format = header.format,
+                              .reserved0 = 0,
+                              .format_modifier = header.format_modifier,
+                              .encoding = static_cast<std::uint8_t>(header.color_space.encoding),
+                              .range = static_cast<std::uint8_t>(header.color_space.range),
+                              .reserved1 = {},
+                              .exposure_time_us = metadata.exposure_time.count(),
+                              .frame_duration_us = metadata.frame_duration.count(),
+                              .analogue_gain = metadata.analogue_gain,
+                              .digital_gain = metadata.digital_gain,
+                              .colour_temperature = metadata.colour_temperature,
+                              .lux = metadata.lux,
+                              .scaler_crop = metadata.scaler_crop,
+                              .controls_id = metadata.controls_id,
+                              .planes = {} };
+  auto offset = alignUp(sizeof(RecordHeader), PLANE_ALIGNMENT);
+  for (std::size_t i = 0; i < frame.plane_count; ++i) {
+    const auto& plane = frame.planes.at(i);
+    record.planes.at(i) = {
+      .offset = offset, .size = plane.data.size(), .stride = plane.stride, .reserved = 0
+    };
+    offset = alignUp(offset + plane.data.size(), PLANE_ALIGNMENT);
+  }
+  record.record_size = alignUp(offset, PAGE_BYTES);
+  return record;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toHeader(const RecordHeader& record) -> ImageFrame::Header {
+  return {
+    .timestamp = toTimePoint(record.timestamp_ns),
+    .completion_time = toTimePoint(record.completion_time_ns),
+    .sequence = record.sequence,
+    .stream_id = record.stream_id,
+    .pitch = record.pitch,
+    .size = { .width = record.width, .height = record.height },
+    .format = record.format,
+    .format_modifier = record.format_modifier,
+    .color_space = { .encoding = static_cast<ColorSpace::Encoding>(record.encoding),
+                     .range = static_cast<ColorSpace::Range>(record.range) },
+    .metadata = { .exposure_time = std::chrono::microseconds(record.exposure_time_us),
+                  .frame_duration = std::chrono::microseconds(record.frame_duration_us),
+                  .analogue_gain = record.analogue_gain,
+                  .digital_gain = record.digital_gain,
+                  .colour_temperature = record.colour_temperature,
+                  .lux = record.lux,
+                  .scaler_crop = record.scaler_crop,
+                  .controls_id = record.controls_id },
+    .statistics = {},
+  };
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Page-aligned memory, as O_DIRECT needs
+struct PageFree {
+  void operator()(std::byte* data) const noexcept {
+    std::free(data);  // NOLINT(*-no-malloc,*-owning-memory)
+  }
+};
+using PageBuffer = std::unique_ptr<std::byte, PageFree>;
+
+//-------------------------------------------------------------------------------------------------
+auto allocatePages(std::size_t size) -> PageBuffer {
+  // NOLINTNEXTLINE(*-no-malloc,*-owning-memory)
+  auto buffer = PageBuffer(static_cast<std::byte*>(std::aligned_alloc(PAGE_BYTES, size)));
+  if (not buffer) {
+    throw std::bad_alloc();
+  }
+  std::memset(buffer.get(), 0, size);
+  return buffer;
+}
+
+//-------------------------------------------------------------------------------------------------
+/// Write all of the buffers at the offset, retrying partial writes
+/// @return false on error
+auto writeFully(int fd, std::uint64_t offset, std::vector<iovec> buffers) -> bool {
+  auto remaining = std::span(buffers);
+  while (not remaining.empty()) {
+    const auto count = static_cast<int>(std::min<std::size_t>(remaining.size(), IOV_MAX));
+    const auto ret = pwritev(fd, remaining.data(), count, static_cast<off_t>(offset));
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    offset += static_cast<std::uint64_t>(ret);
+    auto written = static_cast<std::size_t>(ret);
+    while (not remaining.empty() && (written >= remaining.front().iov_len)) {
+      written -= remaining.front().iov_len;
+      remaining = remaining.subspan(1);
+    }
+    if (written > 0) {
+      remaining.front().iov_base = static_cast<std::byte*>(remaining.front().iov_base) + written;
+      remaining.front().iov_len -= written;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+//=================================================================================================
+struct FrameDumpWriter::Impl {
+  // Copy of a frame waiting for the disk
+  struct Staging {
+    PageBuffer data;
+    std::size_t capacity{};
+    std::size_t size{};
+    std::int64_t timestamp_ns{};
+  };
+
+  int fd{ -1 };
+  std::vector<Staging> buffers;
+
+  std::mutex mutex;  // Between write() and the writer thread
+  std::condition_variable ready;
+  std::vector<Staging*> free_buffers;
+  std::deque<Staging*> pending;
+  bool stopping{ false };
+  std::jthread writer_thread;
+
+  // Writer thread only
+  std::uint64_t file_offset{ PAGE_BYTES };
+  std::vector<IndexEntry> index;
+  bool failed{ false };
+
+  // Instrumentation
+  std::atomic_uint64_t written_count{ 0 };
+  std::atomic_uint64_t dropped_count{ 0 };
+  std::atomic_uint64_t byte_count{ 0 };
+  DurationHistogram copy_time;
+  DurationHistogram batch_time;
+
+  void open(const std::string& path);
+  void writerLoop();
+  void writeBatch(std::span<Staging* const> batch);
+  void writeIndex();
+};
+
+//-------------------------------------------------------------------------------------------------
+void FrameDumpWriter::Impl::open(const std::string& path) {
+  static constexpr auto FILE_MODE = 0644;
+  static constexpr auto FLAGS = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  // Bypass the page cache where possible, so that dumping does not evict everything else. Not
+  // all file systems support it (e.g. tmpfs)
+  fd = ::open(path.c_str(), FLAGS | O_DIRECT, FILE_MODE);  // NOLINT(*-vararg)
+  if ((fd < 0) && (errno == EINVAL)) {
+    fd = ::open(path.c_str(), FLAGS, FILE_MODE);  // NOLINT(*-vararg)
+  }
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open dump file " + path);
+  }
+
+  auto page = allocatePages(PAGE_BYTES);
+  const auto header =
+      FileHeader{ .magic = FILE_MAGIC, .version = FORMAT_VERSION, .page_size = PAGE_BYTES };
+  std::memcpy(page.get(), &header, sizeof(header));
+  if (not writeFully(fd, 0, { { .iov_base = page.get(), .iov_len = PAGE_BYTES } })) {
+    close(fd);
+    throw std::runtime_error("Failed to write dump file " + path);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameDumpWriter::Impl::writerLoop() {
+  auto batch = std::vector<Staging*>{};
+  batch.reserve(buffers.size());
+  while (true) {
+    {
+      auto lock = std::unique_lock(mutex);
+      ready.wait(lock, [this] { return stopping || not pending.empty(); });
+      if (pending.empty()) {
+        return;  // Stopping, and everything was written
+      }
+      batch.assign(pending.begin(), pending.end());
+      pending.clear();
+    }
+    writeBatch(batch);
+    {
+      const auto lock = std::scoped_lock(mutex);
+      free_buffers.insert(free_buffers.end(), batch.begin(), batch.end());
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameDumpWriter::Impl::writeBatch(std::span<Staging* const> batch) {
+  if (failed) {
+    dropped_count.fetch_add(batch.size(), std::memory_order_relaxed);
+    return;
+  }
+  // Records are contiguous in the file, so the batch is one vectored write
+  const auto timer = ScopedTimer(batch_time);
+  auto iovecs = std::vector<iovec>{};
+  iovecs.reserve(batch.size());
+  auto offset = file_offset;
+  for (const auto* staging : batch) {
+    iovecs.push_back({ .iov_base = staging->data.get(), .iov_len = staging->size });
+    index.push_back(
+        { .offset = offset, .size = staging->size, .timestamp_ns = staging->timestamp_ns });
+    offset += staging->size;
+  }
+  if (not writeFully(fd, file_offset, std::move(iovecs))) {
+    std::println(stderr, "Warning: Writing frame dump failed, discarding further frames: {}",
+                 std::strerror(errno));
+    index.resize(index.size() - batch.size());
+    dropped_count.fetch_add(batch.size(), std::memory_order_relaxed);
+    failed = true;
+    return;
+  }
+  byte_count.fetch_add(offset - file_offset, std::memory_order_relaxed);
+  written_count.fetch_add(batch.size(), std::memory_order_relaxed);
+  file_offset = offset;
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameDumpWriter::Impl::writeIndex() {
+  // The trailer takes the last bytes of the padded index, so readers find it at the end of file
+  const auto index_bytes = index.size() * sizeof(IndexEntry);
+  const auto size = alignUp(index_bytes + sizeof(Trailer), PAGE_BYTES);
+  auto buffer = allocatePages(size);
+  std::memcpy(buffer.get(), index.data(), index_bytes);
+  const auto trailer = Trailer{ .magic = TRAILER_MAGIC,
+                                .version = FORMAT_VERSION,
+                                .index_offset = file_offset,
+                                .entry_count = index.size() };
+  std::memcpy(buffer.get() + size - sizeof(Trailer), &trailer, sizeof(trailer));
+  if (not writeFully(fd, file_offset, { { .iov_base = buffer.get(), .iov_len = size } })) {
+    std::println(stderr, "Warning: Writing frame dump index failed: {}", std::strerror(errno));
+    return;
+  }
+  byte_count.fetch_add(size, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameDumpWriter::FrameDumpWriter(const Config& config) : impl_(std::make_unique<Impl>()) {
+  impl_->buffers.resize(std::max(config.buffer_count, 1U));
+  for (auto& buffer : impl_->buffers) {
+    impl_->free_buffers.push_back(&buffer);
+  }
+  impl_->open(config.path);
+  impl_->writer_thread = std::jthread([impl = impl_.get()] { impl->writerLoop(); });
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameDumpWriter::~FrameDumpWriter() {
+  {
+    const auto lock = std::scoped_lock(impl_->mutex);
+    impl_->stopping = true;
+  }
+  impl_->ready.notify_one();
+  impl_->writer_thread = {};  // joins
+  if (not impl_->failed) {
+    impl_->writeIndex();
+  }
+  close(impl_->fd);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpWriter::write(const ImageFrame& frame) -> bool {
+  if ((frame.plane_count == 0) || (frame.plane_count > ImageFrame::MAX_PLANES) ||
+      frame.planes[0].data.empty()) {
+    throw std::invalid_argument("Frame dump needs CPU access to the frame's pixels");
+  }
+  Impl::Staging* staging = nullptr;
+  {
+    const auto lock = std::scoped_lock(impl_->mutex);
+    if (not impl_->free_buffers.empty()) {
+      staging = impl_->free_buffers.back();
+      impl_->free_buffers.pop_back();
+    }
+  }
+  if (staging == nullptr) {
+    impl_->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  {
+    const auto timer = ScopedTimer(impl_->copy_time);
+    const auto record = makeRecordHeader(frame);
+    if (staging->capacity < record.record_size) {
+      staging->data = allocatePages(record.record_size);  // Grows with the first frames only
+      staging->capacity = record.record_size;
+    }
+    auto* const bytes = staging->data.get();
+    std::memcpy(bytes, &record, sizeof(record));
+    // Gaps between planes are zeroed rather than left from the previous frame in the buffer, so
+    // that dumps of the same frames are identical
+    auto end = sizeof(record);
+    for (std::size_t i = 0; i < frame.plane_count; ++i) {
+      const auto& plane = frame.planes.at(i);
+      const auto& disk_plane = record.planes.at(i);
+      std::memset(bytes + end, 0, disk_plane.offset - end);
+      std::ranges::copy(plane.data, bytes + disk_plane.offset);
+      end = disk_plane.offset + disk_plane.size;
+    }
+    std::memset(bytes + end, 0, record.record_size - end);
+    staging->size = record.record_size;
+    staging->timestamp_ns = record.timestamp_ns;
+  }
+
+  {
+    const auto lock = std::scoped_lock(impl_->mutex);
+    impl_->pending.push_back(staging);
+  }
+  impl_->ready.notify_one();
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpWriter::stats() const -> Stats {
+  return { .written = impl_->written_count.load(std::memory_order_relaxed),
+           .dropped = impl_->dropped_count.load(std::memory_order_relaxed),
+           .bytes = impl_->byte_count.load(std::memory_order_relaxed),
+           .copy_time = impl_->copy_time.snapshot(),
+           .batch_time = impl_->batch_time.snapshot() };
+}
+
+//=================================================================================================
+struct FrameDumpReader::Impl {
+  Config config;
+  Camera::Callback callback;
+  std::byte* mapping{ nullptr };
+  std::size_t mapping_size{ 0 };
+  std::vector<ImageFrame> frames;
+
+  // Replay position, and the time the first frame was delivered at for realtime pacing
+  std::size_t next_frame{ 0 };
+  std::chrono::steady_clock::time_point replay_start;
+
+  void map(const std::string& path);
+  [[nodiscard]] auto readIndex() const -> std::vector<IndexEntry>;
+  [[nodiscard]] auto scanRecords() const -> std::vector<IndexEntry>;
+  void addFrame(const IndexEntry& entry);
+
+  template <typename T>
+  [[nodiscard]] auto read(std::size_t offset) const -> T {
+    auto value = T{};
+    std::memcpy(&value, mapping + offset, sizeof(T));
+    return value;
+  }
+};
+
+//-------------------------------------------------------------------------------------------------
+void FrameDumpReader::Impl::map(const std::string& path) {
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);  // NOLINT(*-vararg)
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open dump file " + path);
+  }
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error("Failed to read dump file " + path);
+  }
+  mapping_size = static_cast<std::size_t>(info.st_size);
+  if (mapping_size < PAGE_BYTES) {
+    close(fd);
+    throw std::runtime_error("Not a frame dump: " + path);
+  }
+  // Private and writable, since frames describe mutable pixels. Nothing is written back
+  void* const data = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    mapping_size = 0;
+    throw std::runtime_error("Failed to map dump file " + path);
+  }
+  mapping = static_cast<std::byte*>(data);
+  madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+  const auto header = read<FileHeader>(0);
+  if ((header.magic != FILE_MAGIC) || (header.version != FORMAT_VERSION) ||
+      (header.page_size != PAGE_BYTES)) {
+    throw std::runtime_error("Not a frame dump, or from an incompatible version: " + path);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpReader::Impl::readIndex() const -> std::vector<IndexEntry> {
+  if (mapping_size < PAGE_BYTES + sizeof(Trailer)) {
+    return {};
+  }
+  const auto trailer_offset = mapping_size - sizeof(Trailer);
+  const auto trailer = read<Trailer>(trailer_offset);
+  if ((trailer.magic != TRAILER_MAGIC) || (trailer.version != FORMAT_VERSION) ||
+      (trailer.index_offset > trailer_offset) ||
+      (trailer.entry_count > (trailer_offset - trailer.index_offset) / sizeof(IndexEntry))) {
+    return {};
+  }
+  auto index = std::vector<IndexEntry>(trailer.entry_count);
+  std::memcpy(index.data(), mapping + trailer.index_offset, index.size() * sizeof(IndexEntry));
+  return index;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpReader::Impl::scanRecords() const -> std::vector<IndexEntry> {
+  // Records follow each other from the first page. Stops at the first incomplete one
+  auto index = std::vector<IndexEntry>{};
+  auto offset = PAGE_BYTES;
+  while (offset + sizeof(RecordHeader) <= mapping_size) {
+    const auto record = read<RecordHeader>(offset);
+    if ((record.magic != RECORD_MAGIC) || (record.record_size < sizeof(RecordHeader)) ||
+        (record.record_size > mapping_size - offset)) {
+      break;
+    }
+    index.push_back(
+        { .offset = offset, .size = record.record_size, .timestamp_ns = record.timestamp_ns });
+    offset += record.record_size;
+  }
+  return index;
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameDumpReader::Impl::addFrame(const IndexEntry& entry) {
+  const auto is_valid_span = [](std::uint64_t offset, std::uint64_t size, std::uint64_t limit) {
+    return (offset <= limit) && (size <= limit - offset);
+  };
+  if (not is_valid_span(entry.offset, entry.size, mapping_size) ||
+      (entry.size < sizeof(RecordHeader))) {
+    throw std::runtime_error("Frame dump index is corrupt");
+  }
+  const auto record = read<RecordHeader>(entry.offset);
+  if ((record.magic != RECORD_MAGIC) || (record.record_size != entry.size) ||
+      (record.plane_count == 0) || (record.plane_count > ImageFrame::MAX_PLANES)) {
+    throw std::runtime_error("Frame dump record is corrupt");
+  }
+  auto frame = ImageFrame{ .header = toHeader(record), .planes = {}, .plane_count = 0 };
+  for (std::size_t i = 0; i < record.plane_count; ++i) {
+    const auto& plane = record.planes.at(i);
+    if (not is_valid_span(plane.offset, plane.size, record.record_size)) {
+      throw std::runtime_error("Frame dump record is corrupt");
+    }
+    frame.planes.at(i) = { .data = std::span(mapping + entry.offset + plane.offset, plane.size),
+                           .stride = plane.stride,
+                           .fd = -1,
+                           .offset = 0 };
+  }
+  frame.plane_count = record.plane_count;
+  frames.push_back(frame);
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameDumpReader::FrameDumpReader(const Config& config, Camera::Callback&& image_callback)
+  : impl_(std::make_unique<Impl>()) {
+  impl_->config = config;
+  impl_->callback = std::move(image_callback);
+  try {
+    impl_->map(config.path);
+    auto index = impl_->readIndex();
+    if (index.empty()) {
+      // No index: the writer did not finish (e.g. the process was killed)
+      index = impl_->scanRecords();
+    }
+    impl_->frames.reserve(index.size());
+    for (const auto& entry : index) {
+      impl_->addFrame(entry);
+    }
+  } catch (...) {
+    if (impl_->mapping != nullptr) {
+      munmap(impl_->mapping, impl_->mapping_size);
+    }
+    throw;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameDumpReader::~FrameDumpReader() {
+  munmap(impl_->mapping, impl_->mapping_size);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpReader::acquire() -> bool {
+  auto& frames = impl_->frames;
+  if (impl_->next_frame >= frames.size()) {
+    if (not impl_->config.loop || frames.empty()) {
+      return false;
+    }
+    impl_->next_frame = 0;
+  }
+  const auto& frame = frames.at(impl_->next_frame);
+  if (impl_->config.realtime) {
+    const auto now = std::chrono::steady_clock::now();
+    if (impl_->next_frame == 0) {
+      impl_->replay_start = now;
+    }
+    const auto due = impl_->replay_start + (frame.header.timestamp - frames[0].header.timestamp);
+    std::this_thread::sleep_until(due);
+  }
+  ++impl_->next_frame;
+  if (impl_->callback) {
+    impl_->callback(frame);
+  }
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpReader::size() const -> std::size_t {
+  return impl_->frames.size();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto FrameDumpReader::frame(std::size_t index) const -> const ImageFrame& {
+  return impl_->frames.at(index);
+}
+
+}  // namespace picam
+
+// NOLINTEND(*-pointer-arithmetic,*-reinterpret-cast)
@@ -0,0 +1,125 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "camera.h"
+#include "image_frame.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Writes frames exactly as delivered by the camera (header, capture metadata and planes with their
+/// row padding) to a dump file, for replay with FrameDumpReader.
+///
+/// File layout, with all sections page-aligned so that records can be written with O_DIRECT and
+/// mapped for reading:
+/// - file header page: magic and version
+/// - one record per frame: a fixed-size record header followed by the planes, each starting on a
+///   64-byte boundary, padded to whole pages
+/// - index: offset, size and timestamp of every record, ending with a trailer in the last bytes of
+///   the file. Written on destruction; a file without one (e.g. after a crash) is recovered by
+///   scanning the records
+///
+/// Frames are copied into page-aligned staging buffers on the calling thread, and a writer thread
+/// writes pending buffers in one batch (pwritev), bypassing the page cache where the file system
+/// supports O_DIRECT. The caller never waits for the disk: frames are dropped when all staging
+/// buffers are in flight
+class FrameDumpWriter {
+public:
+  struct Config {
+    /// Output file. Truncated when the writer is created
+    std::string path;
+
+    /// Frames that can wait for the disk. Each holds a copy of one frame
+    std::uint32_t buffer_count{ 8 };
+  };
+
+  /// Writer instrumentation. Always on; counters are updated with relaxed atomics
+  struct Stats {
+    std::uint64_t written{};   //!< Frames written to the file
+    std::uint64_t dropped{};   //!< Frames not written because all staging buffers were in use
+    std::uint64_t bytes{};     //!< Bytes written, padding included
+    DurationStats copy_time;   //!< Copy of a frame into a staging buffer, on the calling thread
+    DurationStats batch_time;  //!< Write of a batch of records by the writer thread
+  };
+
+  /// Open the output file and start the writer thread
+  /// @param config Writer configuration
+  explicit FrameDumpWriter(const Config& config);
+
+  /// Queue a copy of a frame for writing without blocking. Needs CPU access to the pixels
+  /// @param frame Frame to write, e.g. from a Camera::Callback
+  /// @return false if the frame was dropped because all staging buffers are in use
+  auto write(const ImageFrame& frame) -> bool;
+
+  /// @return Snapshot of writer statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  /// Writes queued frames and the index
+  ~FrameDumpWriter();
+  FrameDumpWriter(const FrameDumpWriter&) = delete;
+  FrameDumpWriter(FrameDumpWriter&&) = delete;
+  auto operator=(const FrameDumpWriter&) = delete;
+  auto operator=(FrameDumpWriter&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+//=================================================================================================
+/// Replays a file written by FrameDumpWriter through the Camera::Callback interface, so consumers
+/// (display, conversion, benchmarks) run from recordings on machines without a camera. The file is
+/// memory-mapped and frames point into the mapping, so replay does not copy pixels.
+///
+/// Replayed frames have no dmabufs (plane descriptors are -1) and keep their recorded timestamps
+class FrameDumpReader {
+public:
+  struct Config {
+    /// Dump file to replay
+    std::string path;
+
+    /// Deliver frames at the pace they were captured at, from their sensor timestamps. If false,
+    /// frames are delivered as fast as they are acquired
+    bool realtime{ false };
+
+    /// Start again from the first frame after the last one
+    bool loop{ false };
+  };
+
+  /// Map the file and read its index. Throws std::runtime_error if it is not a valid dump
+  /// @param config Reader configuration
+  /// @param image_callback Callback triggered with each replayed frame
+  FrameDumpReader(const Config& config, Camera::Callback&& image_callback);
+
+  /// Trigger the callback with the next frame. With Config::realtime, first waits until the
+  /// frame is due. The frame is only valid inside the callback
+  /// @return false once all frames were delivered (never with Config::loop)
+  auto acquire() -> bool;
+
+  /// @return Number of frames in the file
+  [[nodiscard]] auto size() const -> std::size_t;
+
+  /// @param index Index of the frame in the file
+  /// @return The frame, valid for the lifetime of the reader
+  [[nodiscard]] auto frame(std::size_t index) const -> const ImageFrame&;
+
+  ~FrameDumpReader();
+  FrameDumpReader(const FrameDumpReader&) = delete;
+  FrameDumpReader(FrameDumpReader&&) = delete;
+  auto operator=(const FrameDumpReader&) = delete;
+  auto operator=(FrameDumpReader&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
@@ -0,0 +1,82 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+
+#include "image_frame.h"
+
+namespace picam {
+
+class Camera;
+
+//=================================================================================================
+/// Reference to a capture that keeps its buffers out of the capture queue. A capture holds one
+/// frame per configured stream. Buffers are handed back to the camera when the last reference is
+/// released, so the frames' pixels and dmabufs stay valid for as long as any handle exists.
+///
+/// Handles are move-only; use clone() to share a frame between consumers (e.g. an encoder and a
+/// network sender) without copying pixels. Handles may be cloned and released from any thread,
+/// but must all be released before the Camera that produced them is destroyed.
+///
+/// Buffers held by handles are unavailable for capture. Hold them only as long as needed, or the
+/// camera runs out of buffers and drops frames.
+class FrameHandle {
+public:
+  /// Create an empty handle
+  FrameHandle() = default;
+
+  /// @return true if the handle references a frame
+  [[nodiscard]] explicit operator bool() const noexcept;
+
+  /// @return Number of frames (one per stream) in the capture. 0 for an empty handle
+  [[nodiscard]] auto frameCount() const noexcept -> std::size_t;
+
+  /// @param stream Index of the stream in Camera::Config::streams
+  /// @return Frame of the specified stream. Must not be called on an empty handle
+  [[nodiscard]] auto frame(std::size_t stream) const -> const ImageFrame&;
+
+  /// @return Frame of the first stream. Must not be called on an empty handle
+  [[nodiscard]] auto frame() const -> const ImageFrame&;
+  [[nodiscard]] auto operator*() const -> const ImageFrame&;
+  [[nodiscard]] auto operator->() const -> const ImageFrame*;
+
+  /// Frames returned by the accessors above always carry dmabuf descriptors of their planes, but
+  /// plane data spans are only set once the CPU may read them: immediately with
+  /// Camera::MappingPolicy::Eager, and after mapped() with Lazy. This call maps the buffer on
+  /// first use and synchronises CPU caches with the device (DMA_BUF_IOCTL_SYNC) until the last
+  /// reference is released. Throws std::logic_error with MappingPolicy::Never
+  /// @param stream Index of the stream in Camera::Config::streams
+  /// @return Frame of the specified stream, with CPU access to its pixels
+  [[nodiscard]] auto mapped(std::size_t stream = 0) const -> const ImageFrame&;
+
+  /// Attach analysis results to the header of a frame (see FrameAnalyzer). Only through the
+  /// only handle to the capture, typically straight after Camera::acquireFrame(), so that no
+  /// other consumer reads the header meanwhile. Throws std::logic_error otherwise. Must not be
+  /// called on an empty handle
+  /// @param stream Index of the stream in Camera::Config::streams
+  /// @param statistics Statistics of the frame
+  void setStatistics(std::size_t stream, const FrameStatistics& statistics);
+
+  /// @return A new reference to the same frame, or an empty handle if this one is empty
+  [[nodiscard]] auto clone() const -> FrameHandle;
+
+  /// Drop the reference, returning the buffer to the camera if it was the last one
+  void reset() noexcept;
+
+  ~FrameHandle();
+  FrameHandle(const FrameHandle&) = delete;
+  FrameHandle(FrameHandle&& other) noexcept;
+  auto operator=(const FrameHandle&) = delete;
+  auto operator=(FrameHandle&& other) noexcept -> FrameHandle&;
+
+private:
+  friend class Camera;
+  struct Slot;  // Per capture buffer state, owned by the camera
+  explicit FrameHandle(Slot* slot) noexcept;
+  Slot* slot_{ nullptr };
+};
+
+}  // namespace picam
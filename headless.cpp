@@ -0,0 +1,247 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "headless.h"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace picam {
+
+namespace {
+
+//=================================================================================================
+// Output file of a raw file sink, shared by the copies of the sink
+class RawFile {
+public:
+  explicit RawFile(const std::string& path)
+    : fd_(open(path.c_str(),  // NOLINT(*-vararg)
+               O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, FILE_MODE)) {
+    if (fd_ < 0) {
+      throw std::runtime_error("Failed to open output file " + path);
+    }
+  }
+
+  void write(std::span<const std::byte> bytes) {
+    while (not bytes.empty() && not failed_) {
+      const auto ret = ::write(fd_, bytes.data(), bytes.size());
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::println(stderr, "Warning: Writing raw frames failed, discarding further output: {}",
+                     std::strerror(errno));
+        failed_ = true;
+        break;
+      }
+      bytes = bytes.subspan(static_cast<std::size_t>(ret));
+    }
+  }
+
+  ~RawFile() {
+    close(fd_);
+  }
+  RawFile(const RawFile&) = delete;
+  RawFile(RawFile&&) = delete;
+  auto operator=(const RawFile&) = delete;
+  auto operator=(RawFile&&) = delete;
+
+private:
+  static constexpr auto FILE_MODE = 0644;
+  int fd_{ -1 };
+  bool failed_{ false };
+};
+
+}  // namespace
+
+//-------------------------------------------------------------------------------------------------
+auto nullSink() -> Sink {
+  return [](const FrameHandle& /*capture*/) {};
+}
+
+//-------------------------------------------------------------------------------------------------
+auto rawFileSink(const std::string& path, std::size_t stream) -> Sink {
+  auto file = std::make_shared<RawFile>(path);
+  return [file = std::move(file), stream](const FrameHandle& capture) {
+    const auto& frame = capture.mapped(stream);
+    for (std::size_t i = 0; i < frame.plane_count; ++i) {
+      file->write(std::as_bytes(frame.planes.at(i).data));
+    }
+  };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto frameDumpSink(FrameDumpWriter& writer, std::size_t stream) -> Sink {
+  return [&writer, stream](const FrameHandle& capture) { writer.write(capture.mapped(stream)); };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto frameBusSink(FrameBusServer& bus, std::size_t stream) -> Sink {
+  return [&bus, stream](const FrameHandle& capture) { bus.publish(capture, stream); };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto recorderSink(Recorder& recorder, std::size_t stream) -> Sink {
+  return [&recorder, stream](const FrameHandle& capture) {
+    recorder.encode(capture.clone(), stream);
+  };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto rtpStream(RtpSender& sender) -> Recorder::EncodedCallback {
+  return [&sender](std::span<const std::byte> access_unit, SensorClock::time_point timestamp,
+                   bool /*key_frame*/) { sender.send(access_unit, timestamp); };
+}
+
+//-------------------------------------------------------------------------------------------------
+auto interestingOnly(Sink&& sink, std::size_t stream) -> Sink {
+  return [sink = std::move(sink), stream](const FrameHandle& capture) {
+    if (capture.frame(stream).header.statistics.interesting) {
+      sink(capture);
+    }
+  };
+}
+
+//-------------------------------------------------------------------------------------------------
+struct HeadlessRunner::Impl {
+  Camera* camera{ nullptr };
+  ThreadConfig consumer_thread;
+  std::uint64_t capture_limit{ 0 };
+  std::unique_ptr<EglContext> gl_context;
+  std::unique_ptr<FrameAnalyzer> analyzer;
+  std::size_t analysis_stream{ 0 };
+  std::vector<Sink> sinks;
+
+  // Written by stop() to wake the consumer. Writing an eventfd is async-signal-safe
+  int stop_fd{ -1 };
+  std::atomic_bool stop_requested{ false };
+
+  // Instrumentation
+  std::atomic_uint64_t consumed_count{ 0 };
+  std::atomic_uint64_t interesting_count{ 0 };
+  DurationHistogram analysis_time;
+  DurationHistogram sink_time;
+  DurationHistogram latency;
+
+  void consume(FrameHandle& capture);
+};
+
+//-------------------------------------------------------------------------------------------------
+void HeadlessRunner::Impl::consume(FrameHandle& capture) {
+  // Before any sink clones the handle, since statistics are set through the only reference
+  if (analyzer) {
+    auto statistics = FrameStatistics{};
+    {
+      const auto timer = ScopedTimer(analysis_time);
+      statistics = analyzer->analyze(capture.mapped(analysis_stream));
+    }
+    capture.setStatistics(analysis_stream, statistics);
+    if (statistics.interesting) {
+      interesting_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& sink : sinks) {
+    sink(capture);
+  }
+  sink_time.record(std::chrono::steady_clock::now() - start);
+  latency.record(SensorClock::now() - capture->header.timestamp);
+  consumed_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+HeadlessRunner::HeadlessRunner(Camera& camera, const Config& config)
+  : impl_(std::make_unique<Impl>()) {
+  impl_->camera = &camera;
+  impl_->consumer_thread = config.consumer_thread;
+  impl_->capture_limit = config.capture_limit;
+  if (config.gl_context) {
+    impl_->gl_context = std::make_unique<EglContext>();
+  }
+  if (config.analysis) {
+    impl_->analyzer = std::make_unique<FrameAnalyzer>(*config.analysis);
+    impl_->analysis_stream = config.analysis_stream;
+  }
+  impl_->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (impl_->stop_fd < 0) {
+    throw std::runtime_error("Failed to create stop notification eventfd");
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+HeadlessRunner::~HeadlessRunner() {
+  close(impl_->stop_fd);
+}
+
+//-------------------------------------------------------------------------------------------------
+void HeadlessRunner::addSink(Sink&& sink) {
+  impl_->sinks.push_back(std::move(sink));
+}
+
+//-------------------------------------------------------------------------------------------------
+auto HeadlessRunner::glContext() -> EglContext* {
+  return impl_->gl_context.get();
+}
+
+//-------------------------------------------------------------------------------------------------
+void HeadlessRunner::run() {
+  // The consumer thread is usually the main thread, whose name is the process name. Keep it
+  configureCurrentThread(impl_->consumer_thread, "");
+
+  const auto camera_fd = impl_->camera->eventFd();
+  auto poll_fds = std::array{ pollfd{ .fd = camera_fd, .events = POLLIN, .revents = 0 },
+                              pollfd{ .fd = impl_->stop_fd, .events = POLLIN, .revents = 0 } };
+  const auto is_done = [this] {
+    const auto limit = impl_->capture_limit;
+    return impl_->stop_requested.load(std::memory_order_acquire) ||
+           ((limit > 0) && (impl_->consumed_count.load(std::memory_order_relaxed) >= limit));
+  };
+  while (not is_done()) {
+    // Drain before sleeping: the event is cleared when the last pending capture is taken
+    if (auto capture = impl_->camera->acquireFrame()) {
+      impl_->consume(capture);
+      continue;
+    }
+    if ((poll(poll_fds.data(), poll_fds.size(), -1) < 0) && (errno != EINTR)) {
+      throw std::runtime_error("Failed to wait for camera frames");
+    }
+  }
+
+  // Rearm for the next run()
+  auto count = std::uint64_t{ 0 };
+  (void)read(impl_->stop_fd, &count, sizeof(count));
+  impl_->stop_requested.store(false, std::memory_order_release);
+}
+
+//-------------------------------------------------------------------------------------------------
+void HeadlessRunner::stop() {
+  impl_->stop_requested.store(true, std::memory_order_release);
+  const auto count = std::uint64_t{ 1 };
+  (void)write(impl_->stop_fd, &count, sizeof(count));
+}
+
+//-------------------------------------------------------------------------------------------------
+auto HeadlessRunner::stats() const -> Stats {
+  return { .consumed = impl_->consumed_count.load(std::memory_order_relaxed),
+           .interesting = impl_->interesting_count.load(std::memory_order_relaxed),
+           .analysis_time = impl_->analysis_time.snapshot(),
+           .sink_time = impl_->sink_time.snapshot(),
+           .latency = impl_->latency.snapshot() };
+}
+
+}  // namespace picam
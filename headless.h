@@ -0,0 +1,129 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "camera.h"
+#include "egl_context.h"
+#include "frame_analysis.h"
+#include "frame_bus.h"
+#include "frame_dump.h"
+#include "frame_handle.h"
+#include "recorder.h"
+#include "rtp_sender.h"
+#include "stats.h"
+#include "thread_config.h"
+
+namespace picam {
+
+/// Consumer of captures in a HeadlessRunner, called on the runner thread. The capture is only
+/// referenced during the call; clone the handle to hold on to it
+using Sink = std::function<void(const FrameHandle& capture)>;
+
+/// @return Sink that discards captures, to measure capture throughput and latency on their own
+[[nodiscard]] auto nullSink() -> Sink;
+
+/// Sink writing the planes of each frame to a file, back to back and as stored (row padding
+/// included). Writes are synchronous on the runner thread. Needs CPU access to capture buffers
+/// @param path Output file, truncated when the sink is created
+/// @param stream Index of the stream to write, in Camera::Config::streams
+[[nodiscard]] auto rawFileSink(const std::string& path, std::size_t stream = 0) -> Sink;
+
+/// @return Sink writing frames to a dump file for replay (see FrameDumpWriter). The writer must
+/// outlive the runner
+[[nodiscard]] auto frameDumpSink(FrameDumpWriter& writer, std::size_t stream = 0) -> Sink;
+
+/// @return Sink sharing captures with other processes. The server must outlive the runner
+[[nodiscard]] auto frameBusSink(FrameBusServer& bus, std::size_t stream = 0) -> Sink;
+
+/// @return Sink queueing captures for encoding without copying pixels. Encoded frames can be
+/// streamed with RtpSender from Recorder::Config::on_encoded. The recorder must outlive the runner
+[[nodiscard]] auto recorderSink(Recorder& recorder, std::size_t stream = 0) -> Sink;
+
+/// @return Recorder::Config::on_encoded callback streaming encoded frames over the network with
+/// the sender, whose payload must match the recorder's codec. The sender must outlive the recorder
+[[nodiscard]] auto rtpStream(RtpSender& sender) -> Recorder::EncodedCallback;
+
+/// Wrap a sink so that it only receives captures whose frame of 'stream' was marked interesting
+/// by the runner's analysis (see HeadlessRunner::Config::analysis), e.g. to record or stream only
+/// frames with motion
+[[nodiscard]] auto interestingOnly(Sink&& sink, std::size_t stream = 0) -> Sink;
+
+//=================================================================================================
+/// Consumer loop for nodes without a display. Waits on the camera's event descriptor and hands
+/// every capture to the sinks in turn, on the thread calling run(). Nothing here needs a window
+/// system; an offscreen GL context is created on request for sinks that process frames on the
+/// GPU.
+///
+/// The camera must outlive the runner, and any sink that holds captures (e.g. a Recorder) must be
+/// destroyed before the camera
+class HeadlessRunner {
+public:
+  struct Config {
+    /// Placement and scheduling of the consumer thread (applied to the caller of run())
+    ThreadConfig consumer_thread{};
+
+    /// Create an offscreen OpenGL ES context (see EglContext), current on the constructing
+    /// thread. run() must then be called on that thread
+    bool gl_context{ false };
+
+    /// Stop after this many captures. 0 runs until stop() is called
+    std::uint64_t capture_limit{ 0 };
+
+    /// Analyse a stream of every capture before the sinks run (see FrameAnalyzer), attaching the
+    /// statistics to the header of its frame. The stream needs CPU access to its pixels and a YUV
+    /// or RGB888 format. Unset disables analysis
+    std::optional<FrameAnalyzer::Config> analysis{};
+
+    /// Index of the stream to analyse, in Camera::Config::streams
+    std::size_t analysis_stream{ 0 };
+  };
+
+  /// Consumer instrumentation. Always on; durations are recorded with relaxed atomics
+  struct Stats {
+    std::uint64_t consumed{};     //!< Captures handed to the sinks
+    std::uint64_t interesting{};  //!< Captures the analysis marked interesting
+    DurationStats analysis_time;  //!< Frame analysis, per capture
+    DurationStats sink_time;      //!< Time in all sinks, per capture
+    DurationStats latency;        //!< Sensor start of exposure to the sinks being done
+  };
+
+  /// @param camera Camera to consume captures from. Its callbacks are not used
+  /// @param config Runner configuration
+  HeadlessRunner(Camera& camera, const Config& config);
+
+  /// Add a sink, called after those added before it. Not while run() is running
+  void addSink(Sink&& sink);
+
+  /// @return Offscreen GL context, or nullptr unless Config::gl_context is set
+  [[nodiscard]] auto glContext() -> EglContext*;
+
+  /// Hand captures to the sinks until stop() is called or the capture limit is reached
+  void run();
+
+  /// Request run() to return. Safe to call from any thread and from signal handlers
+  void stop();
+
+  /// @return Snapshot of consumer statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  ~HeadlessRunner();
+  HeadlessRunner(const HeadlessRunner&) = delete;
+  HeadlessRunner(HeadlessRunner&&) = delete;
+  auto operator=(const HeadlessRunner&) = delete;
+  auto operator=(HeadlessRunner&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
@@ -0,0 +1,195 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+// Camera consumer for nodes without a display. Captures go to the sinks selected on the command
+// line, or are discarded to measure capture throughput: raw or dump files, an encoded recording,
+// RTP streaming over the network (--stream) and the local frame bus. With --analyze, only frames
+// with motion are recorded, streamed and served. Stops after --frames captures or on
+// SIGINT/SIGTERM, and prints capture and consumer statistics
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <libcamera/formats.h>
+
+#include "camera.h"
+#include "frame_bus.h"
+#include "frame_dump.h"
+#include "headless.h"
+#include "recorder.h"
+#include "rtp_sender.h"
+
+namespace {
+
+picam::HeadlessRunner* active_runner = nullptr;  // NOLINT(*-avoid-non-const-global-variables)
+
+//-------------------------------------------------------------------------------------------------
+void onSignal(int /*signal*/) {
+  if (active_runner != nullptr) {
+    active_runner->stop();
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+/// @return Streaming destination from "host:port". IPv6 addresses are given in brackets
+auto parseDestination(std::string_view destination) -> picam::RtpSender::Config {
+  const auto separator = destination.rfind(':');
+  if ((separator == std::string_view::npos) || (separator + 1 == destination.size())) {
+    throw std::invalid_argument(std::format("Expected host:port, got '{}'", destination));
+  }
+  auto host = destination.substr(0, separator);
+  if (host.starts_with('[') && host.ends_with(']')) {
+    host = host.substr(1, host.size() - 2);
+  }
+  auto config = picam::RtpSender::Config{};
+  config.host = host;
+  const auto port = std::stoul(std::string(destination.substr(separator + 1)));
+  if (port > UINT16_MAX) {
+    throw std::invalid_argument(std::format("Invalid port in '{}'", destination));
+  }
+  config.port = static_cast<std::uint16_t>(port);
+  return config;
+}
+
+//-------------------------------------------------------------------------------------------------
+void printStats(std::string_view label, const picam::DurationStats& stats) {
+  const auto to_ms = [](std::chrono::nanoseconds ns) {
+    return static_cast<double>(ns.count()) / 1e6;
+  };
+  std::println("{:<28} n={:<6} mean={:8.3f} ms  p99<={:8.3f} ms  max={:8.3f} ms", label,
+               stats.count, to_ms(stats.mean()), to_ms(stats.percentile(0.99)), to_ms(stats.max));
+}
+
+}  // namespace
+
+//-------------------------------------------------------------------------------------------------
+auto main(int argc, char* argv[]) -> int {
+  auto runner_config = picam::HeadlessRunner::Config{};
+  auto raw_path = std::optional<std::string>{};
+  auto dump_path = std::optional<std::string>{};
+  auto record_path = std::optional<std::string>{};
+  auto rtp_config = std::optional<picam::RtpSender::Config>{};
+  auto bus_config = std::optional<picam::FrameBusServer::Config>{};
+  const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto arg = std::string_view(args[i]);
+    const auto has_value =
+        (i + 1 < args.size()) && not std::string_view(args[i + 1]).starts_with("--");
+    if ((arg == "--frames") && has_value) {
+      runner_config.capture_limit = std::stoull(args[++i]);
+    } else if ((arg == "--raw") && has_value) {
+      raw_path = args[++i];
+    } else if ((arg == "--dump") && has_value) {
+      dump_path = args[++i];
+    } else if ((arg == "--record") && has_value) {
+      record_path = args[++i];
+    } else if ((arg == "--stream") && has_value) {
+      rtp_config = parseDestination(args[++i]);
+    } else if (arg == "--serve") {
+      bus_config.emplace();
+      if (has_value) {
+        bus_config->socket_path = args[++i];
+      }
+    } else if (arg == "--gl") {
+      runner_config.gl_context = true;
+    } else if (arg == "--analyze") {
+      runner_config.analysis.emplace();
+    } else {
+      std::println(stderr, "Usage: picam_headless [--frames N] [--raw <file>] [--dump <file>] "
+                           "[--record <file>] [--stream <host:port>] [--serve [socket path]] "
+                           "[--gl] [--analyze]");
+      return 1;
+    }
+  }
+
+  auto camera_config = picam::Camera::Config{ .camera_name_hint = "imx",
+                                              .image_size = { .width = 1280, .height = 720 } };
+  const auto encode = record_path || rtp_config;
+  if (encode) {
+    // The encoder takes planar YUV
+    camera_config.streams = { { .role = picam::Camera::StreamRole::VideoRecording,
+                                .image_size = camera_config.image_size,
+                                .crop = std::nullopt,
+                                .pixel_format = libcamera::formats::YUV420.fourcc(),
+                                .callback = nullptr } };
+  }
+  auto camera = picam::Camera(camera_config, picam::Camera::Callback{});
+
+  // Declared after the camera, so that frames held by them are released first
+  auto bus = std::optional<picam::FrameBusServer>{};
+  auto dump = std::optional<picam::FrameDumpWriter>{};
+  auto rtp = std::optional<picam::RtpSender>{};  // Before the recorder, which sends through it
+  auto recorder = std::optional<picam::Recorder>{};
+  auto runner = picam::HeadlessRunner(camera, runner_config);
+  if (runner.glContext() != nullptr) {
+    std::println("Offscreen GL context available to sinks");
+  }
+  // Recording, streaming and serving only get the frames the analysis selects, if enabled
+  const auto selected = [&runner_config](picam::Sink&& sink) {
+    return runner_config.analysis ? picam::interestingOnly(std::move(sink)) : std::move(sink);
+  };
+  if (raw_path) {
+    runner.addSink(picam::rawFileSink(*raw_path));
+  }
+  if (dump_path) {
+    dump.emplace(picam::FrameDumpWriter::Config{ .path = *dump_path });
+    runner.addSink(picam::frameDumpSink(*dump));
+  }
+  if (bus_config) {
+    bus.emplace(*bus_config);
+    runner.addSink(selected(picam::frameBusSink(*bus)));
+    std::println("Serving frames on {}", bus_config->socket_path);
+  }
+  if (encode) {
+    auto recorder_config = picam::Recorder::Config{};
+    recorder_config.output_path = record_path.value_or(std::string{});
+    if (rtp_config) {
+      rtp.emplace(*rtp_config);
+      recorder_config.on_encoded = picam::rtpStream(*rtp);
+      std::println("Streaming RTP to {}:{}", rtp_config->host, rtp_config->port);
+    }
+    recorder.emplace(recorder_config);
+    runner.addSink(selected(picam::recorderSink(*recorder)));
+  }
+
+  active_runner = &runner;
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  runner.run();
+  active_runner = nullptr;
+
+  const auto camera_stats = camera.stats();
+  const auto runner_stats = runner.stats();
+  std::println("consumed {} captures at {:.2f} fps, discarded {}, missed {}",
+               runner_stats.consumed, camera_stats.frameRate(), camera_stats.drops.discarded,
+               camera_stats.drops.missed);
+  printStats("completion -> acquire", camera_stats.handover_latency);
+  if (runner_config.analysis) {
+    std::println("{} captures selected by analysis", runner_stats.interesting);
+    printStats("analysis", runner_stats.analysis_time);
+  }
+  printStats("sinks", runner_stats.sink_time);
+  printStats("exposure start -> sinks done", runner_stats.latency);
+  if (dump) {
+    const auto dump_stats = dump->stats();
+    std::println("dumped {} frames ({} MB), dropped {}", dump_stats.written,
+                 dump_stats.bytes / 1'000'000, dump_stats.dropped);
+  }
+  if (rtp) {
+    const auto rtp_stats = rtp->stats();
+    std::println("streamed {} frames in {} packets ({} MB), {} send errors", rtp_stats.frames,
+                 rtp_stats.packets, rtp_stats.bytes / 1'000'000, rtp_stats.send_errors);
+    printStats("rtp send", rtp_stats.send_time);
+  }
+  return 0;
+}
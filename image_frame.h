@@ -4,13 +4,41 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <ctime>
 #include <span>
 #include <tuple>
 
 namespace picam {
 
+//=================================================================================================
+/// Clock of sensor timestamps reported by libcamera (CLOCK_BOOTTIME). Monotonic like
+/// std::chrono::steady_clock, but keeps counting while the system is suspended
+struct SensorClock {
+  using rep = std::int64_t;
+  using period = std::nano;
+  using duration = std::chrono::nanoseconds;
+  using time_point = std::chrono::time_point<SensorClock>;
+  static constexpr bool is_steady = true;
+
+  static auto now() noexcept -> time_point {
+    auto ts = timespec{};
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return time_point{ std::chrono::seconds{ ts.tv_sec } + std::chrono::nanoseconds{ ts.tv_nsec } };
+  }
+
+  /// Convert to wall-clock time using the current offset between the clocks. Accuracy is limited
+  /// by wall-clock adjustments (NTP steps) made since the time point was taken
+  static auto toSystemTime(time_point tp) -> std::chrono::system_clock::time_point {
+    const auto age = now() - tp;
+    return std::chrono::system_clock::now() -
+           std::chrono::duration_cast<std::chrono::system_clock::duration>(age);
+  }
+};
+
 //=================================================================================================
 /// Image dimensions in pixels
 struct ImageSize {
@@ -19,22 +47,93 @@ struct ImageSize {
   constexpr auto operator<=>(const ImageSize&) const = default;
 };
 
+//=================================================================================================
+/// Rectangular region of an image or sensor, in pixels
+struct ImageRect {
+  std::uint16_t x{};       //!< Left edge
+  std::uint16_t y{};       //!< Top edge
+  std::uint16_t width{};   //!< Width of the region
+  std::uint16_t height{};  //!< Height of the region
+  constexpr auto operator<=>(const ImageRect&) const = default;
+};
+
+//=================================================================================================
+/// YCbCr encoding of YUV pixel formats. Ignored for RGB formats
+struct ColorSpace {
+  enum class Encoding : std::uint8_t { Rec601, Rec709, Rec2020 };
+  enum class Range : std::uint8_t { Limited, Full };
+  Encoding encoding{ Encoding::Rec601 };  //!< Colour matrix
+  Range range{ Range::Limited };          //!< Quantisation range of the samples
+  constexpr auto operator<=>(const ColorSpace&) const = default;
+};
+
+//=================================================================================================
+/// Sensor and ISP settings a frame was captured with, as reported by the camera pipeline. Fields
+/// the pipeline does not report are zero
+struct CaptureMetadata {
+  std::chrono::microseconds exposure_time{};   //!< Exposure time of the frame
+  std::chrono::microseconds frame_duration{};  //!< Sensor frame period (inverse of frame rate)
+  float analogue_gain{};                       //!< Sensor analogue gain
+  float digital_gain{};                        //!< ISP digital gain
+  std::uint32_t colour_temperature{};          //!< White balance estimate in kelvin
+  float lux{};                                 //!< Scene illuminance estimate of the ISP
+  ImageRect scaler_crop{};                     //!< Sensor region scaled to the stream sizes
+
+  /// Id of the newest Camera::setControls() call queued with or before the request of this frame
+  /// (0 if none). Sensors apply settings a few frames later; compare exposure_time, analogue_gain
+  /// and frame_duration with the values requested to confirm they took effect
+  std::uint64_t controls_id{};
+};
+
+//=================================================================================================
+/// Luma statistics of a frame, computed by FrameAnalyzer from a subsampled grid of pixels. Luma
+/// is full range, whatever the quantisation range of the frame
+struct FrameStatistics {
+  static constexpr std::size_t HISTOGRAM_BINS = 32;
+
+  std::array<std::uint32_t, HISTOGRAM_BINS> histogram{};  //!< Samples per 8 levels of luma
+  std::uint32_t samples{};  //!< Pixels analysed. 0 if the frame was not analysed
+  float mean_luma{};        //!< Mean luma, in [0, 255]
+  float focus{};            //!< Mean squared luma gradient. Higher is sharper, for one scene
+  float motion{};           //!< Fraction of samples changed since the previous frame analysed
+  bool interesting{};       //!< Selected for recording and streaming by the analyzer triggers
+};
+
 //=================================================================================================
 /// Single image frame data
 struct ImageFrame {
   struct Header {
-    std::chrono::system_clock::time_point timestamp;  //!< Acquistion timestamp
-    std::uint32_t pitch{};                            //!< Bytes per row of pixels
-    ImageSize size;                                   //!< Image dimensions
-    std::uint32_t format{};                           //!< driver backend-specific pixel format
+    SensorClock::time_point timestamp;        //!< Sensor start-of-exposure time
+    SensorClock::time_point completion_time;  //!< Time the capture request completed
+    std::uint32_t sequence{};                 //!< Frame sequence number. Gaps are dropped frames
+    std::uint32_t stream_id{};                //!< Index of the stream in the camera config
+    std::uint32_t pitch{};                    //!< Bytes per row of pixels (first plane)
+    ImageSize size;                           //!< Image dimensions
+    std::uint32_t format{};                   //!< driver backend-specific pixel format
+    std::uint64_t format_modifier{};          //!< Layout of 'format', e.g. CSI-2 packing. 0: linear
+    ColorSpace color_space;                   //!< YCbCr encoding (YUV formats only)
+    CaptureMetadata metadata;                 //!< Capture settings reported by the camera
+    FrameStatistics statistics;               //!< Set by frame analysis, if enabled
   };
+  /// One plane of pixel data. Packed formats (RGB888, YUYV) have a single plane, NV12 has a luma
+  /// plane and an interleaved chroma plane, YUV420 has separate Y, U and V planes
+  struct Plane {
+    std::span<std::byte> data;  //!< pixel data of the plane
+    std::uint32_t stride{};     //!< Bytes per row of the plane
+    int fd{ -1 };               //!< dmabuf file descriptor (-1 if unavailable). May be shared
+    std::uint32_t offset{};     //!< Byte offset of the plane within the dmabuf
+  };
+  static constexpr std::size_t MAX_PLANES = 3;
+
   Header header;
-  std::span<std::byte> pixels;  //!< pixel data
+  std::array<Plane, MAX_PLANES> planes;  //!< Valid as long as the frame is
+  std::uint32_t plane_count{};           //!< Number of valid entries in 'planes'
 };
 
 /// @return true if image dimensions and format matches
 constexpr auto matchesFormat(const ImageFrame::Header& hd1, const ImageFrame::Header& hd2) -> bool {
-  return std::tie(hd1.size, hd1.format) == std::tie(hd2.size, hd2.format);
+  return std::tie(hd1.size, hd1.format, hd1.format_modifier) ==
+         std::tie(hd2.size, hd2.format, hd2.format_modifier);
 }
 
 }  // namespace picam
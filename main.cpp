@@ -1,7 +1,28 @@
+#include <optional>
+#include <print>
+#include <span>
+#include <string_view>
+
 #include "camera.h"
 #include "display.h"
+#include "frame_bus.h"
+
+auto main(int argc, char* argv[]) -> int {
+  // --serve [socket path]: also share frames with other processes over the frame bus
+  auto bus_config = std::optional<picam::FrameBusServer::Config>{};
+  const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    if (std::string_view(args[i]) == "--serve") {
+      bus_config.emplace();
+      if ((i + 1 < args.size()) && not std::string_view(args[i + 1]).starts_with("--")) {
+        bus_config->socket_path = args[++i];
+      }
+    } else {
+      std::println(stderr, "Usage: picam [--serve [socket path]]");
+      return 1;
+    }
+  }
 
-auto main() -> int {
   auto display = picam::Display();
 
   const auto config = picam::Camera::Config{ .camera_name_hint = "imx",
@@ -10,9 +31,28 @@ auto main() -> int {
   auto camera =
       picam::Camera(config, [&display](const picam::ImageFrame& frame) { display.update(frame); });
 
+  // Sleep until a frame arrives, but wake up regularly to keep the window responsive. Presenting
+  // waits for the display refresh, after which the newest frame is acquired
+  static constexpr auto FRAME_TIMEOUT = std::chrono::milliseconds(100);
+  if (not bus_config) {
+    while (display.processEvents()) {
+      camera.acquire(FRAME_TIMEOUT);
+      display.present();
+    }
+    return 0;
+  }
+
+  // Declared after the camera, so that frames held by clients are released first
+  auto bus = picam::FrameBusServer(*bus_config);
+  std::println("Serving frames on {}", bus_config->socket_path);
   while (display.processEvents()) {
-    camera.acquire();
+    const auto handle = camera.acquireFrame(FRAME_TIMEOUT);
+    if (handle) {
+      bus.publish(handle);
+      display.update(*handle);
+    }
+    display.present();
   }
 
   return 0;
-}
\ No newline at end of file
+}
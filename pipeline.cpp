@@ -0,0 +1,326 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "pipeline.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <libcamera/formats.h>
+
+#include "pixel_convert.h"
+
+namespace picam {
+
+namespace {
+
+// Longest a stage sleeps before checking for shutdown (and, on the render thread, window events)
+constexpr auto FRAME_TIMEOUT = std::chrono::milliseconds(100);
+
+//=================================================================================================
+// Frame converted to RGB888 by a worker, describing its own pixel buffer
+struct RgbFrame {
+  std::vector<std::uint8_t> pixels;
+  ImageFrame frame;
+};
+
+}  // namespace
+
+//=================================================================================================
+struct Pipeline::Impl {
+  // Result of a stage: a camera frame passed through as-is, or an RGB frame converted from one
+  struct Output {
+    FrameHandle handle;
+    RgbFrame* rgb{ nullptr };
+
+    [[nodiscard]] auto frame() const -> const ImageFrame& {
+      return (rgb != nullptr) ? rgb->frame : *handle;
+    }
+  };
+
+  explicit Impl(const Config& config);
+
+  // Declared first so that it outlives every frame handle held by the stages below
+  Camera camera;
+  Display display;
+
+  ThreadConfig capture_thread;
+  ThreadConfig worker_threads;
+  ThreadConfig render_thread;
+  std::uint32_t worker_count{};
+  std::atomic_bool running{ false };
+  std::vector<std::jthread> threads;
+
+  // Frames waiting for a conversion worker. Bounded to the number of workers, dropping the oldest
+  std::mutex work_mutex;
+  std::condition_variable work_ready;
+  std::deque<FrameHandle> work;
+
+  // Conversion outputs. One per worker, plus one waiting for display and one being displayed, so
+  // a worker always finds a free buffer. Allocated once; pixel buffers grow on first use
+  std::vector<RgbFrame> rgb_frames;
+  std::mutex rgb_mutex;
+  std::vector<RgbFrame*> free_rgb_frames;
+
+  // Mailbox holding the newest frame for the render thread
+  std::mutex output_mutex;
+  std::condition_variable output_ready;
+  std::optional<Output> latest_output;
+
+  // Instrumentation
+  DurationHistogram convert_time;
+  std::atomic_uint64_t dropped_count{ 0 };
+
+  void start();
+  void shutdown();
+  void captureLoop();
+  void workerLoop();
+  void submit(FrameHandle&& handle);
+  auto takeWork() -> FrameHandle;
+  void convert(FrameHandle&& handle, std::optional<PixelConverter>& converter);
+  void publish(Output&& output);
+  auto takeOutput() -> std::optional<Output>;
+  void recycle(Output& output);
+};
+
+//-------------------------------------------------------------------------------------------------
+Pipeline::Impl::Impl(const Config& config)
+  : camera(config.camera, [](const ImageFrame&) {})
+  , display(config.display)
+  , capture_thread(config.capture_thread)
+  , worker_threads(config.worker_threads)
+  , render_thread(config.render_thread)
+  , worker_count(config.worker_count)
+  , rgb_frames((config.worker_count > 0) ? config.worker_count + 2U : 0U) {
+  if ((worker_count > 0) && (config.camera.mapping_policy == Camera::MappingPolicy::Never)) {
+    throw std::invalid_argument("Conversion workers need CPU access to capture buffers");
+  }
+  free_rgb_frames.reserve(rgb_frames.size());
+  for (auto& rgb_frame : rgb_frames) {
+    free_rgb_frames.push_back(&rgb_frame);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::start() {
+  running.store(true, std::memory_order_release);
+  threads.reserve(worker_count + 1U);
+  threads.emplace_back([this] {
+    configureCurrentThread(capture_thread, "picam_capture");
+    captureLoop();
+  });
+  for (std::uint32_t i = 0; i < worker_count; ++i) {
+    threads.emplace_back([this, i] {
+      configureCurrentThread(worker_threads, std::format("picam_convert{}", i));
+      workerLoop();
+    });
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::shutdown() {
+  running.store(false, std::memory_order_release);
+  {
+    // Taking the locks orders the flag with the waits, so that no notification is lost
+    const auto work_lock = std::scoped_lock(work_mutex);
+    const auto output_lock = std::scoped_lock(output_mutex);
+  }
+  work_ready.notify_all();
+  output_ready.notify_all();
+  threads.clear();  // joins
+
+  // Return all buffers to the camera
+  work.clear();
+  if (latest_output) {
+    recycle(*latest_output);
+    latest_output.reset();
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::captureLoop() {
+  while (running.load(std::memory_order_acquire)) {
+    auto handle = camera.acquireFrame(FRAME_TIMEOUT);
+    if (not handle) {
+      continue;
+    }
+    if (worker_count == 0) {
+      publish(Output{ .handle = std::move(handle), .rgb = nullptr });
+    } else {
+      submit(std::move(handle));
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::submit(FrameHandle&& handle) {
+  auto dropped = FrameHandle{};  // released outside the lock
+  {
+    const auto lock = std::scoped_lock(work_mutex);
+    if (work.size() >= worker_count) {
+      dropped = std::move(work.front());
+      work.pop_front();
+      dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    work.push_back(std::move(handle));
+  }
+  work_ready.notify_one();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Pipeline::Impl::takeWork() -> FrameHandle {
+  auto lock = std::unique_lock(work_mutex);
+  work_ready.wait(lock, [this] {
+    return not work.empty() || not running.load(std::memory_order_acquire);
+  });
+  if (work.empty()) {
+    return {};
+  }
+  auto handle = std::move(work.front());
+  work.pop_front();
+  return handle;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::workerLoop() {
+  // Kernels of each worker, selected again only when the stream format changes
+  auto converter = std::optional<PixelConverter>{};
+  while (auto handle = takeWork()) {
+    convert(std::move(handle), converter);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::convert(FrameHandle&& handle, std::optional<PixelConverter>& converter) {
+  RgbFrame* rgb = nullptr;
+  {
+    const auto lock = std::scoped_lock(rgb_mutex);
+    rgb = free_rgb_frames.back();
+    free_rgb_frames.pop_back();
+  }
+
+  const auto& source = handle.mapped();
+  if (not converter || not converter->accepts(source.header)) {
+    converter.reset();
+    if (PixelConverter::supports(source.header)) {
+      converter.emplace(source.header, OutputFormat::Rgb888);
+    }
+  }
+
+  const auto width = static_cast<std::uint32_t>(source.header.size.width);
+  const auto height = static_cast<std::size_t>(source.header.size.height);
+  const auto pitch = width * 3U;
+  rgb->pixels.resize(pitch * height);
+  const auto converted = converter.has_value();
+  if (converted) {
+    const auto timer = ScopedTimer(convert_time);
+    converter->convert(source, rgb->pixels);
+  }
+
+  auto& frame = rgb->frame;
+  frame.header = source.header;
+  frame.header.pitch = pitch;
+  frame.header.format = libcamera::formats::RGB888;
+  frame.header.format_modifier = 0;
+  frame.planes[0] = {
+    .data = std::as_writable_bytes(std::span(rgb->pixels)), .stride = pitch, .fd = -1, .offset = 0
+  };
+  frame.plane_count = 1;
+  handle.reset();  // The camera can reuse the buffer while the frame waits for display
+
+  auto output = Output{ .handle = {}, .rgb = rgb };
+  if (not converted) {
+    recycle(output);
+    return;
+  }
+  publish(std::move(output));
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::publish(Output&& output) {
+  auto dropped = std::optional<Output>{};
+  {
+    const auto lock = std::scoped_lock(output_mutex);
+    // Workers may finish out of order. Never replace a frame with an older one
+    if (latest_output &&
+        (latest_output->frame().header.sequence > output.frame().header.sequence)) {
+      dropped = std::move(output);
+    } else {
+      dropped = std::exchange(latest_output, std::move(output));
+    }
+  }
+  if (dropped) {
+    dropped_count.fetch_add(1, std::memory_order_relaxed);
+    recycle(*dropped);
+  }
+  output_ready.notify_one();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Pipeline::Impl::takeOutput() -> std::optional<Output> {
+  auto lock = std::unique_lock(output_mutex);
+  output_ready.wait_for(lock, FRAME_TIMEOUT, [this] {
+    return latest_output.has_value() || not running.load(std::memory_order_acquire);
+  });
+  return std::exchange(latest_output, std::nullopt);
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::Impl::recycle(Output& output) {
+  output.handle.reset();
+  if (output.rgb != nullptr) {
+    const auto lock = std::scoped_lock(rgb_mutex);
+    free_rgb_frames.push_back(std::exchange(output.rgb, nullptr));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+Pipeline::Pipeline(const Config& config) : impl_(std::make_unique<Impl>(config)) {
+}
+
+//-------------------------------------------------------------------------------------------------
+Pipeline::~Pipeline() {
+  impl_->shutdown();
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::run() {
+  // The render thread is usually the main thread, whose name is the process name. Keep it
+  configureCurrentThread(impl_->render_thread, "");
+  impl_->start();
+  while (impl_->running.load(std::memory_order_acquire) && impl_->display.processEvents()) {
+    auto output = impl_->takeOutput();
+    if (output) {
+      impl_->display.update(output->frame());
+      impl_->recycle(*output);
+    }
+    impl_->display.present();
+  }
+  impl_->shutdown();
+}
+
+//-------------------------------------------------------------------------------------------------
+void Pipeline::stop() {
+  impl_->running.store(false, std::memory_order_release);
+  impl_->output_ready.notify_all();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Pipeline::stats() const -> Stats {
+  return { .camera = impl_->camera.stats(),
+           .display = impl_->display.stats(),
+           .convert = impl_->convert_time.snapshot(),
+           .dropped = impl_->dropped_count.load(std::memory_order_relaxed) };
+}
+
+}  // namespace picam
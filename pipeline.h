@@ -0,0 +1,84 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "camera.h"
+#include "display.h"
+#include "stats.h"
+#include "thread_config.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Live view pipeline that spreads capture, conversion and rendering over dedicated threads:
+/// - capture thread: takes completed frames from the camera and dispatches them
+/// - conversion workers (optional): convert frames to RGB on the CPU, in parallel
+/// - render thread: the thread calling run(), which owns the window and the GL context
+///
+/// Each stage keeps only the newest frame when the next one falls behind, so latency stays bounded
+/// at the cost of dropped frames. Construct and run the pipeline on the main thread, since window
+/// systems expect events to be processed there
+class Pipeline {
+public:
+  struct Config {
+    /// Camera configuration. Its completion_thread setting places the libcamera thread that
+    /// completes requests, which is usually the one to isolate
+    Camera::Config camera{};
+
+    /// Display configuration. Not relevant to frames converted by workers, which are RGB
+    Display::Config display{};
+
+    /// Placement and scheduling of the capture thread. Typically given SCHED_FIFO priority on
+    /// the same isolated core as the camera completion thread
+    ThreadConfig capture_thread{};
+
+    /// Number of conversion workers. 0 hands frames from the capture thread straight to the
+    /// display, for GPU conversion or dmabuf import
+    std::uint32_t worker_count{ 0 };
+
+    /// Placement and scheduling shared by all conversion workers
+    ThreadConfig worker_threads{};
+
+    /// Placement and scheduling of the render thread (applied to the caller of run())
+    ThreadConfig render_thread{};
+  };
+
+  /// Pipeline instrumentation
+  struct Stats {
+    Camera::Stats camera;     //!< Capture statistics
+    Display::Stats display;   //!< Rendering statistics
+    DurationStats convert;    //!< Conversion time per frame in the workers
+    std::uint64_t dropped{};  //!< Frames superseded by newer ones before conversion or display
+  };
+
+  /// Open the camera and the display window. Threads are started by run()
+  /// @param config Pipeline configuration
+  explicit Pipeline(const Config& config);
+
+  /// Start capture and conversion threads, and render frames on the calling thread until the
+  /// window is closed or stop() is called. Threads are stopped and joined before returning
+  void run();
+
+  /// Request run() to return. Safe to call from any thread
+  void stop();
+
+  /// @return Snapshot of pipeline statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  ~Pipeline();
+  Pipeline(const Pipeline&) = delete;
+  Pipeline(Pipeline&&) = delete;
+  auto operator=(const Pipeline&) = delete;
+  auto operator=(Pipeline&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
@@ -0,0 +1,1060 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+#include <libcamera/formats.h>
+
+#include "worker_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PICAM_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define PICAM_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// NOLINTBEGIN(*-pointer-arithmetic,*-reinterpret-cast,*-magic-numbers)
+
+namespace {
+
+using picam::OutputFormat;
+
+constexpr auto RGB_BYTES_PER_PIXEL = picam::bytesPerPixel(OutputFormat::Rgb888);
+constexpr auto YUYV_BYTES_PER_PIXEL = 2U;
+
+//-------------------------------------------------------------------------------------------------
+// YCbCr to RGB in 8-bit fixed point, derived from the floating point transforms of the GPU
+// shaders so that both paths agree. With c = Y - y_offset, d = Cb - 128 and e = Cr - 128:
+// R = y * c + r_cr * e, G = y * c - g_cb * d - g_cr * e, B = y * c + b_cb * d, all / 256
+struct YuvCoefficients {
+  int y;
+  int r_cr;
+  int g_cb;
+  int g_cr;
+  int b_cb;
+  int y_offset;
+  constexpr auto operator<=>(const YuvCoefficients&) const = default;
+};
+
+constexpr auto ENCODINGS = std::array{ picam::ColorSpace::Encoding::Rec601,
+                                       picam::ColorSpace::Encoding::Rec709,
+                                       picam::ColorSpace::Encoding::Rec2020 };
+constexpr auto RANGES = std::array{ picam::ColorSpace::Range::Limited,
+                                    picam::ColorSpace::Range::Full };
+
+/// Coefficients of every colour space, indexed by encoding then range
+constexpr auto YUV_COEFFICIENTS = [] {
+  const auto fixed = [](float value) {
+    return static_cast<int>((value * 256.0F) + ((value < 0.0F) ? -0.5F : 0.5F));
+  };
+  auto table = std::array<YuvCoefficients, ENCODINGS.size() * RANGES.size()>{};
+  auto* entry = table.data();
+  for (const auto encoding : ENCODINGS) {
+    for (const auto range : RANGES) {
+      const auto transform = picam::yuvToRgbTransform({ .encoding = encoding, .range = range });
+      const auto& m = transform.matrix;
+      *entry++ = { .y = fixed(m[0]),
+                   .r_cr = fixed(m[2]),
+                   .g_cb = -fixed(m[4]),
+                   .g_cr = -fixed(m[5]),
+                   .b_cb = fixed(m[7]),
+                   .y_offset = static_cast<int>((transform.offset[0] * 255.0F) + 0.5F) };
+    }
+  }
+  return table;
+}();
+
+// The historical BT.601 limited range coefficients, which all kernels were validated against
+static_assert(YUV_COEFFICIENTS[0] == YuvCoefficients{ .y = 298,
+                                                      .r_cr = 409,
+                                                      .g_cb = 100,
+                                                      .g_cr = 208,
+                                                      .b_cb = 516,
+                                                      .y_offset = 16 });
+
+constexpr auto yuvCoefficients(const picam::ColorSpace& color_space) -> const YuvCoefficients& {
+  return YUV_COEFFICIENTS[(static_cast<std::size_t>(color_space.encoding) * RANGES.size()) +
+                          static_cast<std::size_t>(color_space.range)];
+}
+
+/// Converts one row of packed pixels. Width is in pixels
+using PackedRowKernel = void (*)(const YuvCoefficients& k, const std::uint8_t* src,
+                                 std::uint8_t* dst, std::uint32_t width);
+
+//-------------------------------------------------------------------------------------------------
+inline auto toU8(int value) -> std::uint8_t {
+  return static_cast<std::uint8_t>(std::clamp(value, 0, 255));
+}
+
+//-------------------------------------------------------------------------------------------------
+// One YCbCr pixel, stored in the output format
+template <OutputFormat D>
+inline void storeYuv(const YuvCoefficients& k, int y, int cb, int cr, std::uint8_t* px) {
+  const auto c = k.y * (y - k.y_offset);
+  if constexpr (D == OutputFormat::Gray8) {
+    px[0] = toU8((c + 128) >> 8);
+  } else {
+    const auto d = cb - 128;
+    const auto e = cr - 128;
+    px[0] = toU8((c + (k.r_cr * e) + 128) >> 8);
+    px[1] = toU8((c - (k.g_cb * d) - (k.g_cr * e) + 128) >> 8);
+    px[2] = toU8((c + (k.b_cb * d) + 128) >> 8);
+    if constexpr (D == OutputFormat::Rgba8888) {
+      px[3] = 255;
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// One row of RGB888 pixels, stored in the output format
+template <OutputFormat D>
+inline void packRgbRow(const std::uint8_t* src, std::uint8_t* dst, std::uint32_t width) {
+  if constexpr (D == OutputFormat::Rgb888) {
+    std::memcpy(dst, src, static_cast<std::size_t>(width) * RGB_BYTES_PER_PIXEL);
+  } else {
+    for (std::uint32_t x = 0; x < width; ++x) {
+      const auto* px = &src[x * RGB_BYTES_PER_PIXEL];
+      if constexpr (D == OutputFormat::Rgba8888) {
+        std::memcpy(&dst[x * 4], px, RGB_BYTES_PER_PIXEL);
+        dst[(x * 4) + 3] = 255;
+      } else {
+        // ITU-R BT.601 luma weights, summing to 256
+        const auto luma = (77 * px[0]) + (150 * px[1]) + (29 * px[2]);
+        dst[x] = static_cast<std::uint8_t>((luma + 128) >> 8);
+      }
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// Scalar reference. YUYV (YUV 4:2:2) format: Y0 U0 Y1 V0 (4 bytes for 2 pixels). The SIMD kernels
+// below are bit-exact with this implementation.
+template <OutputFormat D>
+void yuyvRowScalar(const YuvCoefficients& k, const std::uint8_t* src, std::uint8_t* dst,
+                   std::uint32_t width) {
+  static constexpr auto BYTES_PER_PIXEL = picam::bytesPerPixel(D);
+  for (std::uint32_t x = 0; x + 1 < width; x += 2) {
+    const auto* yuyv = &src[x * YUYV_BYTES_PER_PIXEL];
+    auto* px = &dst[x * BYTES_PER_PIXEL];
+    storeYuv<D>(k, yuyv[0], yuyv[1], yuyv[3], px);
+    storeYuv<D>(k, yuyv[2], yuyv[1], yuyv[3], &px[BYTES_PER_PIXEL]);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// YUV 4:2:0 (NV12, YUV420). Converts one luma row using the chroma row it shares with its
+// neighbour. 'UV_STEP' is the distance in bytes between consecutive chroma samples: 2 for the
+// interleaved chroma plane of NV12, 1 for the separate planes of YUV420
+template <OutputFormat D, std::uint32_t UV_STEP>
+void yuv420RowScalar(const YuvCoefficients& k, const std::uint8_t* y_row,
+                     const std::uint8_t* u_row, const std::uint8_t* v_row, std::uint8_t* dst,
+                     std::uint32_t width) {
+  static constexpr auto BYTES_PER_PIXEL = picam::bytesPerPixel(D);
+  for (std::uint32_t x = 0; x < width; ++x) {
+    const auto uv = (x / 2) * UV_STEP;
+    storeYuv<D>(k, y_row[x], u_row[uv], v_row[uv], &dst[x * BYTES_PER_PIXEL]);
+  }
+}
+
+#if defined(PICAM_SIMD_X86)
+
+//-------------------------------------------------------------------------------------------------
+// x86 kernels convert 8 pixels per 128-bit lane. Bytes are spread to 16-bit lanes with a shuffle
+// and the three-term dot products are evaluated pairwise with 16x16->32 bit multiply-adds. The
+// results are saturated to [0, 255] by the signed/unsigned pack instructions, then re-interleaved
+// to RGB with two shuffles per output vector. Output bytes [0, 16) of a lane come from 'lo', and
+// [16, 24) from the low half of 'hi'.
+
+/// Packs a pair of 16-bit coefficients into each 32-bit lane for use with multiply-add
+constexpr auto coefficientPair(int first, int second) -> int {
+  return static_cast<int>((static_cast<std::uint32_t>(static_cast<std::uint16_t>(second)) << 16U) |
+                          static_cast<std::uint16_t>(first));
+}
+
+// clang-format off
+#define PICAM_LANE_MASK_Y   0, -1, 2, -1, 4, -1, 6, -1, 8, -1, 10, -1, 12, -1, 14, -1
+#define PICAM_LANE_MASK_U   1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1
+#define PICAM_LANE_MASK_V   3, -1, 3, -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1
+#define PICAM_LANE_MASK_RG0 0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5
+#define PICAM_LANE_MASK_B0  -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1
+#define PICAM_LANE_MASK_RG1 13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define PICAM_LANE_MASK_B1  -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1
+// clang-format on
+
+//-------------------------------------------------------------------------------------------------
+// 8 pixels per iteration
+__attribute__((target("sse4.1"))) void yuyvRowSse41(const YuvCoefficients& k,
+                                                     const std::uint8_t* src, std::uint8_t* dst,
+                                                     std::uint32_t width) {
+  const auto y_mask = _mm_setr_epi8(PICAM_LANE_MASK_Y);
+  const auto u_mask = _mm_setr_epi8(PICAM_LANE_MASK_U);
+  const auto v_mask = _mm_setr_epi8(PICAM_LANE_MASK_V);
+  const auto rg_mask0 = _mm_setr_epi8(PICAM_LANE_MASK_RG0);
+  const auto b_mask0 = _mm_setr_epi8(PICAM_LANE_MASK_B0);
+  const auto rg_mask1 = _mm_setr_epi8(PICAM_LANE_MASK_RG1);
+  const auto b_mask1 = _mm_setr_epi8(PICAM_LANE_MASK_B1);
+
+  const auto k_r = _mm_set1_epi32(coefficientPair(k.y, k.r_cr));
+  const auto k_gc = _mm_set1_epi32(coefficientPair(k.y, -k.g_cb));
+  const auto k_ge = _mm_set1_epi32(coefficientPair(-k.g_cr, 128));
+  const auto k_b = _mm_set1_epi32(coefficientPair(k.y, k.b_cb));
+  const auto round = _mm_set1_epi32(128);
+  const auto one = _mm_set1_epi16(1);
+  const auto y_offset = _mm_set1_epi16(static_cast<std::int16_t>(k.y_offset));
+  const auto uv_offset = _mm_set1_epi16(128);
+
+  static constexpr auto STEP = 8U;
+  std::uint32_t x = 0;
+  for (; x + STEP <= width; x += STEP) {
+    const auto yuyv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[x * 2]));
+    const auto c = _mm_sub_epi16(_mm_shuffle_epi8(yuyv, y_mask), y_offset);
+    const auto d = _mm_sub_epi16(_mm_shuffle_epi8(yuyv, u_mask), uv_offset);
+    const auto e = _mm_sub_epi16(_mm_shuffle_epi8(yuyv, v_mask), uv_offset);
+
+    const auto ce_lo = _mm_unpacklo_epi16(c, e);
+    const auto ce_hi = _mm_unpackhi_epi16(c, e);
+    const auto cd_lo = _mm_unpacklo_epi16(c, d);
+    const auto cd_hi = _mm_unpackhi_epi16(c, d);
+    const auto e1_lo = _mm_unpacklo_epi16(e, one);
+    const auto e1_hi = _mm_unpackhi_epi16(e, one);
+
+    const auto r_lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce_lo, k_r), round), 8);
+    const auto r_hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce_hi, k_r), round), 8);
+    const auto g_lo =
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_lo, k_gc), _mm_madd_epi16(e1_lo, k_ge)), 8);
+    const auto g_hi =
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_hi, k_gc), _mm_madd_epi16(e1_hi, k_ge)), 8);
+    const auto b_lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_lo, k_b), round), 8);
+    const auto b_hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_hi, k_b), round), 8);
+
+    // R in bytes 0-7 and G in bytes 8-15 of 'rg', B in bytes 0-7 of 'bb'
+    const auto rg = _mm_packus_epi16(_mm_packs_epi32(r_lo, r_hi), _mm_packs_epi32(g_lo, g_hi));
+    const auto b16 = _mm_packs_epi32(b_lo, b_hi);
+    const auto bb = _mm_packus_epi16(b16, b16);
+
+    const auto lo = _mm_or_si128(_mm_shuffle_epi8(rg, rg_mask0), _mm_shuffle_epi8(bb, b_mask0));
+    const auto hi = _mm_or_si128(_mm_shuffle_epi8(rg, rg_mask1), _mm_shuffle_epi8(bb, b_mask1));
+
+    auto* out = &dst[x * RGB_BYTES_PER_PIXEL];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[16]), hi);
+  }
+  yuyvRowScalar<OutputFormat::Rgb888>(k, &src[x * YUYV_BYTES_PER_PIXEL],
+                                      &dst[x * RGB_BYTES_PER_PIXEL], width - x);
+}
+
+//-------------------------------------------------------------------------------------------------
+// 16 pixels per iteration. Same arithmetic as the SSE4.1 kernel, with each 128-bit lane
+// independently processing 8 pixels (all instructions used here operate within lanes)
+__attribute__((target("avx2"))) void yuyvRowAvx2(const YuvCoefficients& k,
+                                                  const std::uint8_t* src, std::uint8_t* dst,
+                                                  std::uint32_t width) {
+  const auto y_mask = _mm256_setr_epi8(PICAM_LANE_MASK_Y, PICAM_LANE_MASK_Y);
+  const auto u_mask = _mm256_setr_epi8(PICAM_LANE_MASK_U, PICAM_LANE_MASK_U);
+  const auto v_mask = _mm256_setr_epi8(PICAM_LANE_MASK_V, PICAM_LANE_MASK_V);
+  const auto rg_mask0 = _mm256_setr_epi8(PICAM_LANE_MASK_RG0, PICAM_LANE_MASK_RG0);
+  const auto b_mask0 = _mm256_setr_epi8(PICAM_LANE_MASK_B0, PICAM_LANE_MASK_B0);
+  const auto rg_mask1 = _mm256_setr_epi8(PICAM_LANE_MASK_RG1, PICAM_LANE_MASK_RG1);
+  const auto b_mask1 = _mm256_setr_epi8(PICAM_LANE_MASK_B1, PICAM_LANE_MASK_B1);
+
+  const auto k_r = _mm256_set1_epi32(coefficientPair(k.y, k.r_cr));
+  const auto k_gc = _mm256_set1_epi32(coefficientPair(k.y, -k.g_cb));
+  const auto k_ge = _mm256_set1_epi32(coefficientPair(-k.g_cr, 128));
+  const auto k_b = _mm256_set1_epi32(coefficientPair(k.y, k.b_cb));
+  const auto round = _mm256_set1_epi32(128);
+  const auto one = _mm256_set1_epi16(1);
+  const auto y_offset = _mm256_set1_epi16(static_cast<std::int16_t>(k.y_offset));
+  const auto uv_offset = _mm256_set1_epi16(128);
+
+  static constexpr auto STEP = 16U;
+  std::uint32_t x = 0;
+  for (; x + STEP <= width; x += STEP) {
+    const auto yuyv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[x * 2]));
+    const auto c = _mm256_sub_epi16(_mm256_shuffle_epi8(yuyv, y_mask), y_offset);
+    const auto d = _mm256_sub_epi16(_mm256_shuffle_epi8(yuyv, u_mask), uv_offset);
+    const auto e = _mm256_sub_epi16(_mm256_shuffle_epi8(yuyv, v_mask), uv_offset);
+
+    const auto ce_lo = _mm256_unpacklo_epi16(c, e);
+    const auto ce_hi = _mm256_unpackhi_epi16(c, e);
+    const auto cd_lo = _mm256_unpacklo_epi16(c, d);
+    const auto cd_hi = _mm256_unpackhi_epi16(c, d);
+    const auto e1_lo = _mm256_unpacklo_epi16(e, one);
+    const auto e1_hi = _mm256_unpackhi_epi16(e, one);
+
+    const auto r_lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ce_lo, k_r), round), 8);
+    const auto r_hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ce_hi, k_r), round), 8);
+    const auto g_lo = _mm256_srai_epi32(
+        _mm256_add_epi32(_mm256_madd_epi16(cd_lo, k_gc), _mm256_madd_epi16(e1_lo, k_ge)), 8);
+    const auto g_hi = _mm256_srai_epi32(
+        _mm256_add_epi32(_mm256_madd_epi16(cd_hi, k_gc), _mm256_madd_epi16(e1_hi, k_ge)), 8);
+    const auto b_lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cd_lo, k_b), round), 8);
+    const auto b_hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cd_hi, k_b), round), 8);
+
+    const auto rg = _mm256_packus_epi16(_mm256_packs_epi32(r_lo, r_hi),
+                                        _mm256_packs_epi32(g_lo, g_hi));
+    const auto b16 = _mm256_packs_epi32(b_lo, b_hi);
+    const auto bb = _mm256_packus_epi16(b16, b16);
+
+    const auto lo =
+        _mm256_or_si256(_mm256_shuffle_epi8(rg, rg_mask0), _mm256_shuffle_epi8(bb, b_mask0));
+    const auto hi =
+        _mm256_or_si256(_mm256_shuffle_epi8(rg, rg_mask1), _mm256_shuffle_epi8(bb, b_mask1));
+
+    auto* out = &dst[x * RGB_BYTES_PER_PIXEL];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(lo));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[16]), _mm256_castsi256_si128(hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[24]), _mm256_extracti128_si256(lo, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[40]), _mm256_extracti128_si256(hi, 1));
+  }
+  yuyvRowSse41(k, &src[x * YUYV_BYTES_PER_PIXEL], &dst[x * RGB_BYTES_PER_PIXEL], width - x);
+}
+
+#undef PICAM_LANE_MASK_Y
+#undef PICAM_LANE_MASK_U
+#undef PICAM_LANE_MASK_V
+#undef PICAM_LANE_MASK_RG0
+#undef PICAM_LANE_MASK_B0
+#undef PICAM_LANE_MASK_RG1
+#undef PICAM_LANE_MASK_B1
+
+#endif  // PICAM_SIMD_X86
+
+#if defined(PICAM_SIMD_NEON)
+
+//-------------------------------------------------------------------------------------------------
+// Rounding shift, saturate to int16 and then to uint8. Equivalent to clamp((x + 128) >> 8)
+inline auto narrowNeon(int32x4_t lo, int32x4_t hi) -> uint8x8_t {
+  return vqmovun_s16(vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8)));
+}
+
+//-------------------------------------------------------------------------------------------------
+struct RgbNeon {
+  uint8x8_t r;
+  uint8x8_t g;
+  uint8x8_t b;
+};
+
+inline auto yuvToRgbNeon(const YuvCoefficients& k, int16x8_t c, int16x8_t d, int16x8_t e)
+    -> RgbNeon {
+  const auto y = static_cast<std::int16_t>(k.y);
+  const auto r_cr = static_cast<std::int16_t>(k.r_cr);
+  const auto g_cb = static_cast<std::int16_t>(k.g_cb);
+  const auto g_cr = static_cast<std::int16_t>(k.g_cr);
+  const auto b_cb = static_cast<std::int16_t>(k.b_cb);
+  const auto c_lo = vmull_n_s16(vget_low_s16(c), y);
+  const auto c_hi = vmull_n_s16(vget_high_s16(c), y);
+  const auto r = narrowNeon(vmlal_n_s16(c_lo, vget_low_s16(e), r_cr),
+                            vmlal_n_s16(c_hi, vget_high_s16(e), r_cr));
+  const auto g_lo = vmlsl_n_s16(vmlsl_n_s16(c_lo, vget_low_s16(d), g_cb), vget_low_s16(e), g_cr);
+  const auto g_hi = vmlsl_n_s16(vmlsl_n_s16(c_hi, vget_high_s16(d), g_cb), vget_high_s16(e), g_cr);
+  const auto g = narrowNeon(g_lo, g_hi);
+  const auto b = narrowNeon(vmlal_n_s16(c_lo, vget_low_s16(d), b_cb),
+                            vmlal_n_s16(c_hi, vget_high_s16(d), b_cb));
+  return { .r = r, .g = g, .b = b };
+}
+
+//-------------------------------------------------------------------------------------------------
+// 16 pixels per iteration. vld4 de-interleaves Y0/U/Y1/V for free and vst3 re-interleaves RGB
+void yuyvRowNeon(const YuvCoefficients& k, const std::uint8_t* src, std::uint8_t* dst,
+                 std::uint32_t width) {
+  static constexpr auto STEP = 16U;
+  const auto y_offset = vdup_n_u8(static_cast<std::uint8_t>(k.y_offset));
+  std::uint32_t x = 0;
+  for (; x + STEP <= width; x += STEP) {
+    const auto yuyv = vld4_u8(&src[x * 2]);
+    const auto c_even = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[0], y_offset));
+    const auto d = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[1], vdup_n_u8(128)));
+    const auto c_odd = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[2], y_offset));
+    const auto e = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[3], vdup_n_u8(128)));
+
+    const auto even = yuvToRgbNeon(k, c_even, d, e);
+    const auto odd = yuvToRgbNeon(k, c_odd, d, e);
+
+    const auto r = vzip_u8(even.r, odd.r);
+    const auto g = vzip_u8(even.g, odd.g);
+    const auto b = vzip_u8(even.b, odd.b);
+    uint8x16x3_t rgb;
+    rgb.val[0] = vcombine_u8(r.val[0], r.val[1]);
+    rgb.val[1] = vcombine_u8(g.val[0], g.val[1]);
+    rgb.val[2] = vcombine_u8(b.val[0], b.val[1]);
+    vst3q_u8(&dst[x * RGB_BYTES_PER_PIXEL], rgb);
+  }
+  yuyvRowScalar<OutputFormat::Rgb888>(k, &src[x * YUYV_BYTES_PER_PIXEL],
+                                      &dst[x * RGB_BYTES_PER_PIXEL], width - x);
+}
+
+#endif  // PICAM_SIMD_NEON
+
+//-------------------------------------------------------------------------------------------------
+// Raw Bayer. Rows are first reduced to one byte per sample (the 8 most significant bits), into a
+// buffer padded with one mirrored sample on either side. Mirroring by two samples keeps the colour
+// of the sample, so the demosaic kernels need no special cases at the edges of the image.
+
+/// Reduce one row of raw samples to 8 bits
+void unpackBayerRow(const picam::BayerFormat& bayer, const std::uint8_t* src, std::uint8_t* dst,
+                    std::uint32_t width) {
+  using Packing = picam::BayerFormat::Packing;
+  switch (bayer.packing) {
+    case Packing::None:
+      std::memcpy(dst, src, width);
+      return;
+    case Packing::Unpacked: {
+      const auto shift = bayer.bit_depth - 8U;
+      for (std::uint32_t x = 0; x < width; ++x) {
+        const auto value = static_cast<std::uint32_t>(src[x * 2]) | (src[(x * 2) + 1] << 8U);
+        dst[x] = static_cast<std::uint8_t>(std::min(value >> shift, 255U));
+      }
+      return;
+    }
+    case Packing::Csi2:
+      // The leading bytes of each group are the most significant bits of its samples
+      if (bayer.bit_depth == 10) {
+        for (std::uint32_t x = 0; x < width; ++x) {
+          dst[x] = src[((x / 4) * 5) + (x % 4)];
+        }
+      } else {
+        for (std::uint32_t x = 0; x < width; ++x) {
+          dst[x] = src[((x / 2) * 3) + (x % 2)];
+        }
+      }
+      return;
+  }
+}
+
+/// Three consecutive rows of 8-bit samples, each readable from index -1 to 'width'
+struct BayerRows {
+  const std::uint8_t* above;
+  const std::uint8_t* centre;
+  const std::uint8_t* below;
+  bool red_row;               //!< Row of red and green samples, otherwise of green and blue
+  std::uint32_t red_column;   //!< Parity of red columns. In blue rows these hold green samples
+};
+
+/// Demosaics one row of pixels. Width is in pixels
+using DebayerKernel = void (*)(const BayerRows& rows, std::uint8_t* dst, std::uint32_t width);
+
+//-------------------------------------------------------------------------------------------------
+// Scalar reference. Bilinear interpolation: the missing colours of each pixel are the rounded
+// means of the nearest samples of that colour. The vector kernel below is bit-exact with this
+void debayerRowScalar(const BayerRows& rows, std::uint8_t* dst, std::uint32_t width) {
+  const auto* above = rows.above;
+  const auto* centre = rows.centre;
+  const auto* below = rows.below;
+  for (std::uint32_t x = 0; x < width; ++x) {
+    const auto i = static_cast<std::ptrdiff_t>(x);
+    const auto c = centre[i];
+    const auto horizontal = static_cast<std::uint8_t>((centre[i - 1] + centre[i + 1] + 1) >> 1);
+    const auto vertical = static_cast<std::uint8_t>((above[i] + below[i] + 1) >> 1);
+    const auto cross = static_cast<std::uint8_t>(
+        (centre[i - 1] + centre[i + 1] + above[i] + below[i] + 2) >> 2);
+    const auto diagonal = static_cast<std::uint8_t>(
+        (above[i - 1] + above[i + 1] + below[i - 1] + below[i + 1] + 2) >> 2);
+
+    const auto red_column = ((x & 1U) == rows.red_column);
+    auto* px = &dst[x * RGB_BYTES_PER_PIXEL];
+    if (rows.red_row) {
+      px[0] = red_column ? c : horizontal;
+      px[1] = red_column ? cross : c;
+      px[2] = red_column ? diagonal : vertical;
+    } else {
+      px[0] = red_column ? vertical : diagonal;
+      px[1] = red_column ? c : cross;
+      px[2] = red_column ? horizontal : c;
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// 8 pixels per iteration in 16-bit lanes. Written with compiler vector extensions rather than
+// intrinsics, since the arithmetic is plain adds, shifts and selects that compile to the baseline
+// 128-bit instructions of x86 (SSE2) and ARM (NEON) alike
+using U8x8 = std::uint8_t __attribute__((vector_size(8)));
+using I16x8 = std::int16_t __attribute__((vector_size(16)));
+
+inline auto loadBayer(const std::uint8_t* src) -> I16x8 {
+  auto bytes = U8x8{};
+  std::memcpy(&bytes, src, sizeof(bytes));
+  return __builtin_convertvector(bytes, I16x8);
+}
+
+void debayerRowVector(const BayerRows& rows, std::uint8_t* dst, std::uint32_t width) {
+  static constexpr auto STEP = 8U;
+  // Each iteration starts on an even column, so lane parity is column parity
+  const auto parity = I16x8{ 0, 1, 0, 1, 0, 1, 0, 1 };
+  const auto red_column = (parity == static_cast<std::int16_t>(rows.red_column));
+
+  std::uint32_t x = 0;
+  for (; x + STEP <= width; x += STEP) {
+    const auto* above = &rows.above[x];
+    const auto* centre = &rows.centre[x];
+    const auto* below = &rows.below[x];
+    const auto c = loadBayer(centre);
+    const auto left = loadBayer(centre - 1);
+    const auto right = loadBayer(centre + 1);
+    const auto up = loadBayer(above);
+    const auto down = loadBayer(below);
+    const auto horizontal = (left + right + 1) >> 1;
+    const auto vertical = (up + down + 1) >> 1;
+    const auto cross = (left + right + up + down + 2) >> 2;
+    const auto diagonal =
+        (loadBayer(above - 1) + loadBayer(above + 1) + loadBayer(below - 1) + loadBayer(below + 1) +
+         2) >>
+        2;
+
+    auto red = I16x8{};
+    auto green = I16x8{};
+    auto blue = I16x8{};
+    if (rows.red_row) {
+      red = red_column ? c : horizontal;
+      green = red_column ? cross : c;
+      blue = red_column ? diagonal : vertical;
+    } else {
+      red = red_column ? vertical : diagonal;
+      green = red_column ? c : cross;
+      blue = red_column ? horizontal : c;
+    }
+
+    auto* px = &dst[x * RGB_BYTES_PER_PIXEL];
+    for (std::uint32_t lane = 0; lane < STEP; ++lane) {
+      px[lane * 3] = static_cast<std::uint8_t>(red[lane]);
+      px[(lane * 3) + 1] = static_cast<std::uint8_t>(green[lane]);
+      px[(lane * 3) + 2] = static_cast<std::uint8_t>(blue[lane]);
+    }
+  }
+  const auto tail = BayerRows{ .above = &rows.above[x],
+                               .centre = &rows.centre[x],
+                               .below = &rows.below[x],
+                               .red_row = rows.red_row,
+                               .red_column = rows.red_column };
+  debayerRowScalar(tail, &dst[x * RGB_BYTES_PER_PIXEL], width - x);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Demosaic rows [first, last) of a raw image. Each band keeps its own rolling window of three
+// unpacked rows, so bands convert independently. Outputs other than RGB888 are packed from a
+// demosaiced row while it is in cache
+template <OutputFormat D>
+void debayerBand(const picam::BayerFormat& bayer, const std::uint8_t* src, std::uint32_t pitch,
+                 std::uint32_t width, std::uint32_t height, std::uint32_t first,
+                 std::uint32_t last, DebayerKernel kernel, std::uint8_t* dst) {
+  const auto padded_width = static_cast<std::size_t>(width) + 2;
+  thread_local auto window = std::vector<std::uint8_t>{};
+  window.resize(padded_width * 3);
+  thread_local auto rgb_row = std::vector<std::uint8_t>{};
+  if constexpr (D != OutputFormat::Rgb888) {
+    rgb_row.resize(static_cast<std::size_t>(width) * RGB_BYTES_PER_PIXEL);
+  }
+
+  // Row 'y' of the image, which may be one past either edge, lives in window slot (y + 1) % 3
+  const auto row = [&](std::int64_t y) {
+    return &window[static_cast<std::size_t>((y + 1) % 3) * padded_width + 1];
+  };
+  const auto unpack = [&](std::int64_t y) {
+    const auto last_row = std::int64_t{ height } - 1;
+    const auto source_row = (y < 0) ? 1 : ((y > last_row) ? (2 * last_row) - y : y);
+    auto* samples = row(y);
+    unpackBayerRow(bayer, &src[static_cast<std::size_t>(source_row) * pitch], samples, width);
+    samples[-1] = samples[1];
+    samples[width] = samples[width - 2];
+  };
+
+  const auto red_row = bayer.redRow();
+  unpack(std::int64_t{ first } - 1);
+  unpack(first);
+  for (auto y = first; y < last; ++y) {
+    unpack(std::int64_t{ y } + 1);
+    const auto rows = BayerRows{ .above = row(std::int64_t{ y } - 1),
+                                 .centre = row(y),
+                                 .below = row(std::int64_t{ y } + 1),
+                                 .red_row = ((y & 1U) == red_row),
+                                 .red_column = bayer.redColumn() };
+    auto* out = &dst[static_cast<std::size_t>(y) * width * picam::bytesPerPixel(D)];
+    if constexpr (D == OutputFormat::Rgb888) {
+      kernel(rows, out, width);
+    } else {
+      kernel(rows, rgb_row.data(), width);
+      packRgbRow<D>(rgb_row.data(), out, width);
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto detectSimdLevel() -> picam::SimdLevel {
+#if defined(PICAM_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") != 0) {
+    return picam::SimdLevel::Avx2;
+  }
+  if (__builtin_cpu_supports("sse4.1") != 0) {
+    return picam::SimdLevel::Sse41;
+  }
+#elif defined(PICAM_SIMD_NEON)
+  return picam::SimdLevel::Neon;
+#endif
+  return picam::SimdLevel::Scalar;
+}
+
+//-------------------------------------------------------------------------------------------------
+// @return Fastest YUYV to RGB888 kernel for the instruction set
+auto yuyvKernel(picam::SimdLevel level) -> PackedRowKernel {
+  switch (level) {
+#if defined(PICAM_SIMD_X86)
+    case picam::SimdLevel::Avx2:
+      return yuyvRowAvx2;
+    case picam::SimdLevel::Sse41:
+      return yuyvRowSse41;
+#elif defined(PICAM_SIMD_NEON)
+    case picam::SimdLevel::Neon:
+      return yuyvRowNeon;
+#endif
+    default:
+      return yuyvRowScalar<OutputFormat::Rgb888>;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// Split 'rows' into bands and convert them on the shared worker pool. Frames below
+// PARALLEL_MIN_PIXELS are converted on the calling thread, where waking the pool would cost more
+// than it saves. 'max_threads' of 0 uses the whole pool
+constexpr auto PARALLEL_MIN_PIXELS = std::size_t{ 640 * 480 };
+constexpr auto MIN_ROWS_PER_BAND = 16U;
+
+template <typename ConvertBand>
+void convertRowBands(std::uint32_t rows, std::size_t pixels, std::size_t max_threads,
+                     const ConvertBand& convert_band) {
+  auto& pool = picam::WorkerPool::shared();
+  const auto available = pool.concurrency();
+  auto threads = (max_threads == 0) ? available : std::min(max_threads, available);
+  threads = std::min<std::size_t>(threads, rows / MIN_ROWS_PER_BAND);
+  if ((pixels < PARALLEL_MIN_PIXELS) || (threads < 2)) {
+    convert_band(0U, rows);
+    return;
+  }
+  // A few bands per thread balance the load when threads are preempted
+  static constexpr auto BANDS_PER_THREAD = 4U;
+  const auto bands = std::min<std::size_t>(threads * BANDS_PER_THREAD, rows / MIN_ROWS_PER_BAND);
+  const auto rows_per_band = static_cast<std::uint32_t>((rows + bands - 1) / bands);
+  pool.parallelFor(bands, [&](std::size_t band) {
+    const auto first = static_cast<std::uint32_t>(band) * rows_per_band;
+    convert_band(first, std::min(first + rows_per_band, rows));
+  });
+}
+
+//-------------------------------------------------------------------------------------------------
+// Source format traits. Each source is a family of kernels, one per output format; raw Bayer
+// formats differ only in sample order and packing, which are parameters of the conversion plan
+
+/// Source formats with conversion kernels
+enum class Source : std::uint8_t { Rgb888, Yuyv, Nv12, Yuv420, Bayer };
+constexpr auto SOURCE_COUNT = 5U;
+constexpr auto OUTPUT_COUNT = 3U;
+
+/// Storage of one plane, relative to the image size
+struct PlaneLayout {
+  std::uint32_t sample_bytes;   //!< Bytes per sample; 0 if set by the Bayer packing
+  std::uint32_t x_subsampling;  //!< Image columns per sample
+  std::uint32_t y_subsampling;  //!< Image rows per plane row
+};
+
+template <Source S>
+struct SourceTraits;
+
+template <>
+struct SourceTraits<Source::Rgb888> {
+  static constexpr auto PLANES = std::array{ PlaneLayout{ 3, 1, 1 } };
+};
+
+/// Y0 Cb Y1 Cr: chroma is subsampled horizontally within the single plane
+template <>
+struct SourceTraits<Source::Yuyv> {
+  static constexpr auto PLANES = std::array{ PlaneLayout{ YUYV_BYTES_PER_PIXEL, 1, 1 } };
+};
+
+/// Luma plane, then a plane of interleaved Cb Cr pairs subsampled in both directions
+template <>
+struct SourceTraits<Source::Nv12> {
+  static constexpr auto PLANES = std::array{ PlaneLayout{ 1, 1, 1 }, PlaneLayout{ 2, 2, 2 } };
+  static constexpr auto CHROMA_STEP = 2U;
+};
+
+/// Luma, Cb and Cr planes, chroma subsampled in both directions
+template <>
+struct SourceTraits<Source::Yuv420> {
+  static constexpr auto PLANES =
+      std::array{ PlaneLayout{ 1, 1, 1 }, PlaneLayout{ 1, 2, 2 }, PlaneLayout{ 1, 2, 2 } };
+  static constexpr auto CHROMA_STEP = 1U;
+};
+
+template <>
+struct SourceTraits<Source::Bayer> {
+  static constexpr auto PLANES = std::array{ PlaneLayout{ 0, 1, 1 } };
+};
+
+struct ConversionPlan;
+
+/// Converts a whole frame into 'dst', which is known to be large enough
+using FrameKernel = void (*)(const ConversionPlan& plan, const picam::ImageFrame& frame,
+                             std::uint8_t* dst, std::size_t max_threads,
+                             const picam::PixelConverter::RowsCallback& on_rows);
+
+/// Everything about a conversion that is known from the stream format
+struct ConversionPlan {
+  FrameKernel convert{ nullptr };
+  std::uint32_t width{};
+  std::uint32_t height{};
+  YuvCoefficients yuv{ YUV_COEFFICIENTS[0] };
+  PackedRowKernel yuyv_row{ nullptr };
+  picam::BayerFormat bayer{};
+  DebayerKernel debayer_row{ nullptr };
+};
+
+//-------------------------------------------------------------------------------------------------
+// @return First row of each plane of a frame, after checking that the planes hold every row
+template <Source S>
+auto sourcePlanes(const ConversionPlan& plan, const picam::ImageFrame& frame)
+    -> std::array<const std::uint8_t*, SourceTraits<S>::PLANES.size()> {
+  const auto& layouts = SourceTraits<S>::PLANES;
+  auto planes = std::array<const std::uint8_t*, layouts.size()>{};
+  for (std::uint32_t i = 0; i < layouts.size(); ++i) {
+    const auto& layout = layouts.at(i);
+    const auto columns = (plan.width + layout.x_subsampling - 1) / layout.x_subsampling;
+    const auto rows = (plan.height + layout.y_subsampling - 1) / layout.y_subsampling;
+    const auto row_bytes = (layout.sample_bytes == 0) ? plan.bayer.rowBytes(columns)
+                                                      : columns * layout.sample_bytes;
+    const auto& plane = frame.planes.at(i);
+    if ((i >= frame.plane_count) ||
+        ((rows > 0) &&
+         (plane.data.size() < (static_cast<std::size_t>(plane.stride) * (rows - 1)) + row_bytes))) {
+      throw std::invalid_argument("Source buffer too small for image dimensions");
+    }
+    planes.at(i) = reinterpret_cast<const std::uint8_t*>(plane.data.data());
+  }
+  return planes;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Kernel of one pair of source and output formats
+template <Source S, OutputFormat D>
+void convertFrame(const ConversionPlan& plan, const picam::ImageFrame& frame, std::uint8_t* dst,
+                  std::size_t max_threads, const picam::PixelConverter::RowsCallback& on_rows) {
+  const auto width = plan.width;
+  const auto height = plan.height;
+  const auto planes = sourcePlanes<S>(plan, frame);
+
+  // Rows [first, last), on the calling thread
+  const auto convert_rows = [&](std::uint32_t first, std::uint32_t last) {
+    if constexpr (S == Source::Bayer) {
+      debayerBand<D>(plan.bayer, planes[0], frame.planes[0].stride, width, height, first, last,
+                     plan.debayer_row, dst);
+    } else {
+      const auto dst_row_bytes = static_cast<std::size_t>(width) * picam::bytesPerPixel(D);
+      const auto row = [&frame, &planes](std::size_t plane, std::uint32_t y) {
+        const auto subsampling = SourceTraits<S>::PLANES.at(plane).y_subsampling;
+        return &planes.at(plane)[static_cast<std::size_t>(y / subsampling) *
+                                 frame.planes.at(plane).stride];
+      };
+      for (auto y = first; y < last; ++y) {
+        auto* out = &dst[y * dst_row_bytes];
+        if constexpr (S == Source::Rgb888) {
+          packRgbRow<D>(row(0, y), out, width);
+        } else if constexpr (S == Source::Yuyv) {
+          plan.yuyv_row(plan.yuv, row(0, y), out, width);
+        } else if constexpr (S == Source::Nv12) {
+          const auto* uv = row(1, y);
+          yuv420RowScalar<D, SourceTraits<S>::CHROMA_STEP>(plan.yuv, row(0, y), uv, &uv[1], out,
+                                                           width);
+        } else {
+          yuv420RowScalar<D, SourceTraits<S>::CHROMA_STEP>(plan.yuv, row(0, y), row(1, y),
+                                                           row(2, y), out, width);
+        }
+      }
+    }
+  };
+
+  const auto pixels = static_cast<std::size_t>(width) * height;
+  convertRowBands(height, pixels, max_threads, [&](std::uint32_t first, std::uint32_t last) {
+    if (not on_rows) {
+      convert_rows(first, last);
+      return;
+    }
+    // Small chunks, so that the rows are still in cache for the callback
+    static constexpr auto CHUNK_ROWS = 8U;
+    for (auto chunk = first; chunk < last; chunk += CHUNK_ROWS) {
+      const auto chunk_last = std::min(chunk + CHUNK_ROWS, last);
+      convert_rows(chunk, chunk_last);
+      on_rows(chunk, chunk_last);
+    }
+  });
+}
+
+//-------------------------------------------------------------------------------------------------
+// @return Kernels of one source format, indexed by output format
+template <Source S>
+constexpr auto outputKernels() -> std::array<FrameKernel, OUTPUT_COUNT> {
+  return { convertFrame<S, OutputFormat::Rgb888>, convertFrame<S, OutputFormat::Rgba8888>,
+           convertFrame<S, OutputFormat::Gray8> };
+}
+
+/// Kernels of every pair of source and output formats, indexed by source then output format
+constexpr auto FRAME_KERNELS = std::array{ outputKernels<Source::Rgb888>(),
+                                           outputKernels<Source::Yuyv>(),
+                                           outputKernels<Source::Nv12>(),
+                                           outputKernels<Source::Yuv420>(),
+                                           outputKernels<Source::Bayer>() };
+static_assert(FRAME_KERNELS.size() == SOURCE_COUNT);
+
+//-------------------------------------------------------------------------------------------------
+// @return Source kernel family of a pixel format, or nothing if it is not supported
+auto sourceOf(const picam::ImageFrame::Header& header) -> std::optional<Source> {
+  namespace formats = libcamera::formats;
+  const auto format = header.format;
+  if (format == formats::RGB888) {
+    return Source::Rgb888;
+  }
+  if (format == formats::YUYV) {
+    return Source::Yuyv;
+  }
+  if (format == formats::NV12) {
+    return Source::Nv12;
+  }
+  if (format == formats::YUV420) {
+    return Source::Yuv420;
+  }
+  if (picam::bayerFormat(format, header.format_modifier)) {
+    return Source::Bayer;
+  }
+  return std::nullopt;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Select the kernels converting frames with the specified header
+// @return The plan, or nothing if the source format is not supported
+auto makePlan(const picam::ImageFrame::Header& header, OutputFormat output,
+              picam::SimdLevel level) -> std::optional<ConversionPlan> {
+  if (not picam::isSupported(level)) {
+    throw std::invalid_argument("Instruction set not supported by host CPU");
+  }
+  const auto source = sourceOf(header);
+  if (not source) {
+    return std::nullopt;
+  }
+
+  auto plan = ConversionPlan{};
+  plan.convert = FRAME_KERNELS.at(static_cast<std::size_t>(*source))
+                     .at(static_cast<std::size_t>(output));
+  plan.width = static_cast<std::uint32_t>(header.size.width);
+  plan.height = static_cast<std::uint32_t>(header.size.height);
+  plan.yuv = yuvCoefficients(header.color_space);
+  switch (output) {
+    case OutputFormat::Rgb888:
+      plan.yuyv_row = yuyvKernel(level);
+      break;
+    case OutputFormat::Rgba8888:
+      plan.yuyv_row = yuyvRowScalar<OutputFormat::Rgba8888>;
+      break;
+    case OutputFormat::Gray8:
+      plan.yuyv_row = yuyvRowScalar<OutputFormat::Gray8>;
+      break;
+  }
+  if (*source == Source::Bayer) {
+    if ((plan.width < 2) || (plan.height < 2)) {
+      throw std::invalid_argument("Raw images must be at least 2x2 pixels");
+    }
+    plan.bayer = *picam::bayerFormat(header.format, header.format_modifier);
+    plan.debayer_row = (level == picam::SimdLevel::Scalar) ? debayerRowScalar : debayerRowVector;
+  }
+  return plan;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Run a plan after checking the size of the destination
+void runPlan(const ConversionPlan& plan, OutputFormat output, const picam::ImageFrame& frame,
+             std::span<std::uint8_t> dst, std::size_t max_threads,
+             const picam::PixelConverter::RowsCallback& on_rows) {
+  const auto bytes = static_cast<std::size_t>(plan.width) * plan.height * bytesPerPixel(output);
+  if (dst.size() < bytes) {
+    throw std::invalid_argument(std::format("Destination buffer too small for {} image",
+                                            picam::toString(output)));
+  }
+  plan.convert(plan, frame, dst.data(), max_threads, on_rows);
+}
+
+}  // namespace
+
+namespace picam {
+
+//-------------------------------------------------------------------------------------------------
+auto bestSimdLevel() -> SimdLevel {
+  static const auto level = detectSimdLevel();
+  return level;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto isSupported(SimdLevel level) -> bool {
+  if (level == SimdLevel::Scalar) {
+    return true;
+  }
+  const auto best = bestSimdLevel();
+  if (level == SimdLevel::Sse41) {
+    return (best == SimdLevel::Sse41) || (best == SimdLevel::Avx2);
+  }
+  return level == best;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toString(SimdLevel level) -> std::string_view {
+  switch (level) {
+    case SimdLevel::Scalar:
+      return "scalar";
+    case SimdLevel::Sse41:
+      return "SSE4.1";
+    case SimdLevel::Avx2:
+      return "AVX2";
+    case SimdLevel::Neon:
+      return "NEON";
+  }
+  return "unknown";
+}
+
+//-------------------------------------------------------------------------------------------------
+auto bayerFormat(std::uint32_t format, std::uint64_t modifier) -> std::optional<BayerFormat> {
+  using Order = BayerFormat::Order;
+  struct Entry {
+    libcamera::PixelFormat format;
+    Order order;
+    std::uint8_t bit_depth;
+  };
+  namespace formats = libcamera::formats;
+  static constexpr auto ENTRIES = std::array{
+    Entry{ formats::SRGGB8, Order::RGGB, 8 },    Entry{ formats::SGRBG8, Order::GRBG, 8 },
+    Entry{ formats::SGBRG8, Order::GBRG, 8 },    Entry{ formats::SBGGR8, Order::BGGR, 8 },
+    Entry{ formats::SRGGB10, Order::RGGB, 10 },  Entry{ formats::SGRBG10, Order::GRBG, 10 },
+    Entry{ formats::SGBRG10, Order::GBRG, 10 },  Entry{ formats::SBGGR10, Order::BGGR, 10 },
+    Entry{ formats::SRGGB12, Order::RGGB, 12 },  Entry{ formats::SGRBG12, Order::GRBG, 12 },
+    Entry{ formats::SGBRG12, Order::GBRG, 12 },  Entry{ formats::SBGGR12, Order::BGGR, 12 },
+    Entry{ formats::SRGGB16, Order::RGGB, 16 },  Entry{ formats::SGRBG16, Order::GRBG, 16 },
+    Entry{ formats::SGBRG16, Order::GBRG, 16 },  Entry{ formats::SBGGR16, Order::BGGR, 16 },
+  };
+
+  const auto entry = std::ranges::find_if(
+      ENTRIES, [format](const Entry& candidate) { return candidate.format.fourcc() == format; });
+  if (entry == ENTRIES.end()) {
+    return std::nullopt;
+  }
+  const auto bayer = [entry](BayerFormat::Packing packing) {
+    return BayerFormat{ .order = entry->order, .packing = packing, .bit_depth = entry->bit_depth };
+  };
+  if (modifier == 0) {
+    return bayer((entry->bit_depth == 8) ? BayerFormat::Packing::None
+                                         : BayerFormat::Packing::Unpacked);
+  }
+  const auto csi2_packed = formats::SRGGB10_CSI2P.modifier();
+  if ((modifier == csi2_packed) && ((entry->bit_depth == 10) || (entry->bit_depth == 12))) {
+    return bayer(BayerFormat::Packing::Csi2);
+  }
+  return std::nullopt;  // e.g. compressed formats of the Raspberry Pi ISP
+}
+
+//-------------------------------------------------------------------------------------------------
+auto convertToRGB(const ImageFrame& frame, std::span<std::uint8_t> rgb) -> bool {
+  return convertToRGB(frame, rgb, bestSimdLevel(), 0);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto convertToRGB(const ImageFrame& frame, std::span<std::uint8_t> rgb, SimdLevel level,
+                  std::size_t max_threads) -> bool {
+  const auto plan = makePlan(frame.header, OutputFormat::Rgb888, level);
+  if (not plan) {
+    return false;
+  }
+  runPlan(*plan, OutputFormat::Rgb888, frame, rgb, max_threads, {});
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toString(OutputFormat format) -> std::string_view {
+  switch (format) {
+    case OutputFormat::Rgb888:
+      return "RGB888";
+    case OutputFormat::Rgba8888:
+      return "RGBA8888";
+    case OutputFormat::Gray8:
+      return "Gray8";
+  }
+  return "unknown";
+}
+
+//-------------------------------------------------------------------------------------------------
+struct PixelConverter::Impl {
+  ImageFrame::Header header;
+  OutputFormat output{ OutputFormat::Rgb888 };
+  ConversionPlan plan;
+};
+
+//-------------------------------------------------------------------------------------------------
+PixelConverter::PixelConverter(const ImageFrame::Header& header, OutputFormat output,
+                               SimdLevel level)
+  : impl_(std::make_unique<Impl>()) {
+  const auto plan = makePlan(header, output, level);
+  if (not plan) {
+    throw std::invalid_argument(std::format("Unsupported source pixel format ({})", header.format));
+  }
+  impl_->header = header;
+  impl_->output = output;
+  impl_->plan = *plan;
+}
+
+//-------------------------------------------------------------------------------------------------
+PixelConverter::~PixelConverter() = default;
+PixelConverter::PixelConverter(PixelConverter&&) noexcept = default;
+auto PixelConverter::operator=(PixelConverter&&) noexcept -> PixelConverter& = default;
+
+//-------------------------------------------------------------------------------------------------
+auto PixelConverter::supports(const ImageFrame::Header& header) -> bool {
+  return sourceOf(header).has_value();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto PixelConverter::accepts(const ImageFrame::Header& header) const -> bool {
+  return matchesFormat(header, impl_->header) && (header.color_space == impl_->header.color_space);
+}
+
+//-------------------------------------------------------------------------------------------------
+auto PixelConverter::output() const -> OutputFormat {
+  return impl_->output;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto PixelConverter::outputBytes() const -> std::size_t {
+  return static_cast<std::size_t>(impl_->plan.width) * impl_->plan.height *
+         bytesPerPixel(impl_->output);
+}
+
+//-------------------------------------------------------------------------------------------------
+void PixelConverter::convert(const ImageFrame& frame, std::span<std::uint8_t> dst,
+                             std::size_t max_threads) const {
+  convert(frame, dst, max_threads, {});
+}
+
+//-------------------------------------------------------------------------------------------------
+void PixelConverter::convert(const ImageFrame& frame, std::span<std::uint8_t> dst,
+                             std::size_t max_threads, const RowsCallback& on_rows) const {
+  if (not accepts(frame.header)) {
+    throw std::invalid_argument("Frame format differs from the format of the converter");
+  }
+  runPlan(impl_->plan, impl_->output, frame, dst, max_threads, on_rows);
+}
+
+}  // namespace picam
+
+// NOLINTEND(*-pointer-arithmetic,*-reinterpret-cast,*-magic-numbers)
@@ -0,0 +1,237 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "image_frame.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Instruction set extensions used by the pixel conversion kernels
+enum class SimdLevel : std::uint8_t {
+  Scalar,  //!< Portable reference implementation
+  Sse41,   //!< x86 SSE4.1
+  Avx2,    //!< x86 AVX2
+  Neon     //!< ARM Advanced SIMD
+};
+
+/// @return Best instruction set supported by the host CPU (detected once, then cached)
+auto bestSimdLevel() -> SimdLevel;
+
+/// @return true if the host CPU can run kernels built for the specified instruction set
+auto isSupported(SimdLevel level) -> bool;
+
+/// @return Human readable name of the instruction set
+auto toString(SimdLevel level) -> std::string_view;
+
+/// Floating point YCbCr to RGB transform for samples normalised to [0, 1], for use by GPU shaders:
+/// rgb = matrix * (yuv - offset), with 'matrix' in row-major order
+struct YuvToRgbTransform {
+  std::array<float, 9> matrix{};
+  std::array<float, 3> offset{};
+};
+
+/// @return Transform for the specified YCbCr encoding and quantisation range
+constexpr auto yuvToRgbTransform(const ColorSpace& color_space) -> YuvToRgbTransform {
+  // Luma weights of red and blue
+  auto kr = 0.299F;
+  auto kb = 0.114F;
+  if (color_space.encoding == ColorSpace::Encoding::Rec709) {
+    kr = 0.2126F;
+    kb = 0.0722F;
+  } else if (color_space.encoding == ColorSpace::Encoding::Rec2020) {
+    kr = 0.2627F;
+    kb = 0.0593F;
+  }
+  const auto kg = 1.0F - kr - kb;
+
+  // Limited range: luma in [16, 235], chroma in [16, 240]
+  const auto is_full = (color_space.range == ColorSpace::Range::Full);
+  const auto ys = is_full ? 1.0F : 255.0F / 219.0F;
+  const auto cs = is_full ? 1.0F : 255.0F / 224.0F;
+  const auto y_offset = is_full ? 0.0F : 16.0F / 255.0F;
+  const auto c_offset = 128.0F / 255.0F;
+
+  // clang-format off
+  return {
+    .matrix = {
+      ys,  0.0F,                                 cs * 2.0F * (1.0F - kr),
+      ys, -cs * 2.0F * kb * (1.0F - kb) / kg,   -cs * 2.0F * kr * (1.0F - kr) / kg,
+      ys,  cs * 2.0F * (1.0F - kb),              0.0F
+    },
+    .offset = { y_offset, c_offset, c_offset }
+  };
+  // clang-format on
+}
+
+//=================================================================================================
+/// Sample arrangement of a raw Bayer pixel format
+struct BayerFormat {
+  /// Colours of the top-left 2x2 block of samples, in row order
+  enum class Order : std::uint8_t { RGGB, GRBG, GBRG, BGGR };
+
+  /// How samples are stored
+  enum class Packing : std::uint8_t {
+    None,      //!< One byte per sample (8-bit formats)
+    Unpacked,  //!< One little-endian 16-bit word per sample, value in the low bits
+    Csi2       //!< MIPI CSI-2: 4 10-bit samples in 5 bytes, or 2 12-bit samples in 3 bytes. The
+               //!< first bytes of each group hold the most significant bits of each sample
+  };
+
+  Order order{ Order::RGGB };
+  Packing packing{ Packing::None };
+  std::uint8_t bit_depth{ 8 };  //!< Significant bits per sample
+
+  /// @return Bytes of sample data per row, excluding padding
+  [[nodiscard]] constexpr auto rowBytes(std::uint32_t width) const -> std::uint32_t {
+    switch (packing) {
+      case Packing::None:
+        return width;
+      case Packing::Unpacked:
+        return width * 2;
+      case Packing::Csi2:
+        return (bit_depth == 10) ? ((width + 3) / 4 * 5) : ((width + 1) / 2 * 3);
+    }
+    return 0;
+  }
+
+  /// @return Column (0 or 1) of the red sample in each 2x2 block
+  [[nodiscard]] constexpr auto redColumn() const -> std::uint32_t {
+    return ((order == Order::GRBG) || (order == Order::BGGR)) ? 1U : 0U;
+  }
+
+  /// @return Row (0 or 1) of the red sample in each 2x2 block
+  [[nodiscard]] constexpr auto redRow() const -> std::uint32_t {
+    return ((order == Order::GBRG) || (order == Order::BGGR)) ? 1U : 0U;
+  }
+};
+
+/// Identify raw Bayer formats that can be unpacked. Formats with the same fourcc differ in their
+/// packing, which libcamera reports as a format modifier
+/// @param format Pixel format (fourcc)
+/// @param modifier Format modifier, as in ImageFrame::Header::format_modifier
+/// @return Sample arrangement, or nothing for other formats (including compressed raw formats)
+auto bayerFormat(std::uint32_t format, std::uint64_t modifier = 0) -> std::optional<BayerFormat>;
+
+//=================================================================================================
+/// Pixel formats produced by PixelConverter. Images are tightly packed (no row padding)
+enum class OutputFormat : std::uint8_t {
+  Rgb888,    //!< R, G, B bytes, as read by GL_RGB textures
+  Rgba8888,  //!< R, G, B and an opaque alpha byte, as read by GL_RGBA textures
+  Gray8      //!< Full range luma
+};
+
+/// @return Bytes per pixel of the output format
+constexpr auto bytesPerPixel(OutputFormat format) -> std::uint32_t {
+  switch (format) {
+    case OutputFormat::Rgb888:
+      return 3;
+    case OutputFormat::Rgba8888:
+      return 4;
+    case OutputFormat::Gray8:
+      return 1;
+  }
+  return 0;
+}
+
+/// @return Human readable name of the output format
+auto toString(OutputFormat format) -> std::string_view;
+
+//=================================================================================================
+/// Converts frames of one source format (pixel format, modifier, size and colour space) to one
+/// output format. Kernels are specialised at compile time for each pair of source and output
+/// formats; the kernel for the pair, the row kernel for the instruction set and the colour matrix
+/// are selected once on construction, so that converting a frame does not dispatch on its format.
+/// Create one per stream configuration and reuse it for every frame.
+///
+/// Supported sources are those of convertToRGB(). YUV sources are converted with the colour matrix
+/// and range of their colour space. Gray8 is the luma of YUV sources, and the ITU-R BT.601
+/// weighted sum of red, green and blue of RGB and raw sources. YUYV to RGB888 has SIMD kernels for
+/// each instruction set, raw Bayer a portable vector demosaic kernel, and the other pairs are
+/// converted with scalar kernels
+class PixelConverter {
+public:
+  /// Work on rows [first_row, last_row) of the source frame, called on the converting thread just
+  /// after converting them, while they are in cache. Chunks of one frame are reported from several
+  /// threads at once, each row exactly once. Must not throw
+  using RowsCallback = std::function<void(std::uint32_t first_row, std::uint32_t last_row)>;
+
+  /// @param header Header of the frames to convert
+  /// @param output Format to convert to
+  /// @param level Instruction set of the kernels. Throws std::invalid_argument if the host CPU
+  ///              does not support it, or if the source format is not supported (see supports())
+  PixelConverter(const ImageFrame::Header& header, OutputFormat output,
+                 SimdLevel level = bestSimdLevel());
+
+  /// @return true if frames with the specified header can be converted
+  [[nodiscard]] static auto supports(const ImageFrame::Header& header) -> bool;
+
+  /// @return true if frames with the specified header have the format the converter is for
+  [[nodiscard]] auto accepts(const ImageFrame::Header& header) const -> bool;
+
+  /// @return Format that frames are converted to
+  [[nodiscard]] auto output() const -> OutputFormat;
+
+  /// @return Bytes of a converted image
+  [[nodiscard]] auto outputBytes() const -> std::size_t;
+
+  /// Convert a frame. Large frames are split into row bands converted in parallel on
+  /// WorkerPool::shared(). Throws std::invalid_argument if the converter does not accept the
+  /// frame, its planes are too small for its size, or 'dst' is smaller than outputBytes()
+  /// @param frame Source frame
+  /// @param dst Destination buffer
+  /// @param max_threads Threads to split the frame over, including the caller. 0 uses the whole
+  ///                    shared pool; 1 converts on the calling thread only
+  void convert(const ImageFrame& frame, std::span<std::uint8_t> dst,
+               std::size_t max_threads = 0) const;
+
+  /// Same as above, fusing other per-row work (e.g. FrameAnalyzer) with the conversion, so that
+  /// each source row is read from memory once
+  /// @param on_rows Called for every chunk of rows converted
+  void convert(const ImageFrame& frame, std::span<std::uint8_t> dst, std::size_t max_threads,
+               const RowsCallback& on_rows) const;
+
+  ~PixelConverter();
+  PixelConverter(const PixelConverter&) = delete;
+  PixelConverter(PixelConverter&&) noexcept;
+  auto operator=(const PixelConverter&) = delete;
+  auto operator=(PixelConverter&&) noexcept -> PixelConverter&;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+/// Convert a camera frame to tightly packed RGB888 (3 bytes per pixel, no row padding).
+/// Supported source formats: RGB888 (passthrough), YUYV, NV12 and YUV420 (in the colour space of
+/// the frame), and raw Bayer formats (see bayerFormat()). Raw frames are demosaiced by bilinear
+/// interpolation from the 8 most significant bits of each sample; no black level, white balance
+/// or gamma is applied. Selects the kernels on every call; to convert a stream, create a
+/// PixelConverter once instead.
+/// Large frames are split into row bands converted in parallel on WorkerPool::shared()
+/// @param frame Source frame
+/// @param rgb Destination buffer. Must hold at least width * height * 3 bytes
+/// @return false if the source pixel format is not supported
+auto convertToRGB(const ImageFrame& frame, std::span<std::uint8_t> rgb) -> bool;
+
+/// Same as above, but using kernels for a specific instruction set and a bounded number of
+/// threads. Intended for testing and benchmarking. Throws if the host CPU does not support the
+/// instruction set
+/// @param max_threads Threads to split the frame over, including the caller. 0 uses the whole
+///                    shared pool; 1 converts on the calling thread only. Small frames are always
+///                    converted on the calling thread
+auto convertToRGB(const ImageFrame& frame, std::span<std::uint8_t> rgb, SimdLevel level,
+                  std::size_t max_threads = 1) -> bool;
+
+}  // namespace picam
@@ -0,0 +1,581 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <libcamera/formats.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace picam {
+
+namespace {
+
+// Longest the service thread sleeps before checking for shutdown
+constexpr auto POLL_TIMEOUT_MS = 100;
+
+// Time allowed for the encoder to flush frames still in flight on shutdown
+constexpr auto DRAIN_TIMEOUT = std::chrono::seconds(1);
+
+// Encoded frame buffers must hold the largest key frame
+constexpr auto MIN_BITSTREAM_BUFFER_SIZE = std::size_t{ 512 } * 1024;
+
+constexpr auto INPUT_TYPE = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+constexpr auto OUTPUT_TYPE = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+//-------------------------------------------------------------------------------------------------
+auto xioctl(int fd, unsigned long request, void* arg) -> int {
+  auto ret = 0;
+  do {
+    ret = ioctl(fd, request, arg);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+  } while ((ret < 0) && (errno == EINTR));
+  return ret;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto toV4l2PixelFormat(std::uint32_t format) -> std::uint32_t {
+  if (format == libcamera::formats::NV12) {
+    return V4L2_PIX_FMT_NV12;
+  }
+  if (format == libcamera::formats::YUV420) {
+    return V4L2_PIX_FMT_YUV420;
+  }
+  return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Colour description signalled in the stream, so that players apply the camera's matrix and range
+void setColorSpace(v4l2_pix_format_mplane& pix, const ColorSpace& color_space) {
+  switch (color_space.encoding) {
+    case ColorSpace::Encoding::Rec601:
+      pix.colorspace = V4L2_COLORSPACE_SMPTE170M;
+      pix.ycbcr_enc = V4L2_YCBCR_ENC_601;
+      break;
+    case ColorSpace::Encoding::Rec709:
+      pix.colorspace = V4L2_COLORSPACE_REC709;
+      pix.ycbcr_enc = V4L2_YCBCR_ENC_709;
+      break;
+    case ColorSpace::Encoding::Rec2020:
+      pix.colorspace = V4L2_COLORSPACE_BT2020;
+      pix.ycbcr_enc = V4L2_YCBCR_ENC_BT2020;
+      break;
+  }
+  pix.quantization = (color_space.range == ColorSpace::Range::Full) ? V4L2_QUANTIZATION_FULL_RANGE
+                                                                    : V4L2_QUANTIZATION_LIM_RANGE;
+}
+
+//-------------------------------------------------------------------------------------------------
+// @return Size of the 4:2:0 image in the dmabuf, if its planes are contiguous as the encoder
+// expects. 0 otherwise
+auto contiguousImageSize(const ImageFrame& frame) -> std::size_t {
+  const auto stride = static_cast<std::size_t>(frame.planes[0].stride);
+  const auto height = static_cast<std::size_t>(frame.header.size.height);
+  auto expected_offset = frame.planes[0].offset + (stride * height);
+  for (std::uint32_t i = 1; i < frame.plane_count; ++i) {
+    const auto& plane = frame.planes.at(i);
+    if ((plane.fd != frame.planes[0].fd) || (plane.offset != expected_offset)) {
+      return 0;
+    }
+    expected_offset += static_cast<std::size_t>(plane.stride) * ((height + 1) / 2);
+  }
+  return expected_offset - frame.planes[0].offset;
+}
+
+}  // namespace
+
+//=================================================================================================
+struct Recorder::Impl {
+  Config config;
+  int encoder_fd{ -1 };
+  int output_fd{ -1 };
+
+  // Encoder input format, set from the first frame. Caller thread only
+  bool configured{ false };
+  ImageSize image_size;
+  std::uint32_t pixel_format{};
+  std::uint32_t stride{};
+  std::size_t image_bytes{};
+
+  // Frames queued to the encoder, indexed by V4L2 buffer index. An empty handle marks a free slot
+  struct InputSlot {
+    FrameHandle handle;
+    std::chrono::steady_clock::time_point queued_at;
+  };
+  std::mutex input_mutex;  // Between the caller queueing and the service thread releasing
+  std::vector<InputSlot> inputs;
+
+  // Encoded frame buffers mapped from the encoder
+  struct Mapping {
+    void* memory{ nullptr };
+    std::size_t length{};
+  };
+  std::vector<Mapping> bitstream_buffers;
+
+  // Service thread: releases input buffers and collects encoded frames
+  std::jthread service_thread;
+  std::atomic_bool stop_requested{ false };
+  std::chrono::steady_clock::time_point stop_deadline;  // Written before stop_requested is set
+
+  // Writer thread: writes encoded frames to file
+  std::jthread writer_thread;
+  std::mutex write_mutex;
+  std::condition_variable write_ready;
+  std::deque<std::vector<std::byte>> pending_writes;
+  bool writer_stopping{ false };
+
+  // Instrumentation
+  std::atomic_uint64_t submitted_count{ 0 };
+  std::atomic_uint64_t dropped_count{ 0 };
+  std::atomic_uint64_t encoded_count{ 0 };
+  std::atomic_uint64_t written_bytes{ 0 };
+  DurationHistogram hold_time;
+
+  // Setup methods
+  void openEncoder();
+  void openOutput();
+  void configure(const ImageFrame& frame);
+  void setControl(std::uint32_t id, std::int32_t value) const;
+  void mapBitstreamBuffers();
+
+  // Runtime methods
+  auto queueInput(const ImageFrame& frame, std::uint32_t index) const -> bool;
+  void queueBitstreamBuffer(std::uint32_t index) const;
+  void serviceLoop();
+  void releaseInputs();
+  auto collectBitstream() -> bool;
+  void writerLoop();
+  void shutdown();
+};
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::openEncoder() {
+  encoder_fd = open(config.device.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);  // NOLINT(*-vararg)
+  if (encoder_fd < 0) {
+    throw std::runtime_error("Failed to open encoder device " + config.device);
+  }
+  auto caps = v4l2_capability{};
+  if ((xioctl(encoder_fd, VIDIOC_QUERYCAP, &caps) < 0) ||
+      ((caps.device_caps & V4L2_CAP_VIDEO_M2M_MPLANE) == 0)) {
+    throw std::runtime_error("Not a multi-planar memory-to-memory device: " + config.device);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::openOutput() {
+  if (config.output_path.empty()) {
+    return;
+  }
+  static constexpr auto FILE_MODE = 0644;
+  output_fd = open(config.output_path.c_str(),  // NOLINT(*-vararg)
+                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, FILE_MODE);
+  if (output_fd < 0) {
+    throw std::runtime_error("Failed to open output file " + config.output_path);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::setControl(std::uint32_t id, std::int32_t value) const {
+  auto control = v4l2_control{ .id = id, .value = value };
+  if (xioctl(encoder_fd, VIDIOC_S_CTRL, &control) < 0) {
+    std::println(stderr, "Warning: Encoder control {:#x} not supported: {}", id,
+                 std::strerror(errno));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::configure(const ImageFrame& frame) {
+  pixel_format = toV4l2PixelFormat(frame.header.format);
+  if (pixel_format == 0) {
+    throw std::runtime_error("Unsupported pixel format for encoding");
+  }
+  image_bytes = contiguousImageSize(frame);
+  if ((frame.planes[0].fd < 0) || (image_bytes == 0)) {
+    throw std::runtime_error("Encoding needs frames with contiguous planes in one dmabuf");
+  }
+  image_size = frame.header.size;
+  stride = frame.planes[0].stride;
+
+  // Input: camera frames, imported by dmabuf
+  auto input_format = v4l2_format{};
+  input_format.type = INPUT_TYPE;
+  auto& input_pix = input_format.fmt.pix_mp;  // NOLINT(*-union-access)
+  input_pix.width = image_size.width;
+  input_pix.height = image_size.height;
+  input_pix.pixelformat = pixel_format;
+  input_pix.field = V4L2_FIELD_NONE;
+  input_pix.num_planes = 1;
+  input_pix.plane_fmt[0].bytesperline = stride;
+  input_pix.plane_fmt[0].sizeimage = static_cast<std::uint32_t>(image_bytes);
+  setColorSpace(input_pix, frame.header.color_space);
+  if (xioctl(encoder_fd, VIDIOC_S_FMT, &input_format) < 0) {
+    throw std::runtime_error("Failed to set encoder input format");
+  }
+  if ((input_pix.pixelformat != pixel_format) || (input_pix.plane_fmt[0].bytesperline != stride)) {
+    throw std::runtime_error("Encoder does not accept the camera's pixel format or row stride");
+  }
+
+  // Output: encoded frames
+  auto output_format = v4l2_format{};
+  output_format.type = OUTPUT_TYPE;
+  auto& output_pix = output_format.fmt.pix_mp;  // NOLINT(*-union-access)
+  output_pix.width = image_size.width;
+  output_pix.height = image_size.height;
+  output_pix.pixelformat =
+      (config.codec == Codec::Hevc) ? V4L2_PIX_FMT_HEVC : V4L2_PIX_FMT_H264;
+  output_pix.field = V4L2_FIELD_NONE;
+  output_pix.num_planes = 1;
+  output_pix.plane_fmt[0].sizeimage = static_cast<std::uint32_t>(
+      std::max(MIN_BITSTREAM_BUFFER_SIZE, static_cast<std::size_t>(stride) * image_size.height));
+  if (xioctl(encoder_fd, VIDIOC_S_FMT, &output_format) < 0) {
+    throw std::runtime_error("Failed to set encoder output format (codec not supported?)");
+  }
+
+  auto parm = v4l2_streamparm{};
+  parm.type = INPUT_TYPE;
+  parm.parm.output.timeperframe = { .numerator = 1, .denominator = config.frame_rate };
+  std::ignore = xioctl(encoder_fd, VIDIOC_S_PARM, &parm);  // Optional, rate control hint only
+
+  setControl(V4L2_CID_MPEG_VIDEO_BITRATE, static_cast<std::int32_t>(config.bitrate));
+  setControl(V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, 1);
+  if (config.codec == Codec::H264) {
+    setControl(V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, static_cast<std::int32_t>(config.intra_period));
+  } else {
+    setControl(V4L2_CID_MPEG_VIDEO_GOP_SIZE, static_cast<std::int32_t>(config.intra_period));
+  }
+
+  auto input_request = v4l2_requestbuffers{};
+  input_request.count = config.input_buffer_count;
+  input_request.type = INPUT_TYPE;
+  input_request.memory = V4L2_MEMORY_DMABUF;
+  if ((xioctl(encoder_fd, VIDIOC_REQBUFS, &input_request) < 0) || (input_request.count == 0)) {
+    throw std::runtime_error("Failed to allocate encoder input buffers");
+  }
+  inputs = std::vector<InputSlot>(input_request.count);
+
+  mapBitstreamBuffers();
+
+  auto input_type = static_cast<int>(INPUT_TYPE);
+  auto output_type = static_cast<int>(OUTPUT_TYPE);
+  if ((xioctl(encoder_fd, VIDIOC_STREAMON, &output_type) < 0) ||
+      (xioctl(encoder_fd, VIDIOC_STREAMON, &input_type) < 0)) {
+    throw std::runtime_error("Failed to start encoder");
+  }
+  configured = true;
+  service_thread = std::jthread([this] { serviceLoop(); });
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::mapBitstreamBuffers() {
+  auto request = v4l2_requestbuffers{};
+  request.count = config.output_buffer_count;
+  request.type = OUTPUT_TYPE;
+  request.memory = V4L2_MEMORY_MMAP;
+  if ((xioctl(encoder_fd, VIDIOC_REQBUFS, &request) < 0) || (request.count == 0)) {
+    throw std::runtime_error("Failed to allocate encoder output buffers");
+  }
+  for (std::uint32_t i = 0; i < request.count; ++i) {
+    auto plane = v4l2_plane{};
+    auto buffer = v4l2_buffer{};
+    buffer.type = OUTPUT_TYPE;
+    buffer.memory = V4L2_MEMORY_MMAP;
+    buffer.index = i;
+    buffer.length = 1;
+    buffer.m.planes = &plane;  // NOLINT(*-union-access)
+    if (xioctl(encoder_fd, VIDIOC_QUERYBUF, &buffer) < 0) {
+      throw std::runtime_error("Failed to query encoder output buffer");
+    }
+    auto* memory = mmap(nullptr, plane.length, PROT_READ | PROT_WRITE, MAP_SHARED, encoder_fd,
+                        plane.m.mem_offset);  // NOLINT(*-union-access)
+    if (memory == MAP_FAILED) {
+      throw std::runtime_error("Failed to map encoder output buffer");
+    }
+    bitstream_buffers.push_back({ .memory = memory, .length = plane.length });
+    queueBitstreamBuffer(i);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Recorder::Impl::queueInput(const ImageFrame& frame, std::uint32_t index) const -> bool {
+  // The dmabuf is imported whole, so its length is that of the underlying buffer
+  const auto dmabuf_size = lseek(frame.planes[0].fd, 0, SEEK_END);
+  if (dmabuf_size < 0) {
+    return false;
+  }
+  const auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(
+      frame.header.timestamp.time_since_epoch());
+  static constexpr auto US_PER_SECOND = 1'000'000;
+
+  auto plane = v4l2_plane{};
+  plane.m.fd = frame.planes[0].fd;  // NOLINT(*-union-access)
+  plane.length = static_cast<std::uint32_t>(dmabuf_size);
+  plane.data_offset = frame.planes[0].offset;
+  plane.bytesused = static_cast<std::uint32_t>(frame.planes[0].offset + image_bytes);
+
+  auto buffer = v4l2_buffer{};
+  buffer.type = INPUT_TYPE;
+  buffer.memory = V4L2_MEMORY_DMABUF;
+  buffer.index = index;
+  buffer.field = V4L2_FIELD_NONE;
+  buffer.length = 1;
+  buffer.m.planes = &plane;  // NOLINT(*-union-access)
+  buffer.timestamp = { .tv_sec = since_epoch.count() / US_PER_SECOND,
+                       .tv_usec = since_epoch.count() % US_PER_SECOND };
+  return xioctl(encoder_fd, VIDIOC_QBUF, &buffer) == 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::queueBitstreamBuffer(std::uint32_t index) const {
+  auto plane = v4l2_plane{};
+  auto buffer = v4l2_buffer{};
+  buffer.type = OUTPUT_TYPE;
+  buffer.memory = V4L2_MEMORY_MMAP;
+  buffer.index = index;
+  buffer.length = 1;
+  buffer.m.planes = &plane;  // NOLINT(*-union-access)
+  if (xioctl(encoder_fd, VIDIOC_QBUF, &buffer) < 0) {
+    std::println(stderr, "Warning: Failed to queue encoder output buffer: {}",
+                 std::strerror(errno));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::serviceLoop() {
+  auto pfd = pollfd{ .fd = encoder_fd, .events = POLLIN | POLLOUT, .revents = 0 };
+  auto last_received = false;
+  while (not last_received) {
+    if (stop_requested.load(std::memory_order_acquire) &&
+        (std::chrono::steady_clock::now() > stop_deadline)) {
+      break;
+    }
+    const auto ret = poll(&pfd, 1, POLL_TIMEOUT_MS);
+    if ((ret < 0) && (errno != EINTR)) {
+      std::println(stderr, "Warning: Polling encoder failed: {}", std::strerror(errno));
+      break;
+    }
+    if (ret <= 0) {
+      continue;
+    }
+    if ((pfd.revents & POLLOUT) != 0) {
+      releaseInputs();
+    }
+    if ((pfd.revents & POLLIN) != 0) {
+      last_received = collectBitstream();
+    }
+    if ((pfd.revents & POLLERR) != 0) {
+      // No buffers queued on either side. Nothing to do until the caller queues a frame
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::releaseInputs() {
+  while (true) {
+    auto plane = v4l2_plane{};
+    auto buffer = v4l2_buffer{};
+    buffer.type = INPUT_TYPE;
+    buffer.memory = V4L2_MEMORY_DMABUF;
+    buffer.length = 1;
+    buffer.m.planes = &plane;  // NOLINT(*-union-access)
+    if (xioctl(encoder_fd, VIDIOC_DQBUF, &buffer) < 0) {
+      return;  // EAGAIN: nothing more to release
+    }
+    auto released = FrameHandle{};  // Returned to the camera outside the lock
+    {
+      const auto lock = std::scoped_lock(input_mutex);
+      auto& slot = inputs.at(buffer.index);
+      hold_time.record(std::chrono::steady_clock::now() - slot.queued_at);
+      released = std::move(slot.handle);
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Recorder::Impl::collectBitstream() -> bool {
+  while (true) {
+    auto plane = v4l2_plane{};
+    auto buffer = v4l2_buffer{};
+    buffer.type = OUTPUT_TYPE;
+    buffer.memory = V4L2_MEMORY_MMAP;
+    buffer.length = 1;
+    buffer.m.planes = &plane;  // NOLINT(*-union-access)
+    if (xioctl(encoder_fd, VIDIOC_DQBUF, &buffer) < 0) {
+      return false;  // EAGAIN: no more encoded frames
+    }
+    const auto& mapping = bitstream_buffers.at(buffer.index);
+    if (plane.bytesused > plane.data_offset) {
+      const auto bytes = std::span(static_cast<const std::byte*>(mapping.memory), mapping.length)
+                             .subspan(plane.data_offset, plane.bytesused - plane.data_offset);
+      if (config.on_encoded) {
+        // The encoder copies input timestamps to the frames encoded from them
+        const auto timestamp = SensorClock::time_point{
+          std::chrono::seconds{ buffer.timestamp.tv_sec } +
+          std::chrono::microseconds{ buffer.timestamp.tv_usec }
+        };
+        config.on_encoded(bytes, timestamp, (buffer.flags & V4L2_BUF_FLAG_KEYFRAME) != 0);
+      }
+      if (output_fd >= 0) {
+        {
+          const auto lock = std::scoped_lock(write_mutex);
+          pending_writes.emplace_back(bytes.begin(), bytes.end());
+        }
+        write_ready.notify_one();
+      }
+      encoded_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if ((buffer.flags & V4L2_BUF_FLAG_LAST) != 0) {
+      return true;  // Drained after V4L2_ENC_CMD_STOP
+    }
+    queueBitstreamBuffer(buffer.index);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::writerLoop() {
+  auto failed = false;
+  while (true) {
+    auto chunk = std::vector<std::byte>{};
+    {
+      auto lock = std::unique_lock(write_mutex);
+      write_ready.wait(lock, [this] { return writer_stopping || not pending_writes.empty(); });
+      if (pending_writes.empty()) {
+        return;  // Stopping, and everything was written
+      }
+      chunk = std::move(pending_writes.front());
+      pending_writes.pop_front();
+    }
+    auto remaining = std::span(chunk);
+    while (not remaining.empty() && not failed) {
+      const auto ret = write(output_fd, remaining.data(), remaining.size());
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::println(stderr, "Warning: Writing recording failed, discarding further output: {}",
+                     std::strerror(errno));
+        failed = true;
+        break;
+      }
+      written_bytes.fetch_add(static_cast<std::uint64_t>(ret), std::memory_order_relaxed);
+      remaining = remaining.subspan(static_cast<std::size_t>(ret));
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void Recorder::Impl::shutdown() {
+  if (configured) {
+    // Ask the encoder to flush frames in flight, and give it a moment to do so
+    auto command = v4l2_encoder_cmd{};
+    command.cmd = V4L2_ENC_CMD_STOP;
+    const auto draining = (xioctl(encoder_fd, VIDIOC_ENCODER_CMD, &command) == 0);
+    stop_deadline = std::chrono::steady_clock::now() +
+                    (draining ? std::chrono::steady_clock::duration(DRAIN_TIMEOUT)
+                              : std::chrono::steady_clock::duration::zero());
+    stop_requested.store(true, std::memory_order_release);
+    service_thread = {};  // joins
+
+    // Return all buffers. Frames the encoder still held go back to the camera
+    auto input_type = static_cast<int>(INPUT_TYPE);
+    auto output_type = static_cast<int>(OUTPUT_TYPE);
+    std::ignore = xioctl(encoder_fd, VIDIOC_STREAMOFF, &input_type);
+    std::ignore = xioctl(encoder_fd, VIDIOC_STREAMOFF, &output_type);
+    inputs.clear();
+  }
+
+  for (const auto& mapping : bitstream_buffers) {
+    munmap(mapping.memory, mapping.length);
+  }
+  bitstream_buffers.clear();
+  if (encoder_fd >= 0) {
+    close(encoder_fd);
+  }
+
+  {
+    const auto lock = std::scoped_lock(write_mutex);
+    writer_stopping = true;
+  }
+  write_ready.notify_one();
+  writer_thread = {};  // joins after writing everything queued
+  if (output_fd >= 0) {
+    close(output_fd);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+Recorder::Recorder(const Config& config) : impl_(std::make_unique<Impl>()) {
+  impl_->config = config;
+  try {
+    impl_->openEncoder();
+    impl_->openOutput();
+    impl_->writer_thread = std::jthread([impl = impl_.get()] { impl->writerLoop(); });
+  } catch (...) {
+    impl_->shutdown();
+    throw;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+Recorder::~Recorder() {
+  impl_->shutdown();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Recorder::encode(FrameHandle&& handle, std::size_t stream) -> bool {
+  const auto& frame = handle.frame(stream);
+  if (not impl_->configured) {
+    impl_->configure(frame);
+  } else if ((frame.header.size != impl_->image_size) ||
+             (toV4l2PixelFormat(frame.header.format) != impl_->pixel_format) ||
+             (frame.planes[0].stride != impl_->stride)) {
+    std::println(stderr, "Warning: Frame format changed during recording. Frame dropped");
+    impl_->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Held across queueing, so that the service thread cannot release the slot before it is filled
+  const auto lock = std::scoped_lock(impl_->input_mutex);
+  const auto free_slot = std::ranges::find_if(
+      impl_->inputs, [](const Impl::InputSlot& slot) { return not slot.handle; });
+  if ((free_slot == impl_->inputs.end()) ||
+      not impl_->queueInput(frame, static_cast<std::uint32_t>(free_slot - impl_->inputs.begin()))) {
+    impl_->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  free_slot->handle = std::move(handle);
+  free_slot->queued_at = std::chrono::steady_clock::now();
+  impl_->submitted_count.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto Recorder::stats() const -> Stats {
+  return { .submitted = impl_->submitted_count.load(std::memory_order_relaxed),
+           .dropped = impl_->dropped_count.load(std::memory_order_relaxed),
+           .encoded = impl_->encoded_count.load(std::memory_order_relaxed),
+           .written = impl_->written_bytes.load(std::memory_order_relaxed),
+           .hold_time = impl_->hold_time.snapshot() };
+}
+
+}  // namespace picam
@@ -0,0 +1,109 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "frame_handle.h"
+#include "stats.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Hardware video recorder using a V4L2 memory-to-memory encoder (e.g. the Raspberry Pi's
+/// bcm2835-codec). Camera dmabufs are queued to the encoder as-is (V4L2_MEMORY_DMABUF), so pixels
+/// are never copied. Each frame's handle is held until the encoder releases the buffer, and only
+/// then returned to the camera. The encoded elementary stream is written to file on a separate
+/// thread, so slow storage never blocks the caller.
+///
+/// The encoder is configured from the first frame. Supported input formats are NV12 and YUV420
+/// with contiguous planes in one dmabuf, as produced by the Raspberry Pi ISP. The recorder must be
+/// destroyed before the Camera whose frames it holds
+class Recorder {
+public:
+  /// Receives each encoded frame (an access unit in Annex B format) with the sensor timestamp of
+  /// the capture it was encoded from. The data is only valid during the call
+  using EncodedCallback = std::function<void(std::span<const std::byte> access_unit,
+                                             SensorClock::time_point timestamp, bool key_frame)>;
+
+  enum class Codec : std::uint8_t {
+    H264,  //!< H.264/AVC
+    Hevc   //!< H.265/HEVC
+  };
+
+  struct Config {
+    /// Encoder device node
+    std::string device{ "/dev/video11" };
+
+    /// Output file. Written as an Annex B elementary stream (.h264/.h265), playable with ffplay
+    /// and muxable into MP4 without re-encoding (e.g. ffmpeg -c copy). If empty, nothing is
+    /// written to file
+    std::string output_path;
+
+    /// Called on the encoder service thread for every encoded frame, e.g. to stream it with
+    /// RtpSender. Must not block, or the encoder stalls and holds on to capture buffers
+    EncodedCallback on_encoded{ nullptr };
+
+    /// Compression standard
+    Codec codec{ Codec::H264 };
+
+    /// Target bit rate (bits per second)
+    std::uint32_t bitrate{ 10'000'000 };
+
+    /// Nominal frame rate (frames per second), used by the encoder's rate control
+    std::uint32_t frame_rate{ 30 };
+
+    /// Frames between key frames. Sequence headers are repeated with every key frame so that the
+    /// recording can be cut or played from any key frame
+    std::uint32_t intra_period{ 30 };
+
+    /// Frames that can be held by the encoder at once. Keep below the number of capture buffers,
+    /// or the camera runs out of buffers while the encoder catches up
+    std::uint32_t input_buffer_count{ 2 };
+
+    /// Encoded frame buffers shared with the encoder
+    std::uint32_t output_buffer_count{ 4 };
+  };
+
+  /// Recording instrumentation. Always on; counters are updated with relaxed atomics
+  struct Stats {
+    std::uint64_t submitted{};  //!< Frames queued to the encoder
+    std::uint64_t dropped{};    //!< Frames not recorded because the encoder was busy
+    std::uint64_t encoded{};    //!< Encoded frames received from the encoder
+    std::uint64_t written{};    //!< Bytes written to the output file
+    DurationStats hold_time;    //!< Time the encoder held on to a capture buffer
+  };
+
+  /// Open the encoder and the output file
+  /// @param config Recorder configuration
+  explicit Recorder(const Config& config);
+
+  /// Queue a frame for encoding without blocking. Pass a clone to keep using the frame elsewhere
+  /// @param handle Capture to encode. Released once the encoder is done with its buffer
+  /// @param stream Index of the stream to record, in Camera::Config::streams
+  /// @return false if the frame was dropped because all input buffers are in use by the encoder
+  auto encode(FrameHandle&& handle, std::size_t stream = 0) -> bool;
+
+  /// @return Snapshot of recording statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  /// Flushes frames still in the encoder to file
+  ~Recorder();
+  Recorder(const Recorder&) = delete;
+  Recorder(Recorder&&) = delete;
+  auto operator=(const Recorder&) = delete;
+  auto operator=(Recorder&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
@@ -0,0 +1,372 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "rtp_sender.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <print>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// NOLINTBEGIN(*-pointer-arithmetic)
+
+namespace picam {
+
+namespace {
+
+constexpr auto RTP_HEADER_SIZE = std::size_t{ 12 };
+constexpr auto RTP_VERSION = std::uint8_t{ 2 };
+constexpr auto RTP_CLOCK_RATE = std::int64_t{ 90'000 };
+
+// RTP header fields (RFC 3550, section 5.1)
+constexpr auto RTP_VERSION_SHIFT = 6U;
+constexpr auto RTP_MARKER_BIT = std::uint8_t{ 0x80 };
+constexpr auto RTP_PAYLOAD_TYPE_MASK = std::uint8_t{ 0x7F };
+constexpr auto RTP_SEQUENCE_OFFSET = std::size_t{ 2 };
+constexpr auto RTP_TIMESTAMP_OFFSET = std::size_t{ 4 };
+constexpr auto RTP_SSRC_OFFSET = std::size_t{ 8 };
+
+// Kernel limits of a UDP GSO send: segment count (UDP_MAX_SEGMENTS) and datagram size
+constexpr auto MAX_GSO_SEGMENTS = std::size_t{ 64 };
+constexpr auto MAX_GSO_BYTES = std::size_t{ 65'000 };
+
+// Socket buffer sized for bursts of key frames, so that a frame is rarely cut short
+constexpr auto SEND_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// Fragmentation unit NAL types
+constexpr auto H264_FU_A = std::uint8_t{ 28 };
+constexpr auto HEVC_FU = std::uint8_t{ 49 };
+constexpr auto FU_START = std::uint8_t{ 0x80 };
+constexpr auto FU_END = std::uint8_t{ 0x40 };
+
+// NAL header fields kept in fragmentation units: F and NRI bits of H.264 (RFC 6184, section
+// 5.8), F and layer id MSB of H.265 (RFC 7798, section 4.4.3), whose type sits above bit 0
+constexpr auto H264_NAL_TYPE_MASK = std::uint8_t{ 0x1F };
+constexpr auto H264_NAL_KEPT_BITS = std::uint8_t{ 0xE0 };
+constexpr auto HEVC_NAL_TYPE_MASK = std::uint8_t{ 0x3F };
+constexpr auto HEVC_NAL_KEPT_BITS = std::uint8_t{ 0x81 };
+constexpr auto HEVC_NAL_TYPE_SHIFT = 1U;
+
+//-------------------------------------------------------------------------------------------------
+// Store a value in network byte order
+template <typename T>
+void storeBigEndian(T value, std::uint8_t* dst) {
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    dst[i] = static_cast<std::uint8_t>(value >> (CHAR_BIT * (sizeof(T) - 1 - i)));
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// Split an Annex B byte stream into NAL units, without start codes and trailing zero bytes
+void splitNalUnits(std::span<const std::uint8_t> stream,
+                   std::vector<std::span<const std::uint8_t>>& units) {
+  units.clear();
+  // @return Position just after the start code at or after 'from', or stream.size() if none
+  const auto next_unit = [&stream](std::size_t from) {
+    for (auto i = from; i + 2 < stream.size(); ++i) {
+      if ((stream[i] == 0) && (stream[i + 1] == 0) && (stream[i + 2] == 1)) {
+        return i + 3;
+      }
+    }
+    return stream.size();
+  };
+  auto begin = next_unit(0);
+  while (begin < stream.size()) {
+    const auto next = next_unit(begin);
+    auto end = (next < stream.size()) ? next - 3 : stream.size();
+    while ((end > begin) && (stream[end - 1] == 0)) {
+      --end;  // Leading byte of a 4-byte start code or trailing_zero_8bits
+    }
+    if (end > begin) {
+      units.push_back(stream.subspan(begin, end - begin));
+    }
+    begin = next;
+  }
+}
+
+}  // namespace
+
+//=================================================================================================
+struct RtpSender::Impl {
+  Config config;
+  int socket_fd{ -1 };
+  bool gso_enabled{ false };
+  std::uint16_t sequence{};
+  std::uint32_t ssrc{};
+
+  // Datagram in 'staging'. With a segment size, the kernel splits it into packets of that size
+  struct Message {
+    std::size_t offset{};
+    std::size_t length{};
+    std::uint16_t segment_size{};
+  };
+  using ControlBuffer = std::array<std::uint8_t, CMSG_SPACE(sizeof(std::uint16_t))>;
+
+  // Reused between frames, so that sending does not allocate once buffers have grown
+  std::vector<std::span<const std::uint8_t>> nal_units;
+  std::vector<std::uint8_t> staging;
+  std::vector<Message> messages;
+  std::vector<mmsghdr> headers;
+  std::vector<iovec> iovecs;
+  std::vector<ControlBuffer> controls;
+
+  // Instrumentation
+  std::atomic_uint64_t frame_count{ 0 };
+  std::atomic_uint64_t packet_count{ 0 };
+  std::atomic_uint64_t byte_count{ 0 };
+  std::atomic_uint64_t error_count{ 0 };
+  DurationHistogram send_time;
+
+  void openSocket();
+  auto appendPacket(std::uint32_t timestamp, bool marker, std::size_t payload_size)
+      -> std::uint8_t*;
+  void packetize(std::span<const std::uint8_t> nal, std::uint32_t timestamp, bool last);
+  auto transmit() -> bool;
+};
+
+//-------------------------------------------------------------------------------------------------
+void RtpSender::Impl::openSocket() {
+  auto hints = addrinfo{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_NUMERICSERV;
+  addrinfo* result = nullptr;
+  const auto service = std::to_string(config.port);
+  if (getaddrinfo(config.host.c_str(), service.c_str(), &hints, &result) != 0) {
+    throw std::runtime_error("Failed to resolve streaming destination " + config.host);
+  }
+  for (const auto* info = result; info != nullptr; info = info->ai_next) {
+    socket_fd = socket(info->ai_family, info->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       info->ai_protocol);
+    if (socket_fd < 0) {
+      continue;
+    }
+    // Connected, so that messages need no address and ICMP errors are reported
+    if (connect(socket_fd, info->ai_addr, info->ai_addrlen) == 0) {
+      break;
+    }
+    close(socket_fd);
+    socket_fd = -1;
+  }
+  freeaddrinfo(result);
+  if (socket_fd < 0) {
+    throw std::runtime_error("Failed to open streaming socket to " + config.host);
+  }
+
+  std::ignore = setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &SEND_BUFFER_SIZE,
+                           sizeof(SEND_BUFFER_SIZE));
+  if (config.use_gso) {
+    // Setting a segment size of 0 (off) only succeeds on kernels that know the option
+    auto segment_size = 0;
+    gso_enabled =
+        (setsockopt(socket_fd, SOL_UDP, UDP_SEGMENT, &segment_size, sizeof(segment_size)) == 0);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto RtpSender::Impl::appendPacket(std::uint32_t timestamp, bool marker, std::size_t payload_size)
+    -> std::uint8_t* {
+  const auto offset = staging.size();
+  staging.resize(offset + RTP_HEADER_SIZE + payload_size);
+  auto* packet = &staging[offset];
+  packet[0] = RTP_VERSION << RTP_VERSION_SHIFT;
+  packet[1] = static_cast<std::uint8_t>((marker ? RTP_MARKER_BIT : 0U) |
+                                        (config.payload_type & RTP_PAYLOAD_TYPE_MASK));
+  storeBigEndian(sequence, &packet[RTP_SEQUENCE_OFFSET]);
+  storeBigEndian(timestamp, &packet[RTP_TIMESTAMP_OFFSET]);
+  storeBigEndian(ssrc, &packet[RTP_SSRC_OFFSET]);
+  ++sequence;
+  return &packet[RTP_HEADER_SIZE];
+}
+
+//-------------------------------------------------------------------------------------------------
+void RtpSender::Impl::packetize(std::span<const std::uint8_t> nal, std::uint32_t timestamp,
+                                bool last) {
+  const auto max_payload = config.max_packet_size - RTP_HEADER_SIZE;
+
+  if (nal.size() <= max_payload) {
+    const auto offset = staging.size();
+    auto* payload = appendPacket(timestamp, last, nal.size());
+    std::ranges::copy(nal, payload);
+    messages.push_back({ .offset = offset, .length = staging.size() - offset, .segment_size = 0 });
+    return;
+  }
+
+  // Fragmentation units: the NAL header is replaced by a payload header and a FU header that
+  // carries the NAL type, followed by a slice of the NAL payload
+  const auto is_hevc = (config.payload == Payload::Hevc);
+  const auto nal_header_size = is_hevc ? 2U : 1U;
+  const auto fu_header_size = nal_header_size + 1U;
+  const auto fragment_size = max_payload - fu_header_size;
+  const auto body = nal.subspan(nal_header_size);
+  const auto fragment_count = (body.size() + fragment_size - 1) / fragment_size;
+  const auto segment_size = RTP_HEADER_SIZE + fu_header_size + fragment_size;
+  const auto segments_per_message =
+      gso_enabled ? std::min(MAX_GSO_SEGMENTS, MAX_GSO_BYTES / segment_size) : 1U;
+
+  for (std::size_t i = 0; i < fragment_count; ++i) {
+    const auto offset = staging.size();
+    const auto slice = body.subspan(i * fragment_size, std::min(fragment_size,
+                                                                body.size() - (i * fragment_size)));
+    const auto is_first = (i == 0);
+    const auto is_last = (i + 1 == fragment_count);
+    auto* payload = appendPacket(timestamp, last && is_last, fu_header_size + slice.size());
+    const auto flags = static_cast<std::uint8_t>((is_first ? FU_START : 0U) |
+                                                 (is_last ? FU_END : 0U));
+    if (is_hevc) {
+      // PayloadHdr keeps F and layer/TID bits of the NAL header; FU header carries the type
+      payload[0] = static_cast<std::uint8_t>((nal[0] & HEVC_NAL_KEPT_BITS) |
+                                             (HEVC_FU << HEVC_NAL_TYPE_SHIFT));
+      payload[1] = nal[1];
+      payload[2] = static_cast<std::uint8_t>(
+          flags | ((nal[0] >> HEVC_NAL_TYPE_SHIFT) & HEVC_NAL_TYPE_MASK));
+    } else {
+      // FU indicator keeps F and NRI bits of the NAL header; FU header carries the type
+      payload[0] = static_cast<std::uint8_t>((nal[0] & H264_NAL_KEPT_BITS) | H264_FU_A);
+      payload[1] = static_cast<std::uint8_t>(flags | (nal[0] & H264_NAL_TYPE_MASK));
+    }
+    std::ranges::copy(slice, &payload[fu_header_size]);
+
+    // Consecutive full-size fragments are sent as one GSO datagram. Only the last segment of a
+    // datagram may be shorter
+    if ((i % segments_per_message != 0) && (segments_per_message > 1)) {
+      messages.back().length += staging.size() - offset;
+    } else {
+      messages.push_back({ .offset = offset,
+                           .length = staging.size() - offset,
+                           .segment_size = static_cast<std::uint16_t>(
+                               (segments_per_message > 1) ? segment_size : 0U) });
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto RtpSender::Impl::transmit() -> bool {
+  const auto count = messages.size();
+  headers.assign(count, mmsghdr{});
+  iovecs.resize(count);
+  controls.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto& message = messages[i];
+    iovecs[i] = { .iov_base = &staging[message.offset], .iov_len = message.length };
+    auto& header = headers[i].msg_hdr;
+    header.msg_iov = &iovecs[i];
+    header.msg_iovlen = 1;
+    // A datagram of one segment needs no segmentation
+    if ((message.segment_size != 0) && (message.length > message.segment_size)) {
+      header.msg_control = controls[i].data();
+      header.msg_controllen = controls[i].size();
+      auto* control = CMSG_FIRSTHDR(&header);
+      control->cmsg_level = SOL_UDP;
+      control->cmsg_type = UDP_SEGMENT;
+      control->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+      std::memcpy(CMSG_DATA(control), &message.segment_size, sizeof(std::uint16_t));
+    }
+  }
+
+  auto sent = std::size_t{ 0 };
+  while (sent < count) {
+    const auto ret =
+        sendmmsg(socket_fd, &headers[sent], static_cast<unsigned int>(count - sent), 0);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (gso_enabled && (errno == EIO)) {
+        // The interface cannot checksum segmented datagrams. Later frames are sent without GSO
+        std::println(stderr, "Warning: UDP GSO not supported by the network interface");
+        gso_enabled = false;
+      }
+      return false;  // Rest of the frame is lost. Receivers recover at the next key frame
+    }
+    for (auto i = sent; i < sent + static_cast<std::size_t>(ret); ++i) {
+      const auto& message = messages[i];
+      const auto segments = (message.segment_size != 0)
+                                ? (message.length + message.segment_size - 1) / message.segment_size
+                                : 1U;
+      packet_count.fetch_add(segments, std::memory_order_relaxed);
+      byte_count.fetch_add(message.length, std::memory_order_relaxed);
+    }
+    sent += static_cast<std::size_t>(ret);
+  }
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+RtpSender::RtpSender(const Config& config) : impl_(std::make_unique<Impl>()) {
+  static constexpr auto MIN_PACKET_SIZE = RTP_HEADER_SIZE + 16U;
+  if (config.max_packet_size < MIN_PACKET_SIZE) {
+    throw std::invalid_argument("Packet size too small for RTP");
+  }
+  impl_->config = config;
+  auto random = std::random_device{};
+  impl_->ssrc = (config.ssrc != 0) ? config.ssrc : static_cast<std::uint32_t>(random());
+  impl_->sequence = static_cast<std::uint16_t>(random());  // Random start, as RFC 3550 suggests
+  impl_->openSocket();
+}
+
+//-------------------------------------------------------------------------------------------------
+RtpSender::~RtpSender() {
+  if (impl_->socket_fd >= 0) {
+    close(impl_->socket_fd);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void RtpSender::send(std::span<const std::byte> access_unit, SensorClock::time_point timestamp) {
+  const auto timer = ScopedTimer(impl_->send_time);
+  // NOLINTNEXTLINE(*-reinterpret-cast)
+  const auto stream = std::span(reinterpret_cast<const std::uint8_t*>(access_unit.data()),
+                                access_unit.size());
+  splitNalUnits(stream, impl_->nal_units);
+  if (impl_->nal_units.empty()) {
+    return;
+  }
+
+  // 90 kHz media clock. Wraps around, as RTP expects
+  const auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(
+      timestamp.time_since_epoch());
+  static constexpr auto US_PER_SECOND = std::int64_t{ 1'000'000 };
+  const auto rtp_timestamp =
+      static_cast<std::uint32_t>(since_epoch.count() * RTP_CLOCK_RATE / US_PER_SECOND);
+
+  impl_->staging.clear();
+  impl_->messages.clear();
+  for (std::size_t i = 0; i < impl_->nal_units.size(); ++i) {
+    impl_->packetize(impl_->nal_units[i], rtp_timestamp, i + 1 == impl_->nal_units.size());
+  }
+  if (impl_->transmit()) {
+    impl_->frame_count.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    impl_->error_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+auto RtpSender::stats() const -> Stats {
+  return { .frames = impl_->frame_count.load(std::memory_order_relaxed),
+           .packets = impl_->packet_count.load(std::memory_order_relaxed),
+           .bytes = impl_->byte_count.load(std::memory_order_relaxed),
+           .send_errors = impl_->error_count.load(std::memory_order_relaxed),
+           .send_time = impl_->send_time.snapshot() };
+}
+
+}  // namespace picam
+
+// NOLINTEND(*-pointer-arithmetic)
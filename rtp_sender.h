@@ -0,0 +1,89 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "image_frame.h"
+#include "stats.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Streams encoded video over RTP/UDP (RFC 6184 for H.264, RFC 7798 for H.265). NAL units larger
+/// than a packet are fragmented. All packets of a frame are sent with one sendmmsg() call, and
+/// fragments of a NAL unit are passed to the kernel as one UDP GSO buffer where supported, so
+/// the per-packet system call and stack traversal cost is paid once per frame. RTP timestamps are
+/// derived from the sensor timestamp (90 kHz clock), so receivers can align streams from several
+/// cameras. Typically fed from Recorder::Config::on_encoded
+class RtpSender {
+public:
+  enum class Payload : std::uint8_t {
+    H264,  //!< RFC 6184, packetization mode 1 (single NAL unit and FU-A)
+    Hevc   //!< RFC 7798 (single NAL unit and FU)
+  };
+
+  struct Config {
+    /// Destination address (IPv4 or IPv6, numeric or host name). Multicast addresses work too
+    std::string host{ "127.0.0.1" };
+
+    /// Destination UDP port
+    std::uint16_t port{ 5004 };
+
+    /// Codec of the encoded stream
+    Payload payload{ Payload::H264 };
+
+    /// RTP payload type (96-127 for dynamic types, to match the receiver's SDP)
+    std::uint8_t payload_type{ 96 };
+
+    /// RTP synchronisation source identifier. 0 selects a random one
+    std::uint32_t ssrc{ 0 };
+
+    /// Largest UDP payload, including the RTP header. The default leaves room for IP and UDP
+    /// headers and tunnels within a 1500 byte Ethernet MTU
+    std::size_t max_packet_size{ 1400 };
+
+    /// Use UDP generic segmentation offload for fragmented NAL units. Disabled automatically if
+    /// the kernel or network interface does not support it
+    bool use_gso{ true };
+  };
+
+  /// Streaming instrumentation
+  struct Stats {
+    std::uint64_t frames{};       //!< Access units sent
+    std::uint64_t packets{};      //!< RTP packets sent
+    std::uint64_t bytes{};        //!< UDP payload bytes sent
+    std::uint64_t send_errors{};  //!< Frames not (completely) sent
+    DurationStats send_time;      //!< Packetization and sending of a frame
+  };
+
+  /// Open a UDP socket to the destination
+  /// @param config Streaming configuration
+  explicit RtpSender(const Config& config);
+
+  /// Packetize and send an encoded frame. Not safe to call concurrently
+  /// @param access_unit One frame of encoded data in Annex B format (NAL units with start codes)
+  /// @param timestamp Sensor timestamp of the frame
+  void send(std::span<const std::byte> access_unit, SensorClock::time_point timestamp);
+
+  /// @return Snapshot of streaming statistics. Safe to call from any thread
+  [[nodiscard]] auto stats() const -> Stats;
+
+  ~RtpSender();
+  RtpSender(const RtpSender&) = delete;
+  RtpSender(RtpSender&&) = delete;
+  auto operator=(const RtpSender&) = delete;
+  auto operator=(RtpSender&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
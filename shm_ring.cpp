@@ -0,0 +1,302 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "shm_ring.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// NOLINTBEGIN(*-pointer-arithmetic,*-reinterpret-cast)
+
+namespace picam {
+
+namespace {
+
+// Layout of the shared memory object. Shared between processes, so only fixed-size types and
+// lock-free atomics (which are address-free)
+constexpr auto RING_MAGIC = std::uint32_t{ 0x4d414350 };  // "PCAM"
+constexpr auto LAYOUT_VERSION = std::uint32_t{ 2 };
+constexpr auto ALIGNMENT = std::size_t{ 64 };
+
+static_assert(std::atomic_uint64_t::is_always_lock_free);
+static_assert(std::atomic_uint32_t::is_always_lock_free);
+
+struct RingHeader {
+  std::atomic_uint32_t magic;  // Set last, once the ring is initialised
+  std::uint32_t layout_version;
+  std::uint32_t slot_count;
+  std::uint64_t slot_size;
+  std::uint64_t slot_stride;
+  std::atomic_uint64_t published;  // Index of the newest complete frame. 0 if none
+};
+
+struct SlotHeader {
+  std::atomic_uint64_t version;  // Sequence lock. Odd while the slot is written
+  std::uint64_t index;
+  std::int64_t timestamp_ns;
+  std::int64_t completion_time_ns;
+  std::uint32_t sequence;
+  std::uint32_t stream_id;
+  std::uint32_t pitch;
+  std::uint16_t width;
+  std::uint16_t height;
+  std::uint32_t format;
+  std::uint64_t format_modifier;
+  std::uint8_t encoding;
+  std::uint8_t range;
+  std::uint32_t plane_count;
+  std::array<std::uint32_t, ImageFrame::MAX_PLANES> strides;
+  std::array<std::uint64_t, ImageFrame::MAX_PLANES> offsets;  // Within the slot's pixel data
+  std::array<std::uint64_t, ImageFrame::MAX_PLANES> sizes;
+};
+
+constexpr auto alignUp(std::size_t value) -> std::size_t {
+  return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+constexpr auto RING_HEADER_SIZE = alignUp(sizeof(RingHeader));
+constexpr auto SLOT_HEADER_SIZE = alignUp(sizeof(SlotHeader));
+
+//=================================================================================================
+// Mapping of the shared memory object, with accessors for its parts
+struct RingMapping {
+  std::byte* base{ nullptr };
+  std::size_t length{};
+
+  [[nodiscard]] auto header() const -> RingHeader& {
+    return *reinterpret_cast<RingHeader*>(base);
+  }
+  [[nodiscard]] auto slotAt(std::uint64_t index) const -> SlotHeader& {
+    // Frame indices start at 1
+    const auto slot = (index - 1) % header().slot_count;
+    return *reinterpret_cast<SlotHeader*>(base + RING_HEADER_SIZE + (slot * header().slot_stride));
+  }
+  [[nodiscard]] auto pixels(const SlotHeader& slot) const -> std::byte* {
+    return reinterpret_cast<std::byte*>(const_cast<SlotHeader*>(&slot)) + SLOT_HEADER_SIZE;
+  }
+  void unmap() {
+    if (base != nullptr) {
+      munmap(base, length);
+      base = nullptr;
+    }
+  }
+};
+
+//-------------------------------------------------------------------------------------------------
+auto toNanoseconds(SensorClock::time_point time) -> std::int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto fromNanoseconds(std::int64_t ns) -> SensorClock::time_point {
+  return SensorClock::time_point{ std::chrono::nanoseconds{ ns } };
+}
+
+}  // namespace
+
+//=================================================================================================
+struct ShmRingWriter::Impl {
+  std::string name;
+  RingMapping mapping;
+  std::uint64_t next_index{ 1 };
+};
+
+//-------------------------------------------------------------------------------------------------
+ShmRingWriter::ShmRingWriter(const Config& config) : impl_(std::make_unique<Impl>()) {
+  if ((config.slot_count == 0) || (config.slot_size == 0)) {
+    throw std::invalid_argument("Shared memory ring needs at least one non-empty slot");
+  }
+  impl_->name = config.name;
+  const auto slot_stride = SLOT_HEADER_SIZE + alignUp(config.slot_size);
+  const auto length = RING_HEADER_SIZE + (slot_stride * config.slot_count);
+
+  // Replace a ring left behind by a previous run, so that its readers do not see a new layout
+  shm_unlink(config.name.c_str());
+  static constexpr auto FILE_MODE = 0644;
+  const auto fd = shm_open(config.name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, FILE_MODE);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to create shared memory object " + config.name);
+  }
+  const auto resized = (ftruncate(fd, static_cast<off_t>(length)) == 0);
+  auto* memory = resized ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                         : MAP_FAILED;
+  close(fd);  // The mapping keeps the object alive
+  if (memory == MAP_FAILED) {
+    shm_unlink(config.name.c_str());
+    throw std::runtime_error("Failed to map shared memory object " + config.name);
+  }
+  impl_->mapping = { .base = static_cast<std::byte*>(memory), .length = length };
+
+  // The object is zero-filled, so every slot starts at version 0 (unwritten)
+  auto* header = new (memory) RingHeader{};
+  header->layout_version = LAYOUT_VERSION;
+  header->slot_count = config.slot_count;
+  header->slot_size = config.slot_size;
+  header->slot_stride = slot_stride;
+  for (std::uint64_t i = 1; i <= config.slot_count; ++i) {
+    new (&impl_->mapping.slotAt(i)) SlotHeader{};
+  }
+  header->magic.store(RING_MAGIC, std::memory_order_release);
+}
+
+//-------------------------------------------------------------------------------------------------
+ShmRingWriter::~ShmRingWriter() {
+  impl_->mapping.unmap();
+  shm_unlink(impl_->name.c_str());
+}
+
+//-------------------------------------------------------------------------------------------------
+auto ShmRingWriter::publish(const ImageFrame& frame) -> bool {
+  const auto& mapping = impl_->mapping;
+  auto& ring = mapping.header();
+
+  // Pack planes at aligned offsets, and check that they fit before touching the slot
+  auto offsets = std::array<std::uint64_t, ImageFrame::MAX_PLANES>{};
+  auto total = std::size_t{ 0 };
+  for (std::uint32_t i = 0; i < frame.plane_count; ++i) {
+    if (frame.planes.at(i).data.empty()) {
+      return false;  // No CPU access to the pixels
+    }
+    offsets.at(i) = total;
+    total = alignUp(total + frame.planes.at(i).data.size());
+  }
+  if ((frame.plane_count == 0) || (total > ring.slot_size)) {
+    return false;
+  }
+
+  const auto index = impl_->next_index++;
+  auto& slot = mapping.slotAt(index);
+  const auto version = slot.version.load(std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);  // Readers see odd before any new data
+
+  const auto& header = frame.header;
+  slot.index = index;
+  slot.timestamp_ns = toNanoseconds(header.timestamp);
+  slot.completion_time_ns = toNanoseconds(header.completion_time);
+  slot.sequence = header.sequence;
+  slot.stream_id = header.stream_id;
+  slot.pitch = header.pitch;
+  slot.width = header.size.width;
+  slot.height = header.size.height;
+  slot.format = header.format;
+  slot.format_modifier = header.format_modifier;
+  slot.encoding = static_cast<std::uint8_t>(header.color_space.encoding);
+  slot.range = static_cast<std::uint8_t>(header.color_space.range);
+  slot.plane_count = frame.plane_count;
+  auto* pixels = mapping.pixels(slot);
+  for (std::uint32_t i = 0; i < frame.plane_count; ++i) {
+    const auto& plane = frame.planes.at(i);
+    slot.strides.at(i) = plane.stride;
+    slot.offsets.at(i) = offsets.at(i);
+    slot.sizes.at(i) = plane.data.size();
+    std::memcpy(pixels + offsets.at(i), plane.data.data(), plane.data.size());
+  }
+
+  slot.version.store(version + 2, std::memory_order_release);
+  ring.published.store(index, std::memory_order_release);
+  return true;
+}
+
+//=================================================================================================
+struct ShmRingReader::Impl {
+  RingMapping mapping;
+};
+
+//-------------------------------------------------------------------------------------------------
+ShmRingReader::ShmRingReader(const std::string& name) : impl_(std::make_unique<Impl>()) {
+  const auto fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open shared memory object " + name);
+  }
+  struct stat info {};
+  const auto length = (fstat(fd, &info) == 0) ? static_cast<std::size_t>(info.st_size) : 0U;
+  auto* memory = (length >= RING_HEADER_SIZE)
+                     ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0)
+                     : MAP_FAILED;
+  close(fd);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error("Failed to map shared memory object " + name);
+  }
+  impl_->mapping = { .base = static_cast<std::byte*>(memory), .length = length };
+
+  const auto& header = impl_->mapping.header();
+  if ((header.magic.load(std::memory_order_acquire) != RING_MAGIC) ||
+      (header.layout_version != LAYOUT_VERSION) || (header.slot_count == 0) ||
+      (RING_HEADER_SIZE + (header.slot_stride * header.slot_count) > length)) {
+    impl_->mapping.unmap();
+    throw std::runtime_error("Not a frame ring, or not initialised yet: " + name);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+ShmRingReader::~ShmRingReader() {
+  impl_->mapping.unmap();
+}
+
+//-------------------------------------------------------------------------------------------------
+auto ShmRingReader::latest(std::uint64_t after) const -> std::optional<Frame> {
+  const auto& mapping = impl_->mapping;
+  const auto index = mapping.header().published.load(std::memory_order_acquire);
+  if ((index == 0) || (index <= after)) {
+    return std::nullopt;
+  }
+  const auto& slot = mapping.slotAt(index);
+  const auto version = slot.version.load(std::memory_order_acquire);
+  if ((version % 2) != 0) {
+    return std::nullopt;  // Being rewritten: the reader fell a whole ring behind
+  }
+
+  auto result = Frame{ .frame = {}, .index = slot.index, .version = version };
+  auto& header = result.frame.header;
+  header.timestamp = fromNanoseconds(slot.timestamp_ns);
+  header.completion_time = fromNanoseconds(slot.completion_time_ns);
+  header.sequence = slot.sequence;
+  header.stream_id = slot.stream_id;
+  header.pitch = slot.pitch;
+  header.size = { .width = slot.width, .height = slot.height };
+  header.format = slot.format;
+  header.format_modifier = slot.format_modifier;
+  header.color_space = { .encoding = static_cast<ColorSpace::Encoding>(slot.encoding),
+                         .range = static_cast<ColorSpace::Range>(slot.range) };
+  const auto plane_count = std::min<std::uint32_t>(slot.plane_count, ImageFrame::MAX_PLANES);
+  auto* pixels = mapping.pixels(slot);
+  const auto slot_size = mapping.header().slot_size;
+  for (std::uint32_t i = 0; i < plane_count; ++i) {
+    const auto offset = slot.offsets.at(i);
+    const auto size = slot.sizes.at(i);
+    if ((offset > slot_size) || (size > slot_size - offset)) {
+      return std::nullopt;  // Torn read of the slot header
+    }
+    result.frame.planes.at(i) = { .data = std::span(pixels + offset, size),
+                                  .stride = slot.strides.at(i),
+                                  .fd = -1,
+                                  .offset = static_cast<std::uint32_t>(offset) };
+  }
+  result.frame.plane_count = plane_count;
+
+  if ((result.index != index) || not isIntact(result)) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto ShmRingReader::isIntact(const Frame& frame) const -> bool {
+  std::atomic_thread_fence(std::memory_order_acquire);  // Order reads of the slot before this
+  const auto& slot = impl_->mapping.slotAt(frame.index);
+  return slot.version.load(std::memory_order_relaxed) == frame.version;
+}
+
+}  // namespace picam
+
+// NOLINTEND(*-pointer-arithmetic,*-reinterpret-cast)
@@ -0,0 +1,95 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "image_frame.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Ring of frames in POSIX shared memory, for consumers in other processes on the same device.
+/// The writer copies each frame into the ring once; any number of readers then access it in place,
+/// so adding a consumer adds no copy. Readers never block the writer: slots are protected by
+/// sequence locks, and a reader that falls behind by more than the ring size sees its frame
+/// overwritten (detected with ShmRingReader::isIntact) rather than stalling capture
+class ShmRingWriter {
+public:
+  struct Config {
+    /// Name of the shared memory object, starting with '/' (see shm_open)
+    std::string name{ "/picam" };
+
+    /// Number of frames in the ring. Readers have this many frame periods to finish with a frame
+    std::uint32_t slot_count{ 4 };
+
+    /// Bytes of pixel data per slot. Frames larger than this are not published
+    std::size_t slot_size{ std::size_t{ 1920 } * 1080 * 2 };
+  };
+
+  /// Create (or replace) the shared memory object
+  /// @param config Ring configuration
+  explicit ShmRingWriter(const Config& config);
+
+  /// Copy a frame into the next slot and make it visible to readers. Not safe to call
+  /// concurrently. The frame must have CPU access to its pixels
+  /// @param frame Frame to publish
+  /// @return false if the frame does not fit in a slot
+  auto publish(const ImageFrame& frame) -> bool;
+
+  /// Removes the shared memory object. Readers that have it mapped keep their mapping
+  ~ShmRingWriter();
+  ShmRingWriter(const ShmRingWriter&) = delete;
+  ShmRingWriter(ShmRingWriter&&) = delete;
+  auto operator=(const ShmRingWriter&) = delete;
+  auto operator=(ShmRingWriter&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+//=================================================================================================
+/// Read side of ShmRingWriter. Frames are read-only views into shared memory. Pixels have no
+/// dmabuf descriptors (fd is -1)
+class ShmRingReader {
+public:
+  /// Frame in the ring
+  struct Frame {
+    ImageFrame frame;         //!< View of the frame. Pixel data must not be written to
+    std::uint64_t index{};    //!< Position in the stream of published frames, starting at 1
+    std::uint64_t version{};  //!< Version of the slot when taken, checked by isIntact()
+  };
+
+  /// Open an existing ring. Throws if it does not exist
+  /// @param name Name of the shared memory object, as given to the writer
+  explicit ShmRingReader(const std::string& name);
+
+  /// Take the newest published frame, if it is newer than a given one. Does not block or copy
+  /// @param after Index of the last frame seen. 0 accepts any frame
+  /// @return View of the newest frame, or nothing if there is no newer frame
+  [[nodiscard]] auto latest(std::uint64_t after = 0) const -> std::optional<Frame>;
+
+  /// Check, after reading the pixels of a frame, that the writer did not overwrite it meanwhile.
+  /// If it did, whatever was computed from the pixels must be discarded
+  /// @return true if the frame was intact throughout
+  [[nodiscard]] auto isIntact(const Frame& frame) const -> bool;
+
+  ~ShmRingReader();
+  ShmRingReader(const ShmRingReader&) = delete;
+  ShmRingReader(ShmRingReader&&) = delete;
+  auto operator=(const ShmRingReader&) = delete;
+  auto operator=(ShmRingReader&&) = delete;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam
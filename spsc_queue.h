@@ -0,0 +1,109 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+namespace picam {
+
+//=================================================================================================
+/// Bounded lock-free FIFO for a single producer thread and a single consumer thread.
+///
+/// In addition to the consumer, the producer may also pop (e.g. to discard the oldest element
+/// when the queue is full). Pops are arbitrated with a compare-and-swap on the read index, so an
+/// element is only ever handed out once.
+///
+/// @tparam T Trivially copyable element type (typically a pointer)
+template <typename T>
+class SpscQueue {
+  static_assert(std::is_trivially_copyable_v<T>, "Elements are stored in atomics");
+
+public:
+  /// @param capacity Maximum number of queued elements. Must be non-zero
+  explicit SpscQueue(std::size_t capacity);
+
+  /// Append an element. Producer only
+  /// @return false if the queue is full
+  auto tryPush(T value) -> bool;
+
+  /// Remove the oldest element. Safe to call from producer and consumer concurrently
+  /// @return The element, or nullopt if the queue is empty
+  auto tryPop() -> std::optional<T>;
+
+  /// @return Number of queued elements (a snapshot when called concurrently with push/pop)
+  [[nodiscard]] auto size() const -> std::size_t;
+
+  /// @return Maximum number of queued elements
+  [[nodiscard]] auto capacity() const -> std::size_t;
+
+private:
+  static constexpr auto CACHE_LINE_SIZE = std::size_t{ 64 };
+
+  std::size_t capacity_;
+  std::unique_ptr<std::atomic<T>[]> slots_;                         // NOLINT(*-avoid-c-arrays)
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> head_{ 0 };  // next element to pop
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> tail_{ 0 };  // next free slot
+};
+
+//-------------------------------------------------------------------------------------------------
+template <typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+  : capacity_(capacity)
+  , slots_(std::make_unique<std::atomic<T>[]>(capacity)) {  // NOLINT(*-avoid-c-arrays)
+  if (capacity == 0) {
+    throw std::invalid_argument("Queue capacity must be non-zero");
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+template <typename T>
+auto SpscQueue<T>::tryPush(T value) -> bool {
+  const auto tail = tail_.load(std::memory_order_relaxed);
+  // Acquire pairs with the release in tryPop, so the slot is no longer being read
+  if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+    return false;
+  }
+  slots_[tail % capacity_].store(value, std::memory_order_relaxed);
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+template <typename T>
+auto SpscQueue<T>::tryPop() -> std::optional<T> {
+  auto head = head_.load(std::memory_order_acquire);
+  while (true) {
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    // The slot can only be overwritten after head moves past it, which fails the exchange below
+    const auto value = slots_[head % capacity_].load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+      return value;
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+template <typename T>
+auto SpscQueue<T>::size() const -> std::size_t {
+  const auto head = head_.load(std::memory_order_acquire);
+  const auto tail = tail_.load(std::memory_order_acquire);
+  return (tail > head) ? static_cast<std::size_t>(tail - head) : 0U;
+}
+
+//-------------------------------------------------------------------------------------------------
+template <typename T>
+auto SpscQueue<T>::capacity() const -> std::size_t {
+  return capacity_;
+}
+
+}  // namespace picam
@@ -0,0 +1,112 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace picam {
+
+//=================================================================================================
+/// Snapshot of a DurationHistogram
+struct DurationStats {
+  /// Buckets are powers of two in microseconds: bucket i counts durations in [2^(i-1), 2^i) us,
+  /// bucket 0 counts durations below 1 us, and the last bucket collects everything above
+  static constexpr std::size_t BUCKET_COUNT = 24;
+
+  std::uint64_t count{};                              //!< Number of recorded durations
+  std::chrono::nanoseconds total{};                   //!< Sum of recorded durations
+  std::chrono::nanoseconds max{};                     //!< Longest recorded duration
+  std::array<std::uint64_t, BUCKET_COUNT> buckets{};  //!< Counts per bucket
+
+  /// @return Average duration, or zero if nothing was recorded
+  [[nodiscard]] constexpr auto mean() const -> std::chrono::nanoseconds {
+    if (count == 0) {
+      return {};
+    }
+    return std::chrono::nanoseconds{ total.count() / static_cast<std::int64_t>(count) };
+  }
+
+  /// @param fraction Quantile in [0, 1], e.g. 0.99 for the 99th percentile
+  /// @return Upper bound of the bucket containing the quantile (precise to a factor of two)
+  [[nodiscard]] constexpr auto percentile(double fraction) const -> std::chrono::nanoseconds {
+    const auto rank = static_cast<std::uint64_t>(std::clamp(fraction, 0.0, 1.0) *
+                                                 static_cast<double>(count));
+    auto seen = std::uint64_t{ 0 };
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+      seen += buckets.at(i);
+      if ((seen > rank) || ((seen == count) && (seen > 0))) {
+        const auto upper = std::chrono::nanoseconds{ std::chrono::microseconds{ 1LL << i } };
+        return std::min(max, upper);
+      }
+    }
+    return max;
+  }
+};
+
+//=================================================================================================
+/// Histogram of durations with power-of-two buckets. Recording is lock-free, wait-free and does
+/// not allocate, so it can stay enabled on hot paths. Safe to record from several threads and
+/// snapshot concurrently (the snapshot is not atomic as a whole, but every field is consistent on
+/// its own)
+class DurationHistogram {
+public:
+  void record(std::chrono::nanoseconds duration) noexcept {
+    const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+    const auto us = ns / 1000U;
+    const auto bucket =
+        std::min<std::size_t>(std::bit_width(us), DurationStats::BUCKET_COUNT - 1);
+    buckets_.at(bucket).fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(ns, std::memory_order_relaxed);
+    auto max = max_ns_.load(std::memory_order_relaxed);
+    while ((ns > max) && not max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  [[nodiscard]] auto snapshot() const noexcept -> DurationStats {
+    auto stats = DurationStats{};
+    stats.count = count_.load(std::memory_order_relaxed);
+    stats.total = std::chrono::nanoseconds{ total_ns_.load(std::memory_order_relaxed) };
+    stats.max = std::chrono::nanoseconds{ max_ns_.load(std::memory_order_relaxed) };
+    for (std::size_t i = 0; i < DurationStats::BUCKET_COUNT; ++i) {
+      stats.buckets.at(i) = buckets_.at(i).load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+private:
+  std::array<std::atomic_uint64_t, DurationStats::BUCKET_COUNT> buckets_{};
+  std::atomic_uint64_t count_{ 0 };
+  std::atomic_uint64_t total_ns_{ 0 };
+  std::atomic_uint64_t max_ns_{ 0 };
+};
+
+//=================================================================================================
+/// Records the time between construction and destruction into a histogram
+template <typename Clock = std::chrono::steady_clock>
+class ScopedTimer {
+public:
+  explicit ScopedTimer(DurationHistogram& histogram) noexcept
+    : histogram_(&histogram), start_(Clock::now()) {
+  }
+  ~ScopedTimer() {
+    histogram_->record(Clock::now() - start_);
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer(ScopedTimer&&) = delete;
+  auto operator=(const ScopedTimer&) = delete;
+  auto operator=(ScopedTimer&&) = delete;
+
+private:
+  DurationHistogram* histogram_;
+  typename Clock::time_point start_;
+};
+
+}  // namespace picam
@@ -0,0 +1,55 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "thread_config.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <print>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace picam {
+
+//-------------------------------------------------------------------------------------------------
+auto configureCurrentThread(const ThreadConfig& config, std::string_view name) -> bool {
+  auto ok = true;
+  const auto self = pthread_self();
+
+  if (not name.empty()) {
+    // Linux limits names to 16 bytes including the terminator
+    static constexpr auto MAX_NAME_LENGTH = 15U;
+    auto thread_name = std::array<char, MAX_NAME_LENGTH + 1>{};
+    std::ranges::copy(name.substr(0, MAX_NAME_LENGTH), thread_name.begin());
+    pthread_setname_np(self, thread_name.data());
+  }
+
+  if (not config.cpus.empty()) {
+    auto cpu_set = cpu_set_t{};
+    CPU_ZERO(&cpu_set);
+    for (const auto cpu : config.cpus) {
+      CPU_SET(cpu, &cpu_set);  // NOLINT(*-pointer-arithmetic)
+    }
+    const auto ret = pthread_setaffinity_np(self, sizeof(cpu_set), &cpu_set);
+    if (ret != 0) {
+      std::println(stderr, "Warning: Failed to pin thread '{}': {}", name, std::strerror(ret));
+      ok = false;
+    }
+  }
+
+  if (config.realtime_priority > 0) {
+    const auto param = sched_param{ .sched_priority = config.realtime_priority };
+    const auto ret = pthread_setschedparam(self, SCHED_FIFO, &param);
+    if (ret != 0) {
+      std::println(stderr, "Warning: Failed to set SCHED_FIFO priority {} on thread '{}': {}",
+                   config.realtime_priority, name, std::strerror(ret));
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+}  // namespace picam
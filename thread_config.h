@@ -0,0 +1,31 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace picam {
+
+//=================================================================================================
+/// Placement and scheduling of a thread
+struct ThreadConfig {
+  /// CPU cores the thread may run on. If empty, the thread is not pinned
+  std::vector<int> cpus{};
+
+  /// SCHED_FIFO priority (1-99). 0 keeps the default time-sharing scheduler. Needs
+  /// CAP_SYS_NICE or a suitable RLIMIT_RTPRIO
+  int realtime_priority{ 0 };
+};
+
+/// Apply placement and scheduling to the calling thread. Failures (e.g. missing privileges) are
+/// reported on stderr and otherwise ignored, so that an unprivileged run still works
+/// @param config Settings to apply
+/// @param name Thread name, for diagnostics and tools like top (truncated to 15 characters). If
+///             empty, the name is left unchanged
+/// @return true if all settings were applied
+auto configureCurrentThread(const ThreadConfig& config, std::string_view name) -> bool;
+
+}  // namespace picam
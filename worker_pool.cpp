@@ -0,0 +1,134 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <format>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace picam {
+
+//=================================================================================================
+struct WorkerPool::Impl {
+  std::vector<std::jthread> threads;
+
+  // Serialises jobs. Held by the submitting thread for the duration of a job
+  std::mutex job_mutex;
+
+  // Current job, published under 'state_mutex' by bumping 'generation'
+  std::mutex state_mutex;
+  std::condition_variable job_ready;
+  std::condition_variable job_done;
+  std::uint64_t generation{ 0 };
+  bool stopping{ false };
+  const void* context{ nullptr };
+  TaskFunction function{ nullptr };
+  std::size_t count{ 0 };
+  std::atomic_size_t next_index{ 0 };  // Work items are claimed dynamically to balance load
+  std::size_t active_workers{ 0 };     // Threads still inside the current job
+
+  void workerLoop();
+  void work() noexcept;
+};
+
+//-------------------------------------------------------------------------------------------------
+void WorkerPool::Impl::work() noexcept {
+  while (true) {
+    const auto index = next_index.fetch_add(1, std::memory_order_relaxed);
+    if (index >= count) {
+      return;
+    }
+    function(context, index);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+void WorkerPool::Impl::workerLoop() {
+  auto seen_generation = std::uint64_t{ 0 };
+  while (true) {
+    {
+      auto lock = std::unique_lock(state_mutex);
+      job_ready.wait(lock, [&] { return stopping || (generation != seen_generation); });
+      if (stopping) {
+        return;
+      }
+      seen_generation = generation;
+    }
+    work();
+    {
+      const auto lock = std::scoped_lock(state_mutex);
+      --active_workers;
+    }
+    job_done.notify_one();
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+WorkerPool::WorkerPool(std::size_t thread_count, const ThreadConfig& config)
+  : impl_(std::make_unique<Impl>()) {
+  impl_->threads.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    impl_->threads.emplace_back([this, i, config] {
+      configureCurrentThread(config, std::format("picam_pool{}", i));
+      impl_->workerLoop();
+    });
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+WorkerPool::~WorkerPool() {
+  {
+    const auto lock = std::scoped_lock(impl_->state_mutex);
+    impl_->stopping = true;
+  }
+  impl_->job_ready.notify_all();
+  impl_->threads.clear();  // joins
+}
+
+//-------------------------------------------------------------------------------------------------
+auto WorkerPool::shared() -> WorkerPool& {
+  static auto pool = WorkerPool(std::max(std::thread::hardware_concurrency(), 1U) - 1U);
+  return pool;
+}
+
+//-------------------------------------------------------------------------------------------------
+auto WorkerPool::concurrency() const -> std::size_t {
+  return impl_->threads.size() + 1U;
+}
+
+//-------------------------------------------------------------------------------------------------
+void WorkerPool::run(std::size_t count, const void* context, TaskFunction function) {
+  auto job_lock = std::unique_lock(impl_->job_mutex, std::try_to_lock);
+  if ((not job_lock.owns_lock()) || impl_->threads.empty() || (count < 2)) {
+    for (std::size_t i = 0; i < count; ++i) {
+      function(context, i);
+    }
+    return;
+  }
+
+  {
+    const auto lock = std::scoped_lock(impl_->state_mutex);
+    impl_->context = context;
+    impl_->function = function;
+    impl_->count = count;
+    impl_->next_index.store(0, std::memory_order_relaxed);
+    impl_->active_workers = impl_->threads.size();
+    ++impl_->generation;
+  }
+  impl_->job_ready.notify_all();
+
+  impl_->work();
+
+  // Workers reference the caller's task, so wait for all of them to leave the job
+  auto lock = std::unique_lock(impl_->state_mutex);
+  impl_->job_done.wait(lock, [this] { return impl_->active_workers == 0; });
+}
+
+}  // namespace picam
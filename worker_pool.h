@@ -0,0 +1,61 @@
+//=================================================================================================
+// Copyright (C) 2025 GRAPE Contributors
+//=================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "thread_config.h"
+
+namespace picam {
+
+//=================================================================================================
+/// Persistent pool of threads for data-parallel loops, such as converting an image in row bands.
+/// Threads are created once and sleep between jobs, so dispatch costs a wake-up instead of a
+/// thread creation. The calling thread takes part in every job.
+///
+/// One job runs at a time. A caller that finds the pool busy runs its job alone instead of
+/// waiting, so concurrent users (e.g. several pipeline workers) degrade to single-threaded work
+/// rather than queueing behind each other
+class WorkerPool {
+public:
+  /// Create a pool
+  /// @param thread_count Number of threads in addition to the caller. 0 runs all jobs inline
+  /// @param config Placement and scheduling of the threads
+  explicit WorkerPool(std::size_t thread_count, const ThreadConfig& config = {});
+
+  /// @return Pool with one thread per hardware thread, less one for the caller. Created on first
+  /// use and shared by the whole process
+  static auto shared() -> WorkerPool&;
+
+  /// @return Number of threads that can work on a job, including the caller
+  [[nodiscard]] auto concurrency() const -> std::size_t;
+
+  /// Call task(index) once for every index in [0, count), spread over the pool and the calling
+  /// thread. Returns when all calls have finished. The task must not throw
+  /// @param count Number of work items
+  /// @param task Callable taking the index of a work item
+  template <typename Task>
+  void parallelFor(std::size_t count, const Task& task) {
+    run(count, &task, [](const void* context, std::size_t index) {
+      (*static_cast<const Task*>(context))(index);
+    });
+  }
+
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  auto operator=(const WorkerPool&) = delete;
+  auto operator=(WorkerPool&&) = delete;
+
+private:
+  using TaskFunction = void (*)(const void* context, std::size_t index);
+  void run(std::size_t count, const void* context, TaskFunction function);
+
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace picam